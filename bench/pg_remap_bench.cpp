@@ -0,0 +1,99 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Times the merge of a 16-channel pattern group into the main buffer, as
+ * done by PatternGeneratorChannelManager::commitBuffer, at the 1,048,576
+ * samples cap of the pattern generator buffer. The table-driven remap is
+ * compared against remapping every sample bit by bit.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "pg_remap.hpp"
+
+using namespace adiscope;
+
+static const uint32_t buffer_size = 1048576;
+static const int iterations = 20;
+
+template <typename F>
+static double time_ms(F f)
+{
+	double best = 0;
+
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::duration<double, std::milli> elapsed =
+		        std::chrono::steady_clock::now() - start;
+
+		if (i == 0 || elapsed.count() < best) {
+			best = elapsed.count();
+		}
+	}
+
+	return best;
+}
+
+int main()
+{
+	// Channels wired in reverse, so every bit moves
+	uint8_t mapping[16];
+
+	for (int i = 0; i < 16; i++) {
+		mapping[i] = 15 - i;
+	}
+
+	std::vector<short> pattern(buffer_size);
+	std::mt19937 gen(0);
+
+	for (auto& sample : pattern) {
+		sample = (short)gen();
+	}
+
+	std::vector<short> expected(buffer_size), result(buffer_size);
+
+	double bitwise = time_ms([&]() {
+		for (uint32_t i = 0; i < buffer_size; i++) {
+			expected[i] = PatternRemap::remap(mapping,
+			                (uint16_t)pattern[i]);
+		}
+	});
+
+	double table = time_ms([&]() {
+		PatternRemap remap(mapping, 16, 0xffff);
+		remap.merge(result.data(), pattern.data(), buffer_size);
+	});
+
+	if (result != expected) {
+		fprintf(stderr, "table remap differs from the bitwise remap\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("commitBuffer, %u samples, 16 channels\n", buffer_size);
+	printf("  bitwise remap: %8.3f ms\n", bitwise);
+	printf("  table remap:   %8.3f ms (%.1fx)\n", table, bitwise / table);
+
+	return EXIT_SUCCESS;
+}
@@ -7,5 +7,12 @@ pg.buffer[1] = 0x0001;
 pg.buffer[2] = 0x0001;
 pg.buffer[3] = 0x0001;*/
 
+/* Faster alternatives for large patterns:
+pg.buffer = new Int16Array([0x0000, 0x0001, 0x0001, 0x0001]);
+
+pg.fill(0, 1, 0x0000);
+pg.fill(1, 3, 0x0001);
+pg.repeat(0, 4);*/
+
 pg.buffersize = 4
 }
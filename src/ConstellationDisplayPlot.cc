@@ -171,7 +171,8 @@ ConstellationDisplayPlot::set_pen_size(int size)
 void
 ConstellationDisplayPlot::replot()
 {
-  QwtPlot::replot();
+  if (!d_headless)
+    QwtPlot::replot();
 }
 
 
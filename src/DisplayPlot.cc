@@ -382,6 +382,8 @@ void PlotAxisConfiguration::setMouseGesturesEnabled(bool en)
  * DisplayPlot class
  */
 
+bool DisplayPlot::d_headless = false;
+
 DisplayPlot::DisplayPlot(int nplots, QWidget* parent,
 			 unsigned int xNumDivs, unsigned int yNumDivs)
   : QwtPlot(parent), d_nplots(nplots), d_stop(false)
@@ -496,6 +498,16 @@ DisplayPlot::DisplayPlot(int nplots, QWidget* parent,
   d_grid->attach(this);
 }
 
+void DisplayPlot::setHeadless(bool en)
+{
+  d_headless = en;
+}
+
+bool DisplayPlot::headless()
+{
+  return d_headless;
+}
+
 DisplayPlot::~DisplayPlot()
 {
 	// d_zoomer and d_panner deleted when parent deleted
@@ -276,6 +276,10 @@ public:
 
   virtual void replot() = 0;
 
+  // In headless mode the plots keep their data, but are never drawn
+  static void setHeadless(bool en);
+  static bool headless();
+
   const QColor getLineColor1 () const;
   const QColor getLineColor2 () const;
   const QColor getLineColor3 () const;
@@ -538,6 +542,8 @@ protected:
   NumberSeries d_hScaleDivisions;
   NumberSeries d_vScaleDivisions;
 
+  static bool d_headless;
+
   void setXaxisNumDiv(unsigned int);
   void setYaxisNumDiv(unsigned int);
   void bottomHorizAxisInit();
@@ -162,7 +162,8 @@ FftDisplayPlot::~FftDisplayPlot()
 
 void FftDisplayPlot::replot()
 {
-	QwtPlot::replot();
+	if (!d_headless)
+		QwtPlot::replot();
 }
 
 void FftDisplayPlot::setZoomerEnabled()
@@ -203,7 +203,8 @@ HistogramDisplayPlot::~HistogramDisplayPlot()
 void
 HistogramDisplayPlot::replot()
 {
-  QwtPlot::replot();
+  if (!d_headless)
+    QwtPlot::replot();
 }
 
 void
@@ -223,7 +223,8 @@ TimeDomainDisplayPlot::~TimeDomainDisplayPlot()
 void
 TimeDomainDisplayPlot::replot()
 {
-  QwtPlot::replot();
+  if (!d_headless)
+    QwtPlot::replot();
 }
 
 void
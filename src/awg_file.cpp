@@ -0,0 +1,452 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/* Qt includes */
+#include <QByteArray>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <volk/volk.h>
+
+/* Local includes */
+#include "awg_file.hpp"
+
+using namespace adiscope;
+
+const size_t AwgFile::blockSize = 4096;
+
+/* Low-pass used below the rate of the file: a Blackman windowed sinc,
+ * cut a bit below the new Nyquist frequency, which spans kernelWidth
+ * output samples on each side. It is tabulated kernelResolution times
+ * per output sample and interpolated linearly. */
+static const unsigned int kernelWidth = 8;
+static const unsigned int kernelResolution = 256;
+static const double kernelCutoff = 0.9;
+
+static const std::vector<float>& lowPassKernel()
+{
+	static const std::vector<float> kernel = []() {
+		std::vector<float> k(kernelWidth * kernelResolution + 2, 0.0f);
+
+		for (size_t j = 0; j <= kernelWidth * kernelResolution; j++) {
+			double t = (double)j / kernelResolution;
+			double x = M_PI * kernelCutoff * t;
+			double sinc = j ? std::sin(x) / x : 1.0;
+			double w = 0.42 + 0.5 * std::cos(M_PI * t / kernelWidth) +
+			           0.08 * std::cos(2.0 * M_PI * t / kernelWidth);
+
+			k[j] = (float)(sinc * w);
+		}
+
+		return k;
+	}();
+
+	return kernel;
+}
+
+enum {
+	WAV_FORMAT_PCM = 1,
+	WAV_FORMAT_IEEE_FLOAT = 3,
+	WAV_FORMAT_EXTENSIBLE = 0xfffe,
+};
+
+AwgFile::AwgFile() :
+	d_format(FLOAT32),
+	integer(false),
+	data(nullptr),
+	stride(sizeof(float)),
+	count(0),
+	rate(0)
+{
+}
+
+bool AwgFile::open(const QString& filename)
+{
+	close();
+
+	std::shared_ptr<QFile> f = std::make_shared<QFile>(filename);
+
+	if (!f->open(QIODevice::ReadOnly)) {
+		error = f->errorString();
+		return false;
+	}
+
+	const qint64 size = f->size();
+	const uchar *map = size > 0 ? f->map(0, size) : nullptr;
+
+	if (!map) {
+		error = size > 0 ? f->errorString() : QObject::tr("Empty file");
+		return false;
+	}
+
+	const QString suffix = QFileInfo(filename).suffix().toLower();
+	bool ok;
+
+	if (size >= 12 && !memcmp(map, "RIFF", 4) && !memcmp(map + 8, "WAVE", 4)) {
+		ok = openWav(map, size);
+	} else if (suffix == "csv" || suffix == "txt") {
+		ok = parseCsv(map, size);
+	} else if (suffix == "s16" || suffix == "i16") {
+		d_format = INT16;
+		integer = true;
+		data = map;
+		stride = sizeof(int16_t);
+		count = size / stride;
+		ok = true;
+	} else {
+		d_format = FLOAT32;
+		data = map;
+		stride = sizeof(float);
+		count = size / stride;
+		ok = true;
+	}
+
+	if (ok && !count) {
+		error = QObject::tr("No samples in file");
+		ok = false;
+	}
+
+	if (!ok) {
+		QString message = error;
+
+		close();
+		error = message;
+		return false;
+	}
+
+	// The parsed values of text files don't need the mapping
+	if (d_format != CSV) {
+		file = f;
+	}
+
+	return true;
+}
+
+void AwgFile::close()
+{
+	file.reset();
+	values.clear();
+	values.shrink_to_fit();
+	d_format = FLOAT32;
+	integer = false;
+	data = nullptr;
+	stride = sizeof(float);
+	count = 0;
+	rate = 0;
+	error.clear();
+}
+
+bool AwgFile::openWav(const uchar *map, qint64 size)
+{
+	unsigned int format = 0, channels = 0, bits = 0, align = 0;
+	qint64 pos = 12;
+
+	d_format = WAV;
+
+	while (pos + 8 <= size) {
+		const uchar *chunk = map + pos;
+		const quint32 len = qFromLittleEndian<quint32>(chunk + 4);
+		const qint64 body = pos + 8;
+
+		if (!memcmp(chunk, "fmt ", 4) && len >= 16 && body + len <= size) {
+			format = qFromLittleEndian<quint16>(chunk + 8);
+			channels = qFromLittleEndian<quint16>(chunk + 10);
+			rate = qFromLittleEndian<quint32>(chunk + 12);
+			align = qFromLittleEndian<quint16>(chunk + 20);
+			bits = qFromLittleEndian<quint16>(chunk + 22);
+
+			// The actual format is in the first 2 bytes of the GUID
+			if (format == WAV_FORMAT_EXTENSIBLE && len >= 26) {
+				format = qFromLittleEndian<quint16>(chunk + 32);
+			}
+		} else if (!memcmp(chunk, "data", 4)) {
+			if (!channels || !align) {
+				break;
+			}
+
+			if (format == WAV_FORMAT_PCM && bits == 16) {
+				integer = true;
+			} else if (format == WAV_FORMAT_IEEE_FLOAT && bits == 32) {
+				integer = false;
+			} else {
+				error = QObject::tr("Only 16-bit PCM and 32-bit float WAV files are supported");
+				return false;
+			}
+
+			data = map + body;
+			stride = align;
+			count = std::min<qint64>(len, size - body) / align;
+			return true;
+		}
+
+		// Chunks are padded to an even size
+		pos = body + len + (len & 1);
+	}
+
+	error = QObject::tr("Corrupted WAV file");
+	return false;
+}
+
+bool AwgFile::parseCsv(const uchar *map, qint64 size)
+{
+	const char *ptr = (const char *)map;
+	const char *end = ptr + size;
+
+	d_format = CSV;
+
+	while (ptr < end) {
+		const char *eol = (const char *)memchr(ptr, '\n', end - ptr);
+
+		if (!eol) {
+			eol = end;
+		}
+
+		// Use the last field, so that time / value files work too
+		const char *field = eol;
+
+		while (field > ptr && field[-1] != ',' && field[-1] != ';' &&
+		       field[-1] != '\t') {
+			field--;
+		}
+
+		bool ok;
+		float value = QByteArray::fromRawData(field, eol - field)
+		              .trimmed().toFloat(&ok);
+
+		// Headers and comments are skipped
+		if (ok) {
+			values.push_back(value);
+		}
+
+		ptr = eol + 1;
+	}
+
+	data = (const uchar *)values.data();
+	stride = sizeof(float);
+	count = values.size();
+	return true;
+}
+
+AwgFile::Format AwgFile::format() const
+{
+	return d_format;
+}
+
+uint64_t AwgFile::sampleCount() const
+{
+	return count;
+}
+
+QString AwgFile::errorString() const
+{
+	return error;
+}
+
+double AwgFile::sampleRate() const
+{
+	return rate;
+}
+
+void AwgFile::setSampleRate(double rate)
+{
+	this->rate = rate;
+}
+
+uint64_t AwgFile::outputCount(double rate) const
+{
+	if (!count || this->rate <= 0 || rate == this->rate) {
+		return count;
+	}
+
+	return std::max<uint64_t>(1, llround(count * rate / this->rate));
+}
+
+float AwgFile::sampleAt(uint64_t index) const
+{
+	const uchar *src = data + index * stride;
+
+	if (integer) {
+		int16_t value;
+		memcpy(&value, src, sizeof(value));
+		return value / 32768.0f;
+	} else {
+		float value;
+		memcpy(&value, src, sizeof(value));
+		return value;
+	}
+}
+
+void AwgFile::convert(float *dst, uint64_t index, size_t samples) const
+{
+	const uchar *src = data + index * stride;
+
+	if (!integer && stride == sizeof(float)) {
+		memcpy(dst, src, samples * sizeof(float));
+	} else if (integer && stride == sizeof(int16_t)) {
+		volk_16i_s32f_convert_32f(dst, (const int16_t *)src, 32768.0f,
+		                          samples);
+	} else {
+		for (size_t i = 0; i < samples; i++) {
+			dst[i] = sampleAt(index + i);
+		}
+	}
+}
+
+void AwgFile::read(float *dst, uint64_t first, size_t samples,
+                   double rate) const
+{
+	if (!count) {
+		std::fill(dst, dst + samples, 0.0f);
+		return;
+	}
+
+	// Same rate: straight conversion of the mapped samples
+	if (this->rate <= 0 || rate == this->rate) {
+		uint64_t index = first % count;
+
+		for (size_t i = 0; i < samples;) {
+			size_t n = std::min<uint64_t>(samples - i, count - index);
+
+			convert(dst + i, index, n);
+			i += n;
+			index = 0;
+		}
+
+		return;
+	}
+
+	const double step = this->rate / rate;
+
+	if (step > 1.0) {
+		decimate(dst, first, samples, step);
+		return;
+	}
+
+	for (size_t i = 0; i < samples; i++) {
+		double pos = (first + i) * step;
+		double whole = std::floor(pos);
+		float frac = (float)(pos - whole);
+		uint64_t index = (uint64_t)whole % count;
+		float lo = sampleAt(index);
+		float hi = sampleAt(index + 1 < count ? index + 1 : 0);
+
+		dst[i] = lo + frac * (hi - lo);
+	}
+}
+
+void AwgFile::decimate(float *dst, uint64_t first, size_t samples,
+                       double step) const
+{
+	const std::vector<float>& kernel = lowPassKernel();
+	const double reach = kernelWidth * step;
+	const double scale = kernelResolution / step;
+	const int64_t n = count;
+
+	// Whatever is above the new Nyquist frequency would alias, so each
+	// output sample is the low-pass filtered file around its position.
+	// The file wraps around, like the output.
+	for (size_t i = 0; i < samples; i++) {
+		const double pos = (first + i) * step;
+		const int64_t lo = (int64_t)std::ceil(pos - reach);
+		const int64_t hi = (int64_t)std::floor(pos + reach);
+		int64_t index = ((lo % n) + n) % n;
+		double sum = 0.0, norm = 0.0;
+
+		for (int64_t k = lo; k <= hi; k++) {
+			const double t = std::fabs(k - pos) * scale;
+			const size_t j = (size_t)t;
+
+			if (j + 1 < kernel.size()) {
+				const float w = kernel[j] +
+				                (float)(t - j) * (kernel[j + 1] - kernel[j]);
+
+				sum += w * sampleAt(index);
+				norm += w;
+			}
+
+			if (++index == n) {
+				index = 0;
+			}
+		}
+
+		// Normalized, so that the DC level is kept exactly
+		dst[i] = norm > 0.0 ? (float)(sum / norm) : 0.0f;
+	}
+}
+
+void AwgFile::read(double *dst, uint64_t first, size_t samples,
+                   double rate) const
+{
+	float block[blockSize];
+
+	for (size_t i = 0; i < samples; i += blockSize) {
+		size_t n = std::min(blockSize, samples - i);
+
+		read(block, first + i, n, rate);
+		volk_32f_convert_64f(dst + i, block, n);
+	}
+}
+
+void AwgFile::read(int16_t *dst, uint64_t first, size_t samples,
+                   ptrdiff_t stride, float scale, double rate) const
+{
+	float block[blockSize];
+	int16_t converted[blockSize];
+	char *out = (char *)dst;
+
+	for (size_t i = 0; i < samples; i += blockSize) {
+		size_t n = std::min(blockSize, samples - i);
+
+		read(block, first + i, n, rate);
+
+		if (stride == sizeof(int16_t)) {
+			volk_32f_s32f_convert_16i((int16_t *)out, block, scale, n);
+			out += n * sizeof(int16_t);
+			continue;
+		}
+
+		volk_32f_s32f_convert_16i(converted, block, scale, n);
+
+		for (size_t j = 0; j < n; j++) {
+			*(int16_t *)out = converted[j];
+			out += stride;
+		}
+	}
+}
+
+void AwgFile::preview(double *dst, uint64_t first, size_t samples,
+                      double rate) const
+{
+	if (!count || this->rate <= 0 || rate >= this->rate) {
+		read(dst, first, samples, rate);
+		return;
+	}
+
+	const double step = this->rate / rate;
+
+	for (size_t i = 0; i < samples; i++) {
+		uint64_t index = (uint64_t)std::llround((first + i) * step);
+
+		dst[i] = sampleAt(index % count);
+	}
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef AWG_FILE_HPP
+#define AWG_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/* Qt includes */
+#include <QFile>
+#include <QString>
+
+namespace adiscope {
+
+/*
+ * Arbitrary waveform file played by the signal generator.
+ *
+ * Supported are raw native float32 files (the default), raw native int16
+ * files (*.s16, *.i16), CSV / text files holding one value per line (the
+ * last field of each line is used) and 16-bit PCM or 32-bit float WAV
+ * files (the first channel is used). Integer samples are scaled to +/-1.
+ *
+ * Binary files are memory mapped and converted to volts only when the
+ * samples are read, so large files never get a second copy in memory.
+ * Reads resample the file from its own sample rate to the requested one
+ * and wrap around at the end of the file: by linear interpolation at
+ * higher rates, through a windowed-sinc low-pass at lower rates.
+ */
+class AwgFile
+{
+public:
+	enum Format {
+		FLOAT32,
+		INT16,
+		CSV,
+		WAV,
+	};
+
+	AwgFile();
+
+	bool open(const QString& filename);
+	void close();
+
+	Format format() const;
+	uint64_t sampleCount() const;
+	QString errorString() const;
+
+	/* Sample rate of the file, 0 when the file doesn't tell */
+	double sampleRate() const;
+	void setSampleRate(double rate);
+
+	/* Number of samples which one pass over the file takes at @rate */
+	uint64_t outputCount(double rate) const;
+
+	/*
+	 * Reads @samples samples at @rate, starting at sample @first of
+	 * the output. At lower rates than the one of the file, the file is
+	 * low-pass filtered so that its content above the new Nyquist
+	 * frequency doesn't alias.
+	 */
+	void read(float *dst, uint64_t first, size_t samples,
+	          double rate) const;
+	void read(double *dst, uint64_t first, size_t samples,
+	          double rate) const;
+
+	/*
+	 * Writes raw DAC samples, like WaveformSynth::generate(): @scale
+	 * converts volts to DAC codes and @stride is the distance in bytes
+	 * between two samples.
+	 */
+	void read(int16_t *dst, uint64_t first, size_t samples,
+	          ptrdiff_t stride, float scale, double rate) const;
+
+	/*
+	 * Like read(), but for display: at lower rates than the one of the
+	 * file, the nearest sample is picked instead of low-pass filtering,
+	 * so the cost only depends on @samples.
+	 */
+	void preview(double *dst, uint64_t first, size_t samples,
+	             double rate) const;
+
+private:
+	bool openWav(const uchar *map, qint64 size);
+	bool parseCsv(const uchar *map, qint64 size);
+
+	float sampleAt(uint64_t index) const;
+	void decimate(float *dst, uint64_t first, size_t samples,
+	              double step) const;
+	void convert(float *dst, uint64_t index, size_t samples) const;
+
+	static const size_t blockSize;
+
+	std::shared_ptr<QFile> file;
+	Format d_format;
+	bool integer;
+	const uchar *data;
+	size_t stride;
+	uint64_t count;
+	double rate;
+	std::vector<float> values;
+	QString error;
+};
+}
+
+#endif /* AWG_FILE_HPP */
@@ -20,15 +20,29 @@
 #include "calibration.hpp"
 #include "osc_adc.h"
 #include "hw_dac.h"
+#include "iio_attr_cache.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <errno.h>
+#include <QCoreApplication>
+#include <QDateTime>
 #include <QDebug>
+#include <QSettings>
 #include <QtGlobal>
 #include <iio.h>
 #include <QThread>
+#include <volk/volk.h>
 
 using namespace adiscope;
 
+/* libiio's default number of kernel buffers */
+static const unsigned int defaultKernelBuffers = 4;
+
+/* Device whose temperature is saved along with the cached calibration */
+static const QString cacheDevice = "ad9963";
+
 Calibration::Calibration(struct iio_context *ctx, QJSEngine *engine,
 			 std::shared_ptr<M2kAdc> adc,
 			 std::shared_ptr<M2kDac> dac_a,
@@ -37,6 +51,10 @@ Calibration::Calibration(struct iio_context *ctx, QJSEngine *engine,
 	m_ctx(ctx),
 	m_dac_a_buffer(NULL),
 	m_dac_b_buffer(NULL),
+	m_adc_buffer(NULL),
+	m_adc_buffer_size(0),
+	m_adc_buffer_ch0(false),
+	m_adc_buffer_ch1(false),
 	m_initialized(false),
 	m2k_adc(adc),
 	m2k_dac_a(dac_a),
@@ -49,6 +67,7 @@ Calibration::Calibration(struct iio_context *ctx, QJSEngine *engine,
 
 Calibration::~Calibration()
 {
+	adc_release_buffer();
 	if (m_dac_a_buffer)
 		iio_buffer_destroy(m_dac_a_buffer);
 	if (m_dac_b_buffer)
@@ -138,31 +157,31 @@ void Calibration::setHardwareInCalibMode()
 			trigg_dev, "voltage5", false);
 
 		if (trigger0Mode) {
-			iio_channel_attr_read(trigger0Mode, "mode", buf,
+			IioAttrCache::read(trigger0Mode, "mode", buf,
 				sizeof(buf));
 			m_trigger0_mode.assign(buf);
-			iio_channel_attr_write(trigger0Mode, "mode", "always");
+			IioAttrCache::write(trigger0Mode, "mode", "always");
 		}
 		if (trigger1Mode) {
-			iio_channel_attr_read(trigger1Mode, "mode", buf,
+			IioAttrCache::read(trigger1Mode, "mode", buf,
 				sizeof(buf));
 			m_trigger1_mode.assign(buf);
-			iio_channel_attr_write(trigger1Mode, "mode", "always");
+			IioAttrCache::write(trigger1Mode, "mode", "always");
 		}
 	}
 
 	/* Save the previous values for sampling frequency and oversampling ratio */
-	iio_device_attr_read_double(m_m2k_adc, "sampling_frequency",
+	IioAttrCache::read(m_m2k_adc, "sampling_frequency",
 		&adc_sampl_freq);
-	iio_device_attr_read_double(m_m2k_adc, "oversampling_ratio",
+	IioAttrCache::read(m_m2k_adc, "oversampling_ratio",
 		&adc_oversampl);
-	iio_device_attr_read_double(m_m2k_dac_a, "sampling_frequency",
+	IioAttrCache::read(m_m2k_dac_a, "sampling_frequency",
 		&dac_a_sampl_freq);
-	iio_device_attr_read_double(m_m2k_dac_a, "oversampling_ratio",
+	IioAttrCache::read(m_m2k_dac_a, "oversampling_ratio",
 		&dac_a_oversampl);
-	iio_device_attr_read_double(m_m2k_dac_b, "sampling_frequency",
+	IioAttrCache::read(m_m2k_dac_b, "sampling_frequency",
 		&dac_b_sampl_freq);
-	iio_device_attr_read_double(m_m2k_dac_b, "oversampling_ratio",
+	IioAttrCache::read(m_m2k_dac_b, "oversampling_ratio",
 		&dac_b_oversampl);
 }
 
@@ -170,15 +189,18 @@ void Calibration::configHwSamplerate()
 {
 	// Make sure we calibrate at the highest sample rate
 	m2k_adc->setSampleRate(1e8);
-	iio_device_attr_write_longlong(m2k_adc->iio_adc_dev(), "oversampling_ratio", 1);
+	IioAttrCache::write(m2k_adc->iio_adc_dev(), "oversampling_ratio", 1LL);
 	m2k_dac_a->setSampleRate(75E6);
-	iio_device_attr_write_longlong(m2k_dac_a->iio_dac_dev(), "oversampling_ratio", 1);
+	IioAttrCache::write(m2k_dac_a->iio_dac_dev(), "oversampling_ratio", 1LL);
 	m2k_dac_b->setSampleRate(75E6);
-	iio_device_attr_write_longlong(m2k_dac_b->iio_dac_dev(), "oversampling_ratio", 1);
+	IioAttrCache::write(m2k_dac_b->iio_dac_dev(), "oversampling_ratio", 1LL);
 }
 
 void Calibration::restoreHardwareFromCalibMode()
 {
+	// The tools need the ADC back
+	adc_release_buffer();
+
 	struct iio_device *trigg_dev = iio_context_find_device(m_ctx,
 							"m2k-adc-trigger");
 	struct iio_channel *trigger0Mode;
@@ -191,27 +213,27 @@ void Calibration::restoreHardwareFromCalibMode()
 							false);
 
 		if (trigger0Mode && !m_trigger0_mode.empty()) {
-			iio_channel_attr_write(trigger0Mode, "mode",
+			IioAttrCache::write(trigger0Mode, "mode",
 						m_trigger0_mode.c_str());
 		}
 		if (trigger1Mode) {
-			iio_channel_attr_write(trigger1Mode, "mode",
+			IioAttrCache::write(trigger1Mode, "mode",
 						m_trigger1_mode.c_str());
 		}
 	}
 
 	/* Restore the previous values for sampling frequency and oversampling ratio */
-	iio_device_attr_write_double(m_m2k_adc, "sampling_frequency",
+	IioAttrCache::write(m_m2k_adc, "sampling_frequency",
 		adc_sampl_freq);
-	iio_device_attr_write_double(m_m2k_adc, "oversampling_ratio",
+	IioAttrCache::write(m_m2k_adc, "oversampling_ratio",
 		adc_oversampl);
-	iio_device_attr_write_double(m_m2k_dac_a, "sampling_frequency",
+	IioAttrCache::write(m_m2k_dac_a, "sampling_frequency",
 		dac_a_sampl_freq);
-	iio_device_attr_write_double(m_m2k_dac_a, "oversampling_ratio",
+	IioAttrCache::write(m_m2k_dac_a, "oversampling_ratio",
 		dac_a_oversampl);
-	iio_device_attr_write_double(m_m2k_dac_b, "sampling_frequency",
+	IioAttrCache::write(m_m2k_dac_b, "sampling_frequency",
 		dac_b_sampl_freq);
-	iio_device_attr_write_double(m_m2k_dac_b, "oversampling_ratio",
+	IioAttrCache::write(m_m2k_dac_b, "oversampling_ratio",
 		dac_b_oversampl);
 }
 
@@ -227,11 +249,11 @@ bool Calibration::calibrateADCoffset()
 	qDebug() << "Starting ADC OFFSET CALIBRATION";
 
 	// Ground ADC inputs
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "adc_gnd");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "adc_gnd");
 
 	// Set DAC channels to middle scale
-	iio_channel_attr_write_longlong(m_ad5625_channel2, "raw", 2048);
-	iio_channel_attr_write_longlong(m_ad5625_channel3, "raw", 2048);
+	IioAttrCache::write(m_ad5625_channel2, "raw", 2048LL);
+	IioAttrCache::write(m_ad5625_channel3, "raw", 2048LL);
 
 	// Allow some time for the voltage to settle
 	QThread::msleep(50);
@@ -290,7 +312,7 @@ bool Calibration::calibrateADCgain()
 
 	qDebug() << "Starting ADC GAIN CALIBRATION";
 
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "adc_ref1");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "adc_ref1");
 
 	double vref1 = 0.4615;
 	const unsigned int num_samples = 1e5;
@@ -325,7 +347,7 @@ bool Calibration::calibrateADCgain()
 	qDebug() << "Gain for channel0: " << m_adc_ch0_gain;
 	qDebug() << "Gain for channel1: " << m_adc_ch1_gain;
 
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "none");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "none");
 
 	calibrated = true;
 
@@ -354,15 +376,15 @@ double Calibration::adcGainChannel1() const
 
 void Calibration::updateCorrections()
 {
-	iio_channel_attr_write_double(m_ad5625_channel2, "raw",
-				      m_adc_ch0_offset);
-	iio_channel_attr_write_double(m_ad5625_channel3, "raw",
-				      m_adc_ch1_offset);
+	IioAttrCache::write(m_ad5625_channel2, "raw",
+			    (double)m_adc_ch0_offset);
+	IioAttrCache::write(m_ad5625_channel3, "raw",
+			    (double)m_adc_ch1_offset);
 
-	iio_channel_attr_write_double(m_ad5625_channel0, "raw",
-				      m_dac_a_ch_offset);
-	iio_channel_attr_write_double(m_ad5625_channel1, "raw",
-				      m_dac_b_ch_offset);
+	IioAttrCache::write(m_ad5625_channel0, "raw",
+			    (double)m_dac_a_ch_offset);
+	IioAttrCache::write(m_ad5625_channel1, "raw",
+			    (double)m_dac_b_ch_offset);
 
 	if(m2k_adc) {
 		m2k_adc->setChnCorrectionOffset(0, adcOffsetChannel0());
@@ -384,7 +406,7 @@ bool Calibration::resetCalibration()
 		return false;
 	}
 
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "none");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "none");
 
 	m_adc_ch0_offset = 2048;
 	m_adc_ch1_offset = 2048;
@@ -412,12 +434,23 @@ void Calibration::setChannelEnableState(struct iio_channel *chn, bool en)
 
 double Calibration::average(int16_t *data, size_t numElements)
 {
-	double sum = 0;
+	// The partial sums of 64K samples can't overflow 32 bits. The inner
+	// loop is exact and simple enough to be vectorized
+	const size_t block = 1 << 16;
+	int64_t sum = 0;
+
+	for (size_t i = 0; i < numElements; i += block) {
+		const size_t n = std::min(block, numElements - i);
+		const int16_t *src = data + i;
+		int32_t partial = 0;
+
+		for (size_t j = 0; j < n; j++)
+			partial += src[j];
 
-	for (size_t i = 0; i < numElements; i++)
-		sum += data[i];
+		sum += partial;
+	}
 
-	return (sum / (double)numElements);
+	return ((double)sum / (double)numElements);
 }
 
 bool Calibration::adc_data_capture(int16_t *dataCh0, int16_t *dataCh1,
@@ -429,136 +462,193 @@ bool Calibration::adc_data_capture(int16_t *dataCh0, int16_t *dataCh1,
 		return false;
 	}
 
-	// Store channels enable state
-	bool channel0Enabled = iio_channel_is_enabled(m_adc_channel0);
-	bool channel1Enabled = iio_channel_is_enabled(m_adc_channel1);
-
-	// Enable the required channels
-	setChannelEnableState(m_adc_channel0, !!dataCh0);
-	setChannelEnableState(m_adc_channel1, !!dataCh1);
-
-	struct iio_buffer *buffer = iio_device_create_buffer(m_m2k_adc,
-		num_sampl_per_chn, false);
-
-	if (!buffer) {
-		qDebug() << "Could not create m2k-adc buffer!" <<
-			strerror(errno) << "Aborting calibration.";
+	// The buffer of the previous capture is reused when it has the
+	// same size and channels, its creation is the costly part
+	if (m_adc_buffer && (m_adc_buffer_size != num_sampl_per_chn ||
+			m_adc_buffer_ch0 != !!dataCh0 ||
+			m_adc_buffer_ch1 != !!dataCh1))
+		adc_release_buffer();
+
+	if (!m_adc_buffer) {
+		// Store channels enable state
+		bool channel0Enabled = iio_channel_is_enabled(m_adc_channel0);
+		bool channel1Enabled = iio_channel_is_enabled(m_adc_channel1);
+
+		// Enable the required channels
+		setChannelEnableState(m_adc_channel0, !!dataCh0);
+		setChannelEnableState(m_adc_channel1, !!dataCh1);
+
+		// With a single kernel buffer, each refill starts acquiring
+		// when it is called and never returns samples taken before
+		// the offsets were changed
+		iio_device_set_kernel_buffers_count(m_m2k_adc, 1);
+		m_adc_buffer = iio_device_create_buffer(m_m2k_adc,
+			num_sampl_per_chn, false);
+
+		// Restore channels enable states
 		setChannelEnableState(m_adc_channel0, channel0Enabled);
 		setChannelEnableState(m_adc_channel1, channel1Enabled);
-		return false;
+
+		if (!m_adc_buffer) {
+			qDebug() << "Could not create m2k-adc buffer!" <<
+				strerror(errno) << "Aborting calibration.";
+			iio_device_set_kernel_buffers_count(m_m2k_adc,
+				defaultKernelBuffers);
+			return false;
+		}
+
+		m_adc_buffer_size = num_sampl_per_chn;
+		m_adc_buffer_ch0 = !!dataCh0;
+		m_adc_buffer_ch1 = !!dataCh1;
 	}
 
-	int ret = iio_buffer_refill(buffer);
+	ssize_t ret = iio_buffer_refill(m_adc_buffer);
 
 	if (ret < 0) {
 		qDebug() << "Could not refill m2k-adc buffer! Error:" << ret <<
 			"Aborting calibration";
-		iio_buffer_destroy(buffer);
-		setChannelEnableState(m_adc_channel0, channel0Enabled);
-		setChannelEnableState(m_adc_channel1, channel1Enabled);
+		adc_release_buffer();
 		return false;
 	}
 
-	ptrdiff_t p_inc = iio_buffer_step(buffer);
-	uintptr_t p_dat;
-	uintptr_t p_end = (uintptr_t)iio_buffer_end(buffer);
-	unsigned int i;
-	for (i = 0, p_dat = (uintptr_t)iio_buffer_first(buffer, m_adc_channel0);
-			p_dat < p_end; p_dat += p_inc, i++)
-	{
-		if (dataCh0 && dataCh1) {
-			dataCh0[i] = ((int16_t*)p_dat)[0];
-			dataCh1[i] = ((int16_t*)p_dat)[1];
-
-		} else if (dataCh0) {
-			dataCh0[i] = ((int16_t*)p_dat)[0];
-		} else if (dataCh1) {
-			dataCh1[i] = ((int16_t*)p_dat)[0];
+	ptrdiff_t p_inc = iio_buffer_step(m_adc_buffer);
+	uintptr_t p_dat = (uintptr_t)iio_buffer_first(m_adc_buffer,
+		dataCh0 ? m_adc_channel0 : m_adc_channel1);
+	uintptr_t p_end = (uintptr_t)iio_buffer_end(m_adc_buffer);
+	size_t count = std::min<size_t>((p_end - p_dat) / p_inc,
+		num_sampl_per_chn);
+
+	if (dataCh0 && dataCh1 && p_inc == 2 * sizeof(int16_t)) {
+		volk_16ic_deinterleave_16i_x2(dataCh0, dataCh1,
+			(const lv_16sc_t *)p_dat, count);
+	} else if (!(dataCh0 && dataCh1) && p_inc == sizeof(int16_t)) {
+		memcpy(dataCh0 ? dataCh0 : dataCh1, (const void *)p_dat,
+			count * sizeof(int16_t));
+	} else {
+		for (size_t i = 0; i < count; i++, p_dat += p_inc) {
+			if (dataCh0 && dataCh1) {
+				dataCh0[i] = ((int16_t*)p_dat)[0];
+				dataCh1[i] = ((int16_t*)p_dat)[1];
+			} else if (dataCh0) {
+				dataCh0[i] = ((int16_t*)p_dat)[0];
+			} else if (dataCh1) {
+				dataCh1[i] = ((int16_t*)p_dat)[0];
+			}
 		}
 	}
 
-	iio_buffer_destroy(buffer);
+	return true;
+}
+
+void Calibration::adc_release_buffer()
+{
+	if (!m_adc_buffer)
+		return;
+
+	iio_buffer_destroy(m_adc_buffer);
+	m_adc_buffer = NULL;
+	iio_device_set_kernel_buffers_count(m_m2k_adc, defaultKernelBuffers);
+}
+
+bool Calibration::adc_offset_response(int offset0, int offset1,
+	int16_t *dataCh0, int16_t *dataCh1, size_t num_samples,
+	double *avg0, double *avg1)
+{
+	IioAttrCache::write(m_ad5625_channel2, "raw", (long long)offset0);
+	IioAttrCache::write(m_ad5625_channel3, "raw", (long long)offset1);
+
+	// Allow some time for the voltage to settle
+	QThread::msleep(5);
 
-	// Restore channels enable states
-	setChannelEnableState(m_adc_channel0, channel0Enabled);
-	setChannelEnableState(m_adc_channel1, channel1Enabled);
+	if (!adc_data_capture(dataCh0, dataCh1, num_samples)) {
+		qDebug() << "failed to get samples";
+		return false;
+	}
+
+	*avg0 = average(dataCh0, num_samples);
+	*avg1 = average(dataCh1, num_samples);
 
 	return true;
 }
 
+/*
+ * The average read by the ADC is a linear function of the offset code.
+ * It is measured at both ends of the span, which gives the code where
+ * it crosses zero; then the two codes around it are measured and the
+ * code with the average closest to zero wins. That's 4 captures instead
+ * of one for each code of the span.
+ */
 bool Calibration::fine_tune(size_t span, int16_t centerVal0, int16_t centerVal1,
 	size_t num_samples)
 {
-	int16_t *candidateOffsets0 = new int16_t[span + 1];
-	int16_t *candidateOffsets1 = new int16_t[span + 1];
-	double *averagesCh0 = new double[span + 1];
-	double *averagesCh1 = new double[span + 1];
-	double minAvg0, minAvg1;
+	const int low[2] = { centerVal0 - (int)span / 2,
+		centerVal1 - (int)span / 2 };
+	const int high[2] = { low[0] + (int)span, low[1] + (int)span };
+	int best[2] = { low[0], low[1] };
+	double bestAvg[2] = { 0, 0 };
+	double lowAvg[2], highAvg[2];
+	int candidate[2];
+	double avg[2];
 	int16_t *dataCh0 = new int16_t[num_samples];
 	int16_t *dataCh1 = new int16_t[num_samples];
-	int16_t offset0, offset1;
-	int i, i0 = 0, i1 = 0;
-	bool ret = true;
-
-	offset0 = centerVal0 - span / 2;
-	offset1 = centerVal1 - span / 2;
-	for (i = 0; i < span + 1; i++) {
-		candidateOffsets0[i] = offset0;
-		candidateOffsets1[i] = offset1;
-		iio_channel_attr_write_double(m_ad5625_channel2, "raw",
-			offset0);
-		iio_channel_attr_write_double(m_ad5625_channel3, "raw",
-			offset1);
-		offset0++;
-		offset1++;
-
-		// Allow some time for the voltage to settle
-		QThread::msleep(5);
-
-		ret = adc_data_capture(dataCh0, dataCh1, num_samples);
+	bool ret;
 
-		if (!ret) {
-			qDebug() << "failed to get samples";
-			goto out_cleanup;
+	auto keep_best = [&](const int *offset, const double *avg, bool first) {
+		for (int ch = 0; ch < 2; ch++) {
+			if (first || qAbs(avg[ch]) < bestAvg[ch]) {
+				bestAvg[ch] = qAbs(avg[ch]);
+				best[ch] = offset[ch];
+			}
 		}
+	};
+
+	ret = adc_offset_response(low[0], low[1], dataCh0, dataCh1,
+		num_samples, &lowAvg[0], &lowAvg[1]);
+	if (!ret)
+		goto out_cleanup;
+	keep_best(low, lowAvg, true);
+
+	ret = adc_offset_response(high[0], high[1], dataCh0, dataCh1,
+		num_samples, &highAvg[0], &highAvg[1]);
+	if (!ret)
+		goto out_cleanup;
+	keep_best(high, highAvg, false);
+
+	for (int ch = 0; ch < 2; ch++) {
+		double slope = (highAvg[ch] - lowAvg[ch]) / (double)span;
+		double zero = (low[ch] + high[ch]) / 2.0;
 
-		averagesCh0[i] = qAbs(average(dataCh0, num_samples));
-		averagesCh1[i] = qAbs(average(dataCh1, num_samples));
+		if (slope != 0)
+			zero = low[ch] - lowAvg[ch] / slope;
+
+		candidate[ch] = qBound(low[ch], (int)floor(zero), high[ch] - 1);
 	}
 
-	minAvg0 = qAbs(averagesCh0[0]);
-	minAvg1 = qAbs(averagesCh1[0]);
+	for (int i = 0; i < 2; i++) {
+		const int offset[2] = { candidate[0] + i, candidate[1] + i };
 
-	for (int i = 1; i < span + 1; i++) {
-		if (averagesCh0[i] < minAvg0) {
-			minAvg0 = averagesCh0[i];
-			i0 = i;
-		}
-		if (averagesCh1[i] < minAvg1) {
-			minAvg1 = averagesCh1[i];
-			i1 = i;
-		}
+		ret = adc_offset_response(offset[0], offset[1], dataCh0,
+			dataCh1, num_samples, &avg[0], &avg[1]);
+		if (!ret)
+			goto out_cleanup;
+		keep_best(offset, avg, false);
 	}
 
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "none");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "none");
 
-	m_adc_ch0_offset = candidateOffsets0[i0];
-	m_adc_ch1_offset = candidateOffsets1[i1];
+	m_adc_ch0_offset = best[0];
+	m_adc_ch1_offset = best[1];
 
 	qDebug() << "After Fine-Tunning";
 	qDebug() << "ADC channel 0 offset(raw):" << m_adc_ch0_offset;
 	qDebug() << "ADC channel 1 offset(raw):" << m_adc_ch1_offset;
 
-	iio_channel_attr_write_longlong(m_ad5625_channel2, "raw",
-		m_adc_ch0_offset);
-	iio_channel_attr_write_longlong(m_ad5625_channel3, "raw",
-		m_adc_ch1_offset);
+	IioAttrCache::write(m_ad5625_channel2, "raw",
+		(long long)m_adc_ch0_offset);
+	IioAttrCache::write(m_ad5625_channel3, "raw",
+		(long long)m_adc_ch1_offset);
 
 out_cleanup:
-	delete[] candidateOffsets0;
-	delete[] candidateOffsets1;
-	delete[] averagesCh0;
-	delete[] averagesCh1;
 	delete[] dataCh0;
 	delete[] dataCh1;
 	return ret;
@@ -595,11 +685,11 @@ bool Calibration::calibrateDACoffset()
 	qDebug() << "Starting DAC OFFSET CALIBRATION";
 
 	// connect ADC to DAC
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "dac");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "dac");
 
 	// Set DAC offset channels to middle scale
-	iio_channel_attr_write_longlong(m_ad5625_channel0, "raw", 2048);
-	iio_channel_attr_write_longlong(m_ad5625_channel1, "raw", 2048);
+	IioAttrCache::write(m_ad5625_channel0, "raw", 2048LL);
+	IioAttrCache::write(m_ad5625_channel1, "raw", 2048LL);
 
 	// write to DAC
 	dacAOutputDC(0);
@@ -637,10 +727,10 @@ bool Calibration::calibrateDACoffset()
 	m_dac_a_ch_offset = (int)(2048 - ((voltage0 * 9.06 ) / 0.002658));
 	m_dac_b_ch_offset = (int)(2048 - ((voltage1 * 9.06 ) / 0.002658));
 
-	iio_channel_attr_write_longlong(m_ad5625_channel0, "raw",
-		m_dac_a_ch_offset);
-	iio_channel_attr_write_longlong(m_ad5625_channel1, "raw",
-		m_dac_b_ch_offset);
+	IioAttrCache::write(m_ad5625_channel0, "raw",
+		(long long)m_dac_a_ch_offset);
+	IioAttrCache::write(m_ad5625_channel1, "raw",
+		(long long)m_dac_b_ch_offset);
 
 	qDebug() << "DAC calib offset results:";
 	qDebug() << "DAC channel 0 offset(raw):" << m_dac_a_ch_offset;
@@ -659,7 +749,7 @@ bool Calibration::calibrateDACoffset()
 	setChannelEnableState(m_dac_a_channel, false);
 	setChannelEnableState(m_dac_b_channel, false);
 
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "none");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "none");
 
 	calibrated = true;
 
@@ -671,7 +761,7 @@ bool Calibration::calibrateDACgain()
 	bool calibrated = false;
 
 	// connect ADC to DAC
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "dac");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "dac");
 
 	// Use the positive half scale point for gain calibration
 	dacAOutputDC(1024);
@@ -726,7 +816,7 @@ bool Calibration::calibrateDACgain()
 	setChannelEnableState(m_dac_a_channel, false);
 	setChannelEnableState(m_dac_b_channel, false);
 
-	iio_device_attr_write(m_m2k_fabric, "calibration_mode", "none");
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "none");
 
 	calibrated = true;
 
@@ -826,6 +916,122 @@ void Calibration::cancelCalibration()
 {
 	m_cancel=true;
 }
+QString Calibration::cacheGroup() const
+{
+	const char *serial = iio_context_get_attr_value(m_ctx, "hw_serial");
+
+	if (!serial || !*serial)
+		return QString();
+
+	return QString("calibration_") + serial;
+}
+
+QString Calibration::firmwareVersion() const
+{
+	return QString(iio_context_get_attr_value(m_ctx, "fw_version"));
+}
+
+bool Calibration::loadCached(double temp_band, qint64 max_age)
+{
+	if (!m_initialized)
+		return false;
+
+	const QString group = cacheGroup();
+	if (group.isEmpty())
+		return false;
+
+	// Separate from the settings of Scopy, which are only written on exit
+	QSettings cache(QSettings::IniFormat, QSettings::UserScope,
+		QCoreApplication::organizationName(), "Scopy-calibration");
+	cache.beginGroup(group);
+
+	// An entry from an older or interrupted write is not used at all
+	static const char *const keys[] = {
+		"timestamp", "temperature", "firmware",
+		"adc_offset0", "adc_offset1", "adc_gain0", "adc_gain1",
+		"dac_offset0", "dac_offset1", "dac_vlsb0", "dac_vlsb1",
+	};
+
+	for (const char *key : keys) {
+		if (!cache.contains(key)) {
+			qDebug() << "Calibration cache lacks" << key;
+			return false;
+		}
+	}
+
+	const QDateTime timestamp = cache.value("timestamp").toDateTime();
+	const qint64 age = timestamp.secsTo(QDateTime::currentDateTime());
+	const double temp = getIioDevTemp(cacheDevice);
+	bool temp_ok;
+	const double cached_temp = cache.value("temperature").toDouble(&temp_ok);
+
+	if (cache.value("firmware").toString() != firmwareVersion() ||
+			!timestamp.isValid() || age < 0 || age > max_age ||
+			!temp_ok ||
+			!std::isfinite(temp) || !std::isfinite(cached_temp) ||
+			qAbs(temp - cached_temp) > temp_band) {
+		qDebug() << "Calibration cache is stale, age:" << age <<
+			"s, temperature:" << cached_temp << "->" << temp;
+		return false;
+	}
+
+	bool ok[8];
+	const int adc_offset0 = cache.value("adc_offset0").toInt(&ok[0]);
+	const int adc_offset1 = cache.value("adc_offset1").toInt(&ok[1]);
+	const double adc_gain0 = cache.value("adc_gain0").toDouble(&ok[2]);
+	const double adc_gain1 = cache.value("adc_gain1").toDouble(&ok[3]);
+	const int dac_offset0 = cache.value("dac_offset0").toInt(&ok[4]);
+	const int dac_offset1 = cache.value("dac_offset1").toInt(&ok[5]);
+	const double dac_vlsb0 = cache.value("dac_vlsb0").toDouble(&ok[6]);
+	const double dac_vlsb1 = cache.value("dac_vlsb1").toDouble(&ok[7]);
+
+	if (std::count(ok, ok + 8, false) ||
+			!std::isnormal(adc_gain0) || !std::isnormal(adc_gain1) ||
+			!std::isnormal(dac_vlsb0) || !std::isnormal(dac_vlsb1)) {
+		qDebug() << "Calibration cache of" << group << "is invalid";
+		return false;
+	}
+
+	m_adc_ch0_offset = adc_offset0;
+	m_adc_ch1_offset = adc_offset1;
+	m_adc_ch0_gain = adc_gain0;
+	m_adc_ch1_gain = adc_gain1;
+	m_dac_a_ch_offset = dac_offset0;
+	m_dac_b_ch_offset = dac_offset1;
+	m_dac_a_ch_vlsb = dac_vlsb0;
+	m_dac_b_ch_vlsb = dac_vlsb1;
+
+	IioAttrCache::write(m_m2k_fabric, "calibration_mode", "none");
+	updateCorrections();
+
+	qDebug() << "Applied the cached calibration of" << group <<
+		"from" << age << "s ago";
+	return true;
+}
+
+void Calibration::storeCached()
+{
+	const QString group = cacheGroup();
+	if (group.isEmpty())
+		return;
+
+	QSettings cache(QSettings::IniFormat, QSettings::UserScope,
+		QCoreApplication::organizationName(), "Scopy-calibration");
+	cache.beginGroup(group);
+
+	cache.setValue("timestamp", QDateTime::currentDateTime());
+	cache.setValue("temperature", getIioDevTemp(cacheDevice));
+	cache.setValue("firmware", firmwareVersion());
+	cache.setValue("adc_offset0", m_adc_ch0_offset);
+	cache.setValue("adc_offset1", m_adc_ch1_offset);
+	cache.setValue("adc_gain0", m_adc_ch0_gain);
+	cache.setValue("adc_gain1", m_adc_ch1_gain);
+	cache.setValue("dac_offset0", m_dac_a_ch_offset);
+	cache.setValue("dac_offset1", m_dac_b_ch_offset);
+	cache.setValue("dac_vlsb0", m_dac_a_ch_vlsb);
+	cache.setValue("dac_vlsb1", m_dac_b_ch_vlsb);
+}
+
 /* FIXME: TODO: Move this into a HW class / lib M2k */
 double Calibration::getIioDevTemp(const QString& devName) const
 {
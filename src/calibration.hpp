@@ -22,6 +22,8 @@
 
 #include "apiObject.hpp"
 
+#include <QString>
+
 #include <cstdint>
 #include <cstdlib>
 #include <string>
@@ -78,6 +80,16 @@ public:
 
 	double getIioDevTemp(const QString& devName) const;
 
+	/*
+	 * The results of the calibrations are cached for each device, with
+	 * the temperature and the firmware version they were obtained with.
+	 * loadCached() applies the stored results when the firmware is the
+	 * same, they are not older than @max_age seconds and the
+	 * temperature is within @temp_band degrees Celsius.
+	 */
+	bool loadCached(double temp_band, qint64 max_age);
+	void storeCached();
+
 	static void setChannelEnableState(struct iio_channel *chn, bool en);
 	static double average(int16_t *data, size_t numElements);
 	static float convSampleToVolts(float sample, float correctionGain = 1);
@@ -86,6 +98,10 @@ public:
 private:
 	bool adc_data_capture(int16_t *dataCh0, int16_t *dataCh1,
 		size_t num_sampl_per_chn);
+	void adc_release_buffer();
+	bool adc_offset_response(int offset0, int offset1,
+		int16_t *dataCh0, int16_t *dataCh1, size_t num_samples,
+		double *avg0, double *avg1);
 	bool fine_tune(size_t span, int16_t centerVal0, int16_t centerVal1,
 		size_t num_samples);
 
@@ -94,6 +110,8 @@ private:
 	void dacAOutputDC(int16_t value);
 	void dacBOutputDC(int16_t value);
 	void configHwSamplerate();
+	QString cacheGroup() const;
+	QString firmwareVersion() const;
 
 	ApiObject *m_api;
 	bool m_cancel;
@@ -123,6 +141,12 @@ private:
 	struct iio_buffer *m_dac_a_buffer;
 	struct iio_buffer *m_dac_b_buffer;
 
+	// Capture buffer, kept between the captures of a calibration
+	struct iio_buffer *m_adc_buffer;
+	size_t m_adc_buffer_size;
+	bool m_adc_buffer_ch0;
+	bool m_adc_buffer_ch1;
+
 	int m_adc_ch0_offset;
 	int m_adc_ch1_offset;
 	int m_dac_a_ch_offset;
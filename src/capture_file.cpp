@@ -0,0 +1,290 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <cstring>
+
+/* Qt includes */
+#include <QByteArray>
+#include <QtEndian>
+
+/* Local includes */
+#include "capture_file.hpp"
+
+using namespace adiscope;
+
+const char CaptureFile::magic[8] = { 'S', 'C', 'O', 'P', 'Y', 'C', 'A', 'P' };
+const quint32 CaptureFile::version = 1;
+const unsigned int CaptureFile::payloadAlignment = 64;
+const unsigned int CaptureFile::payloadPadding = 8;
+
+static const qint64 sampleCountOffset = 48;
+static const int fixedHeaderSize = 56;
+
+template<typename T>
+static void put(QByteArray& dst, T value)
+{
+	T le = qToLittleEndian(value);
+	dst.append((const char *)&le, sizeof(le));
+}
+
+static void put(QByteArray& dst, double value)
+{
+	quint64 raw;
+	memcpy(&raw, &value, sizeof(raw));
+	put<quint64>(dst, raw);
+}
+
+static void put(QByteArray& dst, float value)
+{
+	quint32 raw;
+	memcpy(&raw, &value, sizeof(raw));
+	put<quint32>(dst, raw);
+}
+
+template<typename T>
+static T get(const uchar *src)
+{
+	return qFromLittleEndian<T>(src);
+}
+
+static double get_double(const uchar *src)
+{
+	quint64 raw = get<quint64>(src);
+	double value;
+	memcpy(&value, &raw, sizeof(value));
+	return value;
+}
+
+static float get_float(const uchar *src)
+{
+	quint32 raw = get<quint32>(src);
+	float value;
+	memcpy(&value, &raw, sizeof(value));
+	return value;
+}
+
+CaptureFileWriter::CaptureFileWriter() :
+	unit_size(0),
+	sample_count(0),
+	failed(false)
+{
+}
+
+CaptureFileWriter::~CaptureFileWriter()
+{
+	close();
+}
+
+bool CaptureFileWriter::open(const QString& filename,
+		const CaptureFile::Info& info)
+{
+	if (info.unit_size == 0)
+		return false;
+
+	file.setFileName(filename);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	QByteArray header;
+	header.append(CaptureFile::magic, sizeof(CaptureFile::magic));
+	put<quint32>(header, CaptureFile::version);
+	put<quint32>(header, 0); /* header size, filled in below */
+	put<quint32>(header, info.format);
+	put<quint32>(header, info.unit_size);
+	put<quint32>(header, info.channels.size());
+	put<quint32>(header, 0);
+	put(header, info.sample_rate);
+	put<qint64>(header, info.trigger_position);
+	put<quint64>(header, 0); /* sample count, filled in by close() */
+
+	for (const CaptureFile::Channel& ch : info.channels) {
+		QByteArray name = ch.name.toUtf8().left(0xffff);
+
+		put(header, ch.gain);
+		put(header, ch.offset);
+		put<quint16>(header, name.size());
+		header.append(name);
+	}
+
+	const int align = CaptureFile::payloadAlignment;
+	header.append(QByteArray((align - header.size() % align) % align, 0));
+
+	quint32 header_size = qToLittleEndian<quint32>(header.size());
+	memcpy(header.data() + 12, &header_size, sizeof(header_size));
+
+	unit_size = info.unit_size;
+	sample_count = 0;
+	failed = file.write(header) != header.size();
+
+	return !failed;
+}
+
+bool CaptureFileWriter::append(const void *data, quint64 samples)
+{
+	if (!file.isOpen() || failed)
+		return false;
+
+	const qint64 size = samples * unit_size;
+	if (file.write((const char *)data, size) != size) {
+		failed = true;
+		return false;
+	}
+
+	sample_count += samples;
+	return true;
+}
+
+bool CaptureFileWriter::close()
+{
+	if (!file.isOpen())
+		return false;
+
+	// Allow readers to load the last sample as a 64-bit word
+	if (!failed) {
+		QByteArray padding(CaptureFile::payloadPadding, 0);
+		failed = file.write(padding) != padding.size();
+	}
+
+	if (!failed) {
+		quint64 count = qToLittleEndian<quint64>(sample_count);
+		failed = !file.seek(sampleCountOffset) ||
+			file.write((const char *)&count, sizeof(count)) !=
+			sizeof(count);
+	}
+
+	file.close();
+	return !failed;
+}
+
+CaptureFileReader::CaptureFileReader()
+{
+	d_info.format = CaptureFile::LOGIC;
+	d_info.unit_size = 0;
+	d_info.sample_rate = 0;
+	d_info.trigger_position = 0;
+	d_info.sample_count = 0;
+}
+
+bool CaptureFileReader::open(const QString& filename)
+{
+	close();
+
+	std::shared_ptr<QFile> f = std::make_shared<QFile>(filename);
+	if (!f->open(QIODevice::ReadOnly)) {
+		error = f->errorString();
+		return false;
+	}
+
+	const qint64 size = f->size();
+	if (size < fixedHeaderSize) {
+		error = QObject::tr("Not a Scopy capture file");
+		return false;
+	}
+
+	const uchar *map = f->map(0, size);
+	if (!map) {
+		error = f->errorString();
+		return false;
+	}
+
+	if (memcmp(map, CaptureFile::magic, sizeof(CaptureFile::magic))) {
+		error = QObject::tr("Not a Scopy capture file");
+		return false;
+	}
+
+	if (get<quint32>(map + 8) != CaptureFile::version) {
+		error = QObject::tr("Unsupported capture file version");
+		return false;
+	}
+
+	const quint32 header_size = get<quint32>(map + 12);
+	CaptureFile::Info info;
+	info.format = (CaptureFile::SampleFormat)get<quint32>(map + 16);
+	info.unit_size = get<quint32>(map + 20);
+	const quint32 nb_channels = get<quint32>(map + 24);
+	info.sample_rate = get_double(map + 32);
+	info.trigger_position = get<qint64>(map + 40);
+	info.sample_count = get<quint64>(map + sampleCountOffset);
+
+	// Validate the sizes read from the file before trusting them
+	if (info.unit_size == 0 || header_size < fixedHeaderSize ||
+			header_size > size ||
+			nb_channels > (header_size - fixedHeaderSize) / 10 ||
+			(quint64)(size - header_size) <
+			CaptureFile::payloadPadding ||
+			info.sample_count > ((quint64)(size - header_size) -
+			CaptureFile::payloadPadding) / info.unit_size) {
+		error = QObject::tr("Corrupted capture file");
+		return false;
+	}
+
+	qint64 pos = fixedHeaderSize;
+	for (quint32 i = 0; i < nb_channels; i++) {
+		if (pos + 10 > header_size)
+			break;
+
+		CaptureFile::Channel ch;
+		ch.gain = get_float(map + pos);
+		ch.offset = get_float(map + pos + 4);
+		const quint16 len = get<quint16>(map + pos + 8);
+		pos += 10;
+
+		if (pos + len > header_size)
+			break;
+
+		ch.name = QString::fromUtf8((const char *)map + pos, len);
+		pos += len;
+		info.channels.push_back(ch);
+	}
+
+	if (info.channels.size() != nb_channels) {
+		error = QObject::tr("Corrupted capture file");
+		return false;
+	}
+
+	d_info = info;
+	file = f;
+
+	// The payload pointer shares the ownership of the mapped file
+	d_payload = std::shared_ptr<const uint8_t>(file, map + header_size);
+
+	return true;
+}
+
+void CaptureFileReader::close()
+{
+	d_payload.reset();
+	file.reset();
+	error.clear();
+}
+
+const CaptureFile::Info& CaptureFileReader::info() const
+{
+	return d_info;
+}
+
+std::shared_ptr<const uint8_t> CaptureFileReader::payload() const
+{
+	return d_payload;
+}
+
+QString CaptureFileReader::errorString() const
+{
+	return error;
+}
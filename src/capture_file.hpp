@@ -0,0 +1,137 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef CAPTURE_FILE_HPP
+#define CAPTURE_FILE_HPP
+
+#include <memory>
+#include <vector>
+
+/* Qt includes */
+#include <QFile>
+#include <QString>
+
+namespace adiscope {
+
+/*
+ * Scopy binary capture file (*.scap)
+ *
+ * All the fields are little endian.
+ *
+ *  offset  size  field
+ *       0     8  magic "SCOPYCAP"
+ *       8     4  version
+ *      12     4  header size = offset of the payload
+ *      16     4  sample format (CaptureFile::SampleFormat)
+ *      20     4  unit size = bytes per sample of all the channels
+ *      24     4  number of channels
+ *      28     4  reserved
+ *      32     8  sample rate (double)
+ *      40     8  trigger position, in samples (int64)
+ *      48     8  number of samples (uint64)
+ *      56        for each channel: gain (float), offset (float),
+ *                name length (uint16), name (UTF-8)
+ *
+ * The payload starts on a 64 byte boundary and holds the samples of all
+ * the channels interleaved: packed bits for logic captures, one int16 or
+ * float32 per channel for analog ones. A physical value is obtained as
+ * raw * gain + offset. The payload is followed by 8 bytes of padding.
+ */
+class CaptureFile
+{
+public:
+	enum SampleFormat {
+		LOGIC = 0,
+		INT16 = 1,
+		FLOAT32 = 2,
+	};
+
+	struct Channel {
+		QString name;
+		float gain;
+		float offset;
+	};
+
+	struct Info {
+		SampleFormat format;
+		unsigned int unit_size;
+		double sample_rate;
+		qint64 trigger_position;
+		quint64 sample_count;
+		std::vector<Channel> channels;
+	};
+
+	static const char magic[8];
+	static const quint32 version;
+	static const unsigned int payloadAlignment;
+	static const unsigned int payloadPadding;
+};
+
+/*
+ * Streams samples to a capture file. The number of samples is written
+ * in the header when the file is closed.
+ */
+class CaptureFileWriter
+{
+public:
+	CaptureFileWriter();
+	~CaptureFileWriter();
+
+	bool open(const QString& filename, const CaptureFile::Info& info);
+	bool append(const void *data, quint64 samples);
+	bool close();
+
+private:
+	QFile file;
+	unsigned int unit_size;
+	quint64 sample_count;
+	bool failed;
+};
+
+/*
+ * Maps a capture file in memory. The payload is not read until it is
+ * accessed, so files of any size open instantly.
+ */
+class CaptureFileReader
+{
+public:
+	CaptureFileReader();
+
+	bool open(const QString& filename);
+	void close();
+
+	const CaptureFile::Info& info() const;
+
+	/*
+	 * The samples. The returned pointer keeps the file mapped, even
+	 * after the reader is closed or destroyed.
+	 */
+	std::shared_ptr<const uint8_t> payload() const;
+
+	QString errorString() const;
+
+private:
+	CaptureFile::Info d_info;
+	std::shared_ptr<QFile> file;
+	std::shared_ptr<const uint8_t> d_payload;
+	QString error;
+};
+}
+
+#endif /* CAPTURE_FILE_HPP */
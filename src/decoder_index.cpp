@@ -0,0 +1,243 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+#include <mutex>
+
+/* Qt includes */
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+/* Local includes */
+#include "decoder_index.hpp"
+#include "libsigrokdecode/libsigrokdecode.h"
+
+using namespace adiscope;
+
+namespace {
+
+const quint32 indexVersion = 1;
+
+std::mutex lock;
+std::vector<DecoderIndex::Decoder> decoder_index;
+
+template<typename T, typename F>
+QStringList names(const GSList *list, F name)
+{
+	QStringList out;
+
+	for (const GSList *l = list; l; l = l->next)
+		out << QString::fromUtf8(name((const T *)l->data));
+
+	return out;
+}
+
+}
+
+namespace adiscope {
+
+static QDataStream& operator<<(QDataStream& stream,
+		const DecoderIndex::Decoder& d)
+{
+	return stream << d.id << d.name << d.longname << d.channels
+		<< d.opt_channels << d.options << d.annotation_rows;
+}
+
+static QDataStream& operator>>(QDataStream& stream, DecoderIndex::Decoder& d)
+{
+	return stream >> d.id >> d.name >> d.longname >> d.channels
+		>> d.opt_channels >> d.options >> d.annotation_rows;
+}
+}
+
+bool DecoderIndex::load(const QString& path)
+{
+	const QByteArray k = key(path);
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (read(k))
+		return true;
+
+	qDebug() << "Building the decoder index of" << path;
+	return build(k);
+}
+
+const std::vector<DecoderIndex::Decoder>& DecoderIndex::decoders()
+{
+	return decoder_index;
+}
+
+const DecoderIndex::Decoder *DecoderIndex::find(const QString& name)
+{
+	for (const Decoder& d : decoder_index) {
+		if (d.name == name)
+			return &d;
+	}
+
+	return nullptr;
+}
+
+const srd_decoder *DecoderIndex::decoder(const QString& id)
+{
+	const QByteArray str = id.toUtf8();
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	const srd_decoder *d = srd_decoder_get_by_id(str.constData());
+
+	if (!d) {
+		if (srd_decoder_load(str.constData()) != SRD_OK) {
+			qDebug() << "ERROR: could not load decoder" << id;
+			return nullptr;
+		}
+
+		d = srd_decoder_get_by_id(str.constData());
+	}
+
+	return d;
+}
+
+const srd_decoder *DecoderIndex::loaded(const QString& id)
+{
+	// An import in progress holds the lock, the decoder isn't ready
+	std::unique_lock<std::mutex> guard(lock, std::try_to_lock);
+
+	if (!guard.owns_lock())
+		return nullptr;
+
+	return srd_decoder_get_by_id(id.toUtf8().constData());
+}
+
+QString DecoderIndex::cacheFile()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+		"/decoders.index";
+}
+
+QByteArray DecoderIndex::key(const QString& path)
+{
+	// The modification time of a directory doesn't change when a file
+	// in it is rewritten in place, so look at the modules themselves
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	QDir dir(path);
+
+	for (const QFileInfo& sub : dir.entryInfoList(
+			QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name)) {
+		for (const QFileInfo& info : QDir(sub.filePath()).entryInfoList(
+				QStringList() << "*.py", QDir::Files, QDir::Name)) {
+			hash.addData(sub.fileName().toUtf8() + '/' +
+				info.fileName().toUtf8() + ' ' +
+				QByteArray::number(info.lastModified()
+					.toMSecsSinceEpoch()) + ' ' +
+				QByteArray::number(info.size()) + '\n');
+		}
+	}
+
+	return dir.absolutePath().toUtf8() + '\n' + hash.result().toHex() +
+		'\n' + srd_lib_version_string_get();
+}
+
+bool DecoderIndex::read(const QByteArray& key)
+{
+	QFile file(cacheFile());
+
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream stream(&file);
+	quint32 version;
+	QByteArray k;
+	std::vector<Decoder> decoders;
+	quint32 count;
+
+	stream >> version;
+	if (version != indexVersion)
+		return false;
+
+	stream >> k >> count;
+	if (k != key || stream.status() != QDataStream::Ok || count > 10000)
+		return false;
+
+	decoders.resize(count);
+	for (Decoder& d : decoders)
+		stream >> d;
+
+	if (stream.status() != QDataStream::Ok)
+		return false;
+
+	decoder_index.swap(decoders);
+	return true;
+}
+
+bool DecoderIndex::build(const QByteArray& key)
+{
+	if (srd_decoder_load_all() != SRD_OK)
+		return false;
+
+	std::vector<Decoder> decoders;
+
+	for (const GSList *l = srd_decoder_list(); l; l = l->next) {
+		const srd_decoder *const dec = (const srd_decoder *)l->data;
+		Decoder d;
+
+		d.id = QString::fromUtf8(dec->id);
+		d.name = QString::fromUtf8(dec->name);
+		d.longname = QString::fromUtf8(dec->longname);
+		d.channels = names<srd_channel>(dec->channels,
+			[](const srd_channel *ch) { return ch->name; });
+		d.opt_channels = names<srd_channel>(dec->opt_channels,
+			[](const srd_channel *ch) { return ch->name; });
+		d.options = names<srd_decoder_option>(dec->options,
+			[](const srd_decoder_option *opt) { return opt->id; });
+		d.annotation_rows = names<srd_decoder_annotation_row>(
+			dec->annotation_rows,
+			[](const srd_decoder_annotation_row *row) {
+				return row->desc; });
+
+		decoders.push_back(d);
+	}
+
+	std::sort(decoders.begin(), decoders.end(),
+		[](const Decoder& a, const Decoder& b) {
+			return a.name < b.name; });
+
+	decoder_index.swap(decoders);
+
+	// A stale index is only a slower startup, failing to save it is fine
+	QDir().mkpath(QFileInfo(cacheFile()).absolutePath());
+	QFile file(cacheFile());
+
+	if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		QDataStream stream(&file);
+
+		stream << indexVersion << key << (quint32)decoder_index.size();
+		for (const Decoder& d : decoder_index)
+			stream << d;
+	}
+
+	return true;
+}
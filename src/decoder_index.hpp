@@ -0,0 +1,87 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef DECODER_INDEX_HPP
+#define DECODER_INDEX_HPP
+
+#include <vector>
+
+/* Qt includes */
+#include <QString>
+#include <QStringList>
+
+struct srd_decoder;
+
+namespace adiscope {
+
+/*
+ * Describes the protocol decoders without importing their Python modules.
+ *
+ * Importing every decoder takes most of the time needed to load them, while
+ * only a few of them are ever used. The id, name, channels, options and
+ * annotation rows of all the decoders are saved to an index in the cache
+ * directory, which is used as long as the decoder directory, the modules
+ * of its decoders (names, sizes and modification times) and the
+ * libsigrokdecode version did not change. The modules themselves are
+ * imported when a decoder is first used.
+ */
+class DecoderIndex
+{
+public:
+	struct Decoder {
+		QString id;
+		QString name;
+		QString longname;
+		QStringList channels;
+		QStringList opt_channels;
+		QStringList options;
+		QStringList annotation_rows;
+	};
+
+	/*
+	 * Reads the index of the decoders in @path, or imports all of them
+	 * to build it when the cached one is out of date. Must be called
+	 * after srd_init().
+	 */
+	static bool load(const QString& path);
+
+	/* All the decoders, sorted by name */
+	static const std::vector<Decoder>& decoders();
+	static const Decoder *find(const QString& name);
+
+	/*
+	 * Returns the decoder with the given id, importing it if needed.
+	 * Importing takes a while, the GUI should call it from another
+	 * thread unless loaded() already returns the decoder.
+	 */
+	static const srd_decoder *decoder(const QString& id);
+
+	/* Returns the decoder with the given id if it is already imported */
+	static const srd_decoder *loaded(const QString& id);
+
+private:
+	static QString cacheFile();
+	static QByteArray key(const QString& path);
+	static bool read(const QByteArray& key);
+	static bool build(const QByteArray& key);
+};
+}
+
+#endif /* DECODER_INDEX_HPP */
@@ -23,23 +23,19 @@
 #include <config.h>
 #include "osc_adc.h"
 #include "hardware_trigger.hpp"
-
-#include <gnuradio/blocks/keep_one_in_n.h>
-#include <gnuradio/blocks/moving_average_ff.h>
-#include <gnuradio/blocks/rms_ff.h>
-#include <gnuradio/blocks/short_to_float.h>
-#include <gnuradio/blocks/sub_ff.h>
-#include <gnuradio/filter/dc_blocker_ff.h>
+#include "dmm_engine.hpp"
+#include "dmm_logger.hpp"
+#include "iio_attr_cache.hpp"
 
 #include <boost/make_shared.hpp>
 
+#include <algorithm>
 #include <memory>
 #include <QDateTime>
+#include <QDebug>
 #include <QFile>
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QTextStream>
-#include <QThread>
 #include <QJSEngine>
 
 using namespace adiscope;
@@ -51,10 +47,13 @@ DMM::DMM(struct iio_context *ctx, Filter *filt, std::shared_ptr<GenericAdc> adc,
 	manager(iio_manager::get_instance(ctx, filt->device_name(TOOL_DMM))),
 	adc(adc),
 	data_logging(false),
-	interrupt_data_logging(false),
 	filename(""),
 	use_timer(false),
-	logging_refresh_rate(0)
+	logging_refresh_rate(0),
+	logger(boost::make_shared<dmm_logger>()),
+	logging_max_size(0),
+	logging_max_duration(0),
+	aperture(default_aperture)
 {
 	ui->setupUi(this);
 
@@ -137,8 +136,8 @@ DMM::DMM(struct iio_context *ctx, Filter *filt, std::shared_ptr<GenericAdc> adc,
 
 	configureModes();
 
-	connect(&*signal, SIGNAL(triggered(std::vector<float>)),
-			this, SLOT(updateValuesList(std::vector<float>)));
+	connect(&*signal, SIGNAL(ready()), this, SLOT(updateValuesList()),
+			Qt::QueuedConnection);
 
 	if (started)
 		manager->unlock();
@@ -177,13 +176,26 @@ DMM::~DMM()
 	delete ui;
 }
 
-void DMM::updateValuesList(std::vector<float> values)
+void DMM::updateValuesList()
 {
-	if(!use_timer)
-		boost::unique_lock<boost::mutex> lock(data_mutex);
+	signal_sample_values values;
+
+	if (!signal->fetch(values) || values.latest.size() < 4)
+		return;
 
-	double volts_ch1 = adc->convSampleToVolts(0, (double) values[0]);
-	double volts_ch2 = adc->convSampleToVolts(1, (double) values[1]);
+	/* Each engine gives the DC mean, then the AC RMS */
+	bool is_ac_ch1 = ui->btn_ch1_ac->isChecked() ||
+		ui->btn_ch1_ac2->isChecked();
+	bool is_ac_ch2 = ui->btn_ch2_ac->isChecked() ||
+		ui->btn_ch2_ac2->isChecked();
+
+	/* The RMS is relative to the mean, so only the scale applies */
+	double volts_ch1 = is_ac_ch1 ?
+		adc->convSampleDiffToVoltsDiff(0, (double) values.latest[1]) :
+		adc->convSampleToVolts(0, (double) values.latest[0]);
+	double volts_ch2 = is_ac_ch2 ?
+		adc->convSampleDiffToVoltsDiff(1, (double) values.latest[3]) :
+		adc->convSampleToVolts(1, (double) values.latest[2]);
 
 	ui->lcdCh1->display(volts_ch1);
 	ui->lcdCh2->display(volts_ch2);
@@ -193,9 +205,6 @@ void DMM::updateValuesList(std::vector<float> values)
 
 	ui->sismograph_ch1->plot(volts_ch1);
 	ui->sismograph_ch2->plot(volts_ch2);
-
-	if(!use_timer)
-		data_cond.notify_all();
 }
 
 void DMM::toggleTimer(bool start)
@@ -218,76 +227,47 @@ void DMM::toggleTimer(bool start)
 	setDynamicProperty(ui->run_button, "running", start);
 }
 
-gr::basic_block_sptr DMM::configureGraph(gr::basic_block_sptr s2f,
-		bool is_low_ac, bool is_high_ac)
+void DMM::configureModes()
 {
-	/* 10 fps refresh rate for the plot */
-	auto keep_one = gr::blocks::keep_one_in_n::make(sizeof(float),
-			is_high_ac ? (sample_rate / 100.0) : 1000.0);
+	bool is_low_ac_ch1 = ui->btn_ch1_ac->isChecked();
+	bool is_low_ac_ch2 = ui->btn_ch2_ac->isChecked();
 
-	/* TODO: figure out best value for the blocker parameter */
-	auto blocker = gr::filter::dc_blocker_ff::make(1000, true);
+	/* Low-frequency AC: average by blocks down to 10 kSPS */
+	unsigned int low_ac_decimation = sample_rate / 1e4;
 
-	manager->connect(s2f, 0, blocker, 0);
+	engine_ch1 = boost::make_shared<dmm_engine>(sample_rate, aperture,
+			is_low_ac_ch1 ? low_ac_decimation : 1);
+	engine_ch2 = boost::make_shared<dmm_engine>(sample_rate, aperture,
+			is_low_ac_ch2 ? low_ac_decimation : 1);
 
-	if (is_low_ac || is_high_ac) {
-		/* TODO: figure out best value for the RMS parameter */
-		auto rms = gr::blocks::rms_ff::make(0.0001);
-		manager->connect(blocker, 0, rms, 0);
+	id_ch1 = manager->connect(engine_ch1, 0, 0, false, sample_rate / 10);
+	id_ch2 = manager->connect(engine_ch2, 1, 0, false, sample_rate / 10);
 
-		manager->connect(rms, 0, keep_one, 0);
-	} else {
-		auto sub = gr::blocks::sub_ff::make();
+	writeAllSettingsToHardware();
 
-		manager->connect(s2f, 0, sub, 0);
-		manager->connect(blocker, 0, sub, 1);
-		manager->connect(sub, 0, keep_one, 0);
-	}
+	manager->connect(engine_ch1, 0, signal, 0);
+	manager->connect(engine_ch1, 1, signal, 1);
+	manager->connect(engine_ch2, 0, signal, 2);
+	manager->connect(engine_ch2, 1, signal, 3);
 
-	return keep_one;
+	manager->connect(engine_ch1, 0, logger, 0);
+	manager->connect(engine_ch1, 1, logger, 1);
+	manager->connect(engine_ch2, 0, logger, 2);
+	manager->connect(engine_ch2, 1, logger, 3);
 }
 
-void DMM::configureModes()
+void DMM::setAperture(double value)
 {
-	auto s2f1 = gr::blocks::short_to_float::make();
-	auto s2f2 = gr::blocks::short_to_float::make();
-
-	bool is_low_ac_ch1 = ui->btn_ch1_ac->isChecked();
-	bool is_low_ac_ch2 = ui->btn_ch2_ac->isChecked();
-	bool is_high_ac_ch1 = ui->btn_ch1_ac2->isChecked();
-	bool is_high_ac_ch2 = ui->btn_ch2_ac2->isChecked();
-
-	if (is_high_ac_ch1) {
-		id_ch1 = manager->connect(s2f1, 0, 0, false, sample_rate / 10);
-	} else {
-		/* Low-frequency AC: decimate data rate */
-		auto keep_one1 = gr::blocks::keep_one_in_n::make(
-				sizeof(short), sample_rate / 1e4);
-		id_ch1 = manager->connect(keep_one1, 0, 0, false,
-				sample_rate / 10);
+	aperture = std::min(std::max(value, 1.0 / sample_rate),
+			dmm_engine::max_aperture);
 
-		manager->connect(keep_one1, 0, s2f1, 0);
-	}
-
-	if (is_high_ac_ch2) {
-		id_ch2 = manager->connect(s2f2, 1, 0, false, sample_rate / 10);
-	} else {
-		/* Low-frequency AC: decimate data rate */
-		auto keep_one2 = gr::blocks::keep_one_in_n::make(
-				sizeof(short), sample_rate / 1e4);
-		id_ch2 = manager->connect(keep_one2, 1, 0, false,
-				sample_rate / 10);
-
-		manager->connect(keep_one2, 0, s2f2, 0);
-	}
-
-	auto block1 = configureGraph(s2f1, is_low_ac_ch1, is_high_ac_ch1);
-	auto block2 = configureGraph(s2f2, is_low_ac_ch2, is_high_ac_ch2);
-
-	writeAllSettingsToHardware();
+	engine_ch1->set_aperture(aperture);
+	engine_ch2->set_aperture(aperture);
+}
 
-	manager->connect(block1, 0, signal, 0);
-	manager->connect(block2, 0, signal, 1);
+double DMM::readingRate() const
+{
+	return engine_ch1->reading_rate();
 }
 
 void DMM::chooseFile()
@@ -295,7 +275,8 @@ void DMM::chooseFile()
 	QString selectedFilter;
 	filename = QFileDialog::getSaveFileName(this,
 		tr("Scopy DMM data logging"), "",
-		tr("Comma-separated values files (*.csv);;All Files(*)"),
+		tr("Comma-separated values files (*.csv);;"
+			"Binary files (*.bin);;All Files(*)"),
 		&selectedFilter);
 	ui->filename->setText(filename);
 	if(!ui->run_button->isChecked()) {
@@ -324,47 +305,16 @@ void DMM::toggleDataLogging(bool en)
 		ui->btn_append->setEnabled(false);
 	}
 
-	if(en) {
-		QFile file(filename);
-
-		if(ui->btn_overwrite->isChecked() || file.size() == 0) {
-			if( !file.open(QIODevice::WriteOnly)) {
-				return;
-			}
-			QTextStream out(&file);
-
-			/* Write the header */
-			out << ";Generated by Scopy-" << QString(SCOPY_VERSION_GIT) << "\n" <<
-			       ";Started on " <<  QDateTime::currentDateTime().toString() << "\n";
-			out << "Timestamp,Channel_0_DC_RMS,Channel_0_AC_RMS,Channel_1_DC_RMS,Channel_1_AC_RMS\n";
-
-			file.close();
-		}
-	}
-	else {
+	if(!en) {
 		ui->btn_overwrite->setEnabled(true);
 		ui->btn_append->setEnabled(true);
 	}
 
-	/* If running, start the thread */
-	if(ui->run_button->isChecked() && en) {
-		if(data_logging_thread.joinable())
-			return;
-
-		interrupt_data_logging = false;
-		data_logging_thread = std::thread(&DMM::dataLoggingThread, this);
-	}
-	else if(!en) {
-		if(!use_timer)
-			data_cond.notify_all();
-		interrupt_data_logging = true;
-		if(data_logging_thread.joinable()) {
-			if(use_timer)
-				data_logging_thread.detach();
-			else
-				data_logging_thread.join();
-		}
-	}
+	/* If running, start the logger */
+	if(ui->run_button->isChecked() && en)
+		startLogger();
+	else if(!en)
+		logger->close();
 }
 
 void DMM::startDataLogging(bool start)
@@ -372,92 +322,48 @@ void DMM::startDataLogging(bool start)
 	if(!data_logging)
 		return;
 
-	toggleDataLogging(data_logging);
 	if(start) {
-		if(filename == "")
-			return;
-		if(data_logging_thread.joinable())
-			return;
-
-		interrupt_data_logging = false;
-		ui->btn_overwrite->setEnabled(false);
-		ui->btn_append->setEnabled(false);
-		data_logging_thread = std::thread(&DMM::dataLoggingThread, this);
-
+		toggleDataLogging(data_logging);
 	}
 	else {
-		if(!use_timer)
-			data_cond.notify_all();
-		interrupt_data_logging = true;
-		if(data_logging_thread.joinable()) {
-			if(use_timer)
-				data_logging_thread.detach();
-			else
-				data_logging_thread.join();
-		}
+		logger->close();
 		ui->btn_overwrite->setEnabled(true);
 		ui->btn_append->setEnabled(true);
 	}
 }
 
-void DMM::dataLoggingThread()
+void DMM::startLogger()
 {
-	QString separator = ",";
-	QFile file(filename);
-	if( !file.open(QIODevice::Append)) {
+	if(logger->is_open())
 		return;
-	}
-
-	QTextStream out(&file);
-
-	while(!interrupt_data_logging) {
-		if(use_timer && !file.isOpen()) {
-			if( !file.open(QIODevice::Append)) {
-				return;
-			}
-		}
-		bool is_low_ac_ch1 = ui->btn_ch1_ac->isChecked();
-		bool is_low_ac_ch2 = ui->btn_ch2_ac->isChecked();
-		bool is_high_ac_ch1 = ui->btn_ch1_ac2->isChecked();
-		bool is_high_ac_ch2 = ui->btn_ch2_ac2->isChecked();
-		QString ch1_dc_rms="-", ch2_dc_rms="-", ch1_ac_rms="-", ch2_ac_rms="-";
-
-		out << QDateTime::currentDateTime().time().toString() << separator;
-
-		if(!use_timer) {
-			boost::unique_lock<boost::mutex> lock(data_mutex);
-			data_cond.wait(lock);
-		}
-
-
-		if(!is_low_ac_ch1 && !is_high_ac_ch1) {
-			ch1_dc_rms = QString::number(ui->lcdCh1->value());
-		}
-		else {
-			ch1_ac_rms = QString::number(ui->lcdCh1->value());
-		}
 
+	dmm_logger::Settings logging;
+	logging.filename = filename;
+	logging.format = filename.endsWith(".bin", Qt::CaseInsensitive) ?
+		dmm_logger::BINARY : dmm_logger::CSV;
+	logging.append = ui->btn_append->isChecked();
+	logging.rate = engine_ch1->reading_rate();
+	logging.interval = use_timer ? logging_refresh_rate / 1000.0 : 0.0;
+	logging.max_size = logging_max_size;
+	logging.max_duration = logging_max_duration;
+
+	/* The engines give raw ADC codes, converted linearly to volts */
+	for (uint i = 0; i < 2; i++) {
+		double offset = adc->convSampleToVolts(i, 0.0);
+		double scale = adc->convSampleDiffToVoltsDiff(i, 1.0);
+		QString name = "Channel_" + QString::number(i);
+
+		logging.columns.push_back({ name + "_DC_RMS",
+				(float) scale, (float) offset });
+		logging.columns.push_back({ name + "_AC_RMS",
+				(float) scale, 0.0f });
+	}
 
-		if(!is_low_ac_ch2 && !is_high_ac_ch2) {
-			ch2_dc_rms = QString::number(ui->lcdCh2->value());
-		}
-		else {
-			ch2_ac_rms = QString::number(ui->lcdCh2->value());
-		}
-
-		/* Write the values to file */
-		out <<  ch1_dc_rms << separator <<
-			ch1_ac_rms << separator <<
-			ch2_dc_rms << separator <<
-			ch2_ac_rms << "\n";
-
-		if(use_timer) {
-			file.close();
-			QThread::msleep(logging_refresh_rate);
-		}
+	if(!logger->open(logging)) {
+		qDebug() << "Could not start data logging:" <<
+			logger->errorString();
+		setDynamicProperty(ui->filename, "invalid", true);
 	}
-	if(file.isOpen())
-		file.close();
 }
 
 void DMM::toggleAC()
@@ -517,8 +423,8 @@ void DMM::writeAllSettingsToHardware()
 			m2k_adc->setChnHwGainMode(i, M2kAdc::LOW_GAIN_MODE);
 		}
 
-		iio_device_attr_write_longlong(adc->iio_adc_dev(),
-			"oversampling_ratio", 1);
+		IioAttrCache::write(adc->iio_adc_dev(),
+			"oversampling_ratio", 1LL);
 	}
 
 	auto trigger = adc->getTrigger();
@@ -558,6 +464,46 @@ void DMM_API::run(bool en)
 	dmm->ui->run_button->setChecked(en);
 }
 
+double DMM_API::get_aperture() const
+{
+	return dmm->aperture;
+}
+
+void DMM_API::set_aperture(double value)
+{
+	dmm->setAperture(value);
+}
+
+double DMM_API::reading_rate() const
+{
+	return dmm->readingRate();
+}
+
+qint64 DMM_API::get_logging_max_file_size() const
+{
+	return dmm->logging_max_size;
+}
+
+void DMM_API::set_logging_max_file_size(qint64 size)
+{
+	dmm->logging_max_size = std::max<qint64>(size, 0);
+}
+
+double DMM_API::get_logging_max_file_duration() const
+{
+	return dmm->logging_max_duration;
+}
+
+void DMM_API::set_logging_max_file_duration(double seconds)
+{
+	dmm->logging_max_duration = std::max(seconds, 0.0);
+}
+
+int DMM_API::logging_dropped() const
+{
+	return dmm->logger->dropped();
+}
+
 double DMM_API::read_ch1() const
 {
 	return dmm->ui->lcdCh1->value();
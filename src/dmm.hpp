@@ -30,10 +30,7 @@
 #include "signal_sample.hpp"
 #include "tool.hpp"
 #include "scroll_filter.hpp"
-#include <thread>
 #include "spinbox_a.hpp"
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/condition_variable.hpp>
 
 namespace Ui {
 	class DMM;
@@ -43,6 +40,8 @@ class QJSEngine;
 
 namespace adiscope {
 	class DMM_API;
+	class dmm_engine;
+	class dmm_logger;
 	class GenericAdc;
 
 	class DMM : public Tool
@@ -65,26 +64,32 @@ namespace adiscope {
 		iio_manager::port_id id_ch1, id_ch2;
 		std::shared_ptr<GenericAdc> adc;
 		boost::shared_ptr<signal_sample> signal;
+		boost::shared_ptr<dmm_engine> engine_ch1, engine_ch2;
 		unsigned long sample_rate;
 
-		std::atomic<bool> interrupt_data_logging;
+		/* Integration time of the readings, in seconds. The default
+		 * is a whole number of cycles of both 50 Hz and 60 Hz. */
+		static constexpr double default_aperture = 0.1;
+		double aperture;
+
 		std::atomic<bool> data_logging;
 		QString filename;
-		std::thread data_logging_thread;
 		bool use_timer;
 		unsigned long logging_refresh_rate;
 		PositionSpinButton *data_logging_timer;
 
-		boost::mutex data_mutex;
-		boost::condition_variable data_cond;
+		boost::shared_ptr<dmm_logger> logger;
+		qint64 logging_max_size;
+		double logging_max_duration;
 		MouseWheelWidgetGuard *wheelEventGuard;
 
 		void disconnectAll();
-		gr::basic_block_sptr configureGraph(gr::basic_block_sptr s2f,
-				bool is_low_ac, bool is_high_ac);
 		void configureModes();
+		void setAperture(double value);
+		double readingRate() const;
 		int numSamplesFromIdx(int idx);
 		void writeAllSettingsToHardware();
+		void startLogger();
 
 	public Q_SLOTS:
 		void toggleTimer(bool start);
@@ -93,7 +98,7 @@ namespace adiscope {
 		void setHistorySizeCh1(int idx);
 		void setHistorySizeCh2(int idx);
 
-		void updateValuesList(std::vector<float> values);
+		void updateValuesList();
 
 		void toggleAC();
 
@@ -101,8 +106,6 @@ namespace adiscope {
 
 		void startDataLogging(bool);
 
-		void dataLoggingThread();
-
 		void chooseFile();
 	};
 
@@ -132,6 +135,19 @@ namespace adiscope {
 				READ get_history_ch2_size_idx
 				WRITE set_history_ch2_size_idx);
 
+		Q_PROPERTY(double aperture
+				READ get_aperture WRITE set_aperture);
+		Q_PROPERTY(double reading_rate READ reading_rate STORED false);
+
+		Q_PROPERTY(qint64 logging_max_file_size
+				READ get_logging_max_file_size
+				WRITE set_logging_max_file_size);
+		Q_PROPERTY(double logging_max_file_duration
+				READ get_logging_max_file_duration
+				WRITE set_logging_max_file_duration);
+		Q_PROPERTY(int logging_dropped
+				READ logging_dropped STORED false);
+
 		Q_PROPERTY(double value_ch1 READ read_ch1);
 		Q_PROPERTY(double value_ch2 READ read_ch2);
 
@@ -151,6 +167,16 @@ namespace adiscope {
 		void set_history_ch1_size_idx(int idx);
 		void set_history_ch2_size_idx(int idx);
 
+		double get_aperture() const;
+		void set_aperture(double value);
+		double reading_rate() const;
+
+		qint64 get_logging_max_file_size() const;
+		void set_logging_max_file_size(qint64 size);
+		double get_logging_max_file_duration() const;
+		void set_logging_max_file_duration(double seconds);
+		int logging_dropped() const;
+
 		double read_ch1() const;
 		double read_ch2() const;
 
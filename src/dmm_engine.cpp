@@ -0,0 +1,168 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+
+#include "dmm_engine.hpp"
+
+using namespace adiscope;
+
+/* Keeps the sums of squares of the raw samples within 64 bits */
+const double dmm_engine::max_aperture = 10.0;
+const unsigned int dmm_engine::max_decimation = 100;
+
+/* Minimum hysteresis of the crossing detector, in ADC codes */
+static const int32_t min_hysteresis = 8;
+
+dmm_engine::dmm_engine(double sample_rate, double aperture,
+		unsigned int decimation) :
+	gr::block("dmm_engine",
+			gr::io_signature::make(1, 1, sizeof(short)),
+			gr::io_signature::make(2, 2, sizeof(float))),
+	sample_rate(sample_rate),
+	d_decimation(std::min(std::max(decimation, 1u), max_decimation)),
+	aperture_samples(0),
+	dec_sum(0), dec_count(0),
+	length(1), crossings(0), below(false),
+	center(0), hysteresis(min_hysteresis * d_decimation)
+{
+	set_aperture(aperture);
+	begin_aperture();
+}
+
+dmm_engine::~dmm_engine()
+{
+}
+
+void dmm_engine::set_aperture(double aperture)
+{
+	aperture = std::min(std::max(aperture, 0.0), max_aperture);
+
+	/* Takes effect with the next reading */
+	aperture_samples = std::max<uint64_t>(
+			(uint64_t) std::llround(aperture * sample_rate),
+			d_decimation);
+}
+
+double dmm_engine::aperture() const
+{
+	return aperture_samples / sample_rate;
+}
+
+double dmm_engine::reading_rate() const
+{
+	uint64_t samples = aperture_samples / d_decimation * d_decimation;
+
+	return sample_rate / samples;
+}
+
+unsigned int dmm_engine::decimation() const
+{
+	return d_decimation;
+}
+
+void dmm_engine::begin_aperture()
+{
+	acc = { 0, 0, 0 };
+	first = last = acc;
+	crossings = 0;
+	length = aperture_samples / d_decimation * d_decimation;
+}
+
+void dmm_engine::end_aperture(float *mean, float *rms)
+{
+	sums window = acc;
+
+	/* Whole periods, from the first to the last rising crossing */
+	if (crossings >= 2) {
+		window.s1 = last.s1 - first.s1;
+		window.s2 = last.s2 - first.s2;
+		window.n = last.n - first.n;
+	}
+
+	const double m = (double) window.s1 / window.n;
+	const double var = std::max((double) window.s2 / window.n - m * m, 0.0);
+	const double ac = std::sqrt(var);
+
+	*mean = center + m;
+	*rms = ac;
+
+	center = (int32_t) std::lround(center + m);
+	hysteresis = (int32_t) d_decimation *
+		std::max((int32_t) (ac / 4), min_hysteresis);
+}
+
+void dmm_engine::forecast(int noutput_items,
+		gr_vector_int &ninput_items_required)
+{
+	/* Readings come out whenever an aperture completes */
+	ninput_items_required[0] = 1;
+}
+
+int dmm_engine::general_work(int noutput_items,
+		gr_vector_int &ninput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	const short *in = (const short *) input_items[0];
+	float *mean_out = (float *) output_items[0];
+	float *rms_out = (float *) output_items[1];
+	const int nb_items = ninput_items[0];
+	int consumed = 0, produced = 0;
+
+	while (consumed < nb_items && produced < noutput_items) {
+		const int32_t x = in[consumed++] - center;
+
+		/* The RMS sees the whole bandwidth of the raw samples */
+		acc.s1 += x;
+		acc.s2 += (int64_t) x * x;
+		acc.n++;
+
+		dec_sum += x;
+
+		if (++dec_count < d_decimation)
+			continue;
+
+		/* Only the crossing detector runs on the decimated samples */
+		const int32_t y = dec_sum;
+		dec_sum = 0;
+		dec_count = 0;
+
+		if (y < -hysteresis) {
+			below = true;
+		} else if (below && y > hysteresis) {
+			below = false;
+
+			if (!crossings++)
+				first = acc;
+			last = acc;
+		}
+
+		if (acc.n == length) {
+			end_aperture(&mean_out[produced], &rms_out[produced]);
+			produced++;
+			begin_aperture();
+		}
+	}
+
+	consume_each(consumed);
+	return produced;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef DMM_ENGINE_HPP
+#define DMM_ENGINE_HPP
+
+#include <atomic>
+
+#include <gnuradio/block.h>
+
+namespace adiscope {
+	/*
+	 * DMM measurement block. Takes the raw samples of one ADC channel
+	 * and produces one reading per aperture: the DC mean on output 0
+	 * and the true RMS of the AC part on output 1, both in ADC codes.
+	 *
+	 * The readings integrate the raw samples over the aperture, so the
+	 * RMS keeps the whole bandwidth of the input; an aperture of a whole
+	 * number of mains cycles (NPLC) rejects the line frequency and its
+	 * harmonics from the mean.
+	 *
+	 * Rising crossings of the previous mean are tracked, so that the
+	 * mean and the RMS are computed over a whole number of periods of
+	 * the signal when the aperture holds at least one, instead of being
+	 * biased by a partial period. The crossing detector runs on the
+	 * samples averaged by blocks of @decimation (a boxcar, i.e. a first
+	 * order CIC), which keeps the noise from triggering it.
+	 *
+	 * The sums are exact integers and there is no filter state to run
+	 * per sample, only adds, a multiply and a compare.
+	 */
+	class dmm_engine : public gr::block
+	{
+	public:
+		explicit dmm_engine(double sample_rate, double aperture,
+				unsigned int decimation = 1);
+		~dmm_engine();
+
+		/* Integration time of each reading, in seconds */
+		void set_aperture(double aperture);
+		double aperture() const;
+
+		/* Readings per second */
+		double reading_rate() const;
+
+		unsigned int decimation() const;
+
+		static const double max_aperture;
+		static const unsigned int max_decimation;
+
+		void forecast(int noutput_items,
+				gr_vector_int &ninput_items_required);
+
+		int general_work(int noutput_items,
+				gr_vector_int &ninput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
+
+	private:
+		struct sums {
+			int64_t s1;
+			int64_t s2;
+			uint64_t n;
+		};
+
+		void begin_aperture();
+		void end_aperture(float *mean, float *rms);
+
+		const double sample_rate;
+		const unsigned int d_decimation;
+		std::atomic<uint64_t> aperture_samples;
+
+		/* Boxcar decimator */
+		int32_t dec_sum;
+		unsigned int dec_count;
+
+		/* Current aperture, in raw samples relative to @center */
+		sums acc, first, last;
+		uint64_t length;
+		unsigned int crossings;
+		bool below;
+
+		int32_t center;
+		int32_t hysteresis;
+	};
+}
+
+#endif /* DMM_ENGINE_HPP */
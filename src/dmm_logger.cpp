@@ -0,0 +1,458 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <QByteArray>
+#include <QtEndian>
+
+#include <config.h>
+
+#include "dmm_logger.hpp"
+
+using namespace adiscope;
+
+/* Must be a power of 2. About 13 s of readings at 10 kSPS. */
+const size_t dmm_logger::ring_size = 1 << 17;
+const size_t dmm_logger::write_size = 1024 * 1024;
+
+static const char binary_magic[8] = { 'S', 'C', 'O', 'P', 'Y', 'D', 'M', 'M' };
+static const quint32 binary_version = 1;
+static const qint64 binary_header_size = 24;
+
+/* Longest CSV row: the timestamp, then a separator and a value per column */
+static size_t max_row_size(size_t nb_values)
+{
+	return 32 + nb_values * 24;
+}
+
+/* Formats with a '.' whatever the locale, as ',' separates the columns */
+static char *append_number(char *out, double val, char format, int precision)
+{
+	const QByteArray str = QByteArray::number(val, format, precision);
+
+	memcpy(out, str.constData(), str.size());
+	return out + str.size();
+}
+
+dmm_logger::dmm_logger() :
+	gr::sync_block("dmm_logger",
+			gr::io_signature::make(1, -1, sizeof(float)),
+			gr::io_signature::make(0, 0, 0)),
+	nb_values(0),
+	head(0), tail(0),
+	last_time(0),
+	next_time(0),
+	file_index(0),
+	file_start(0),
+	time_offset(0),
+	used(0),
+	active(false),
+	busy(false),
+	stop_requested(false),
+	failed(false),
+	d_dropped(0)
+{
+}
+
+dmm_logger::~dmm_logger()
+{
+	close();
+}
+
+bool dmm_logger::open(const Settings& settings)
+{
+	close();
+
+	if (settings.columns.empty() || settings.rate <= 0) {
+		error = QObject::tr("Invalid logging settings");
+		return false;
+	}
+
+	this->settings = settings;
+	nb_values = settings.columns.size();
+	origin = QDateTime::currentDateTime();
+	clock_origin = std::chrono::steady_clock::now();
+
+	times.assign(ring_size, 0.0);
+	values.assign(ring_size * nb_values, 0.0f);
+	head = 0;
+	tail = 0;
+	last_time = -1;
+	next_time = 0;
+
+	buffer.resize(write_size + max_row_size(nb_values));
+	used = 0;
+	error.clear();
+	failed = false;
+	d_dropped = 0;
+
+	file_index = 0;
+	file_start = 0;
+
+	if (!open_file(file_index, settings.append)) {
+		return false;
+	}
+
+	stop_requested = false;
+	thread = std::thread(&dmm_logger::run, this);
+	active = true;
+
+	return true;
+}
+
+void dmm_logger::close()
+{
+	active = false;
+
+	// Let work() finish with the ring before the writer drains it
+	while (busy) {
+		std::this_thread::yield();
+	}
+
+	stop_requested = true;
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+
+	if (file.isOpen()) {
+		file.close();
+	}
+}
+
+bool dmm_logger::is_open() const
+{
+	return active;
+}
+
+QString dmm_logger::errorString() const
+{
+	return error;
+}
+
+uint64_t dmm_logger::dropped() const
+{
+	return d_dropped;
+}
+
+int dmm_logger::work(int noutput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	busy = true;
+
+	if (!active) {
+		busy = false;
+		return noutput_items;
+	}
+
+	const size_t nb_inputs = std::min(input_items.size(), nb_values);
+	const size_t mask = ring_size - 1;
+	size_t h = head.load(std::memory_order_relaxed);
+	size_t t = tail.load(std::memory_order_acquire);
+
+	/*
+	 * The readings of this call end now. They are spread evenly since
+	 * the previous call, so the timestamps follow the actual rate when
+	 * the aperture or the mode change, and never drift from the clock.
+	 */
+	const double now = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - clock_origin).count();
+	double period = 1.0 / settings.rate;
+
+	if (last_time >= 0 && noutput_items > 0) {
+		period = (now - last_time) / noutput_items;
+	}
+
+	const double first_time = std::max(now - (noutput_items - 1) * period,
+			0.0);
+
+	if (noutput_items > 0) {
+		last_time = now;
+	}
+
+	for (int j = 0; j < noutput_items; j++) {
+		const double time = first_time + j * period;
+
+		if (settings.interval > 0) {
+			if (time < next_time) {
+				continue;
+			}
+
+			next_time += settings.interval;
+
+			if (next_time <= time) {
+				next_time = time + settings.interval;
+			}
+		}
+
+		if (h - t == ring_size) {
+			t = tail.load(std::memory_order_acquire);
+
+			if (h - t == ring_size) {
+				d_dropped++;
+				continue;
+			}
+		}
+
+		const size_t slot = h & mask;
+		float *dst = &values[slot * nb_values];
+
+		times[slot] = time;
+
+		for (size_t i = 0; i < nb_inputs; i++) {
+			dst[i] = ((const float *) input_items[i])[j];
+		}
+
+		h++;
+	}
+
+	head.store(h, std::memory_order_release);
+	busy = false;
+
+	return noutput_items;
+}
+
+void dmm_logger::run()
+{
+	const size_t mask = ring_size - 1;
+
+	while (true) {
+		const size_t h = head.load(std::memory_order_acquire);
+		size_t t = tail.load(std::memory_order_relaxed);
+
+		if (t == h) {
+			if (stop_requested) {
+				break;
+			}
+
+			flush();
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			continue;
+		}
+
+		// After an error, keep emptying the ring so that work()
+		// doesn't count everything as dropped
+		for (; t != h && !failed; t++) {
+			write_row(t & mask);
+		}
+
+		tail.store(h, std::memory_order_release);
+	}
+
+	flush();
+	file.close();
+}
+
+bool dmm_logger::open_file(unsigned int index, bool append)
+{
+	QString name = settings.filename;
+
+	if (index) {
+		int dot = name.lastIndexOf('.');
+		int slash = std::max(name.lastIndexOf('/'),
+				name.lastIndexOf('\\'));
+		QString suffix = "_" + QString::number(index);
+
+		if (dot > slash) {
+			name.insert(dot, suffix);
+		} else {
+			name += suffix;
+		}
+	}
+
+	file.setFileName(name);
+	time_offset = 0;
+
+	QIODevice::OpenMode mode = QIODevice::ReadWrite;
+
+	if (!append) {
+		mode |= QIODevice::Truncate;
+	}
+
+	if (!file.open(mode)) {
+		error = file.errorString();
+		return false;
+	}
+
+	return write_header(append);
+}
+
+bool dmm_logger::write_header(bool append)
+{
+	const double origin_secs = origin.toMSecsSinceEpoch() / 1000.0;
+	QByteArray header;
+	qint64 keep = 0;
+
+	if (settings.format == BINARY) {
+		QByteArray previous = file.read(binary_header_size);
+
+		if (append && file.size() > 0) {
+			if (previous.size() != binary_header_size ||
+					memcmp(previous.constData(), binary_magic,
+						sizeof(binary_magic)) ||
+					qFromLittleEndian<quint32>((const uchar *)
+						previous.constData() + 8) != binary_version ||
+					qFromLittleEndian<quint32>((const uchar *)
+						previous.constData() + 12) != nb_values) {
+				// Never overwrite a file which can't be appended to
+				error = QObject::tr("%1 is not a binary log of the "
+						"same channels").arg(file.fileName());
+				return false;
+			}
+
+			quint64 raw = qFromLittleEndian<quint64>(
+					(const uchar *) previous.constData() + 16);
+			double previous_origin;
+
+			memcpy(&previous_origin, &raw, sizeof(raw));
+
+			// Keep the rows relative to the origin of the file
+			time_offset = origin_secs - previous_origin;
+			return file.seek(file.size());
+		}
+
+		quint32 version = qToLittleEndian(binary_version);
+		quint32 nb = qToLittleEndian<quint32>(nb_values);
+		quint64 raw;
+
+		memcpy(&raw, &origin_secs, sizeof(raw));
+		raw = qToLittleEndian(raw);
+
+		header.append(binary_magic, sizeof(binary_magic));
+		header.append((const char *) &version, sizeof(version));
+		header.append((const char *) &nb, sizeof(nb));
+		header.append((const char *) &raw, sizeof(raw));
+	} else {
+		bool has_header = append && file.size() > 0;
+
+		if (append) {
+			keep = file.size();
+		}
+
+		if (!has_header) {
+			header += ";Generated by Scopy-" +
+				QByteArray(SCOPY_VERSION_GIT) + "\n";
+		}
+
+		// Timestamps are seconds since the start of the session
+		header += ";Started on " + origin.toString().toUtf8() + "\n";
+
+		if (!has_header) {
+			header += "Timestamp";
+
+			for (const Column& column : settings.columns) {
+				header += "," + column.name.toUtf8();
+			}
+
+			header += "\n";
+		}
+	}
+
+	if (!file.resize(keep) ||
+			!file.seek(file.size()) ||
+			file.write(header) != header.size()) {
+		error = file.errorString();
+		return false;
+	}
+
+	return true;
+}
+
+void dmm_logger::write_row(size_t slot)
+{
+	const double time = times[slot];
+	const float *src = &values[slot * nb_values];
+
+	bool full = settings.max_size > 0 &&
+		file.pos() + (qint64) used >= settings.max_size;
+	bool expired = settings.max_duration > 0 &&
+		time - file_start >= settings.max_duration;
+
+	if (full || expired) {
+		if (!flush()) {
+			return;
+		}
+
+		file.close();
+		file_start = time;
+
+		if (!open_file(++file_index, false)) {
+			failed = true;
+			return;
+		}
+	}
+
+	char *out = buffer.data() + used;
+
+	if (settings.format == BINARY) {
+		const double stamp = time + time_offset;
+
+		memcpy(out, &stamp, sizeof(stamp));
+		out += sizeof(stamp);
+
+		for (size_t i = 0; i < nb_values; i++) {
+			const Column& column = settings.columns[i];
+			float value = src[i] * column.scale + column.offset;
+
+			memcpy(out, &value, sizeof(value));
+			out += sizeof(value);
+		}
+	} else {
+		out = append_number(out, time + time_offset, 'f', 6);
+
+		for (size_t i = 0; i < nb_values; i++) {
+			const Column& column = settings.columns[i];
+
+			*out++ = ',';
+			out = append_number(out,
+					src[i] * column.scale + column.offset,
+					'g', 7);
+		}
+
+		*out++ = '\n';
+	}
+
+	used = out - buffer.data();
+
+	if (used >= write_size) {
+		flush();
+	}
+}
+
+bool dmm_logger::flush()
+{
+	if (!used || failed) {
+		used = 0;
+		return !failed;
+	}
+
+	if (file.write(buffer.data(), used) != (qint64) used) {
+		error = file.errorString();
+		failed = true;
+	}
+
+	used = 0;
+
+	return !failed;
+}
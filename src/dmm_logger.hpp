@@ -0,0 +1,133 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef DMM_LOGGER_HPP
+#define DMM_LOGGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+
+#include <gnuradio/sync_block.h>
+
+namespace adiscope {
+	/*
+	 * Sink which logs the DMM readings to a CSV or binary file.
+	 *
+	 * work() only copies the readings into a lock-free single-producer/
+	 * single-consumer ring; a writer thread formats them into a large
+	 * buffer which goes to the file in big writes. Neither the scheduler
+	 * nor the GUI ever wait for the disk. Readings which don't fit in
+	 * the ring are counted as dropped.
+	 *
+	 * Binary files start with a header: "SCOPYDMM", the version and the
+	 * number of values as little-endian uint32, then the time origin as
+	 * a double (seconds since the epoch). Each row is a double (seconds
+	 * since the origin) followed by one float per value, in the byte
+	 * order of the host.
+	 *
+	 * The files can be rotated by size and / or duration: the next ones
+	 * get a "_<n>" suffix before their extension.
+	 */
+	class dmm_logger : public gr::sync_block
+	{
+	public:
+		enum Format {
+			CSV,
+			BINARY,
+		};
+
+		struct Column {
+			QString name;
+			float scale;	// from the input values to the logged
+			float offset;	// ones: value * scale + offset
+		};
+
+		struct Settings {
+			QString filename;
+			Format format;
+			bool append;
+			std::vector<Column> columns; // one per input
+			double rate;		// expected readings per second
+			double interval;	// seconds between rows, 0 for all
+			qint64 max_size;	// bytes per file, 0 for no limit
+			double max_duration;	// seconds per file, 0 for no limit
+		};
+
+		explicit dmm_logger();
+		~dmm_logger();
+
+		bool open(const Settings& settings);
+		void close();
+		bool is_open() const;
+
+		QString errorString() const;
+		uint64_t dropped() const;
+
+		static const size_t ring_size;
+		static const size_t write_size;
+
+		int work(int noutput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
+
+	private:
+		void run();
+		bool open_file(unsigned int index, bool append);
+		bool write_header(bool append);
+		void write_row(size_t slot);
+		bool flush();
+
+		Settings settings;
+		QDateTime origin;
+		size_t nb_values;
+
+		/* Ring, filled by work() and emptied by the writer thread */
+		std::vector<double> times;
+		std::vector<float> values;
+		std::atomic<size_t> head, tail;
+		std::chrono::steady_clock::time_point clock_origin;
+		double last_time;
+		double next_time;
+
+		/* Writer thread */
+		QFile file;
+		unsigned int file_index;
+		double file_start;
+		double time_offset;
+		std::vector<char> buffer;
+		size_t used;
+		QString error;
+
+		std::thread thread;
+		std::atomic<bool> active;
+		std::atomic<bool> busy;
+		std::atomic<bool> stop_requested;
+		std::atomic<bool> failed;
+		std::atomic<uint64_t> d_dropped;
+	};
+}
+
+#endif /* DMM_LOGGER_HPP */
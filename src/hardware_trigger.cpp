@@ -1,4 +1,5 @@
 #include "hardware_trigger.hpp"
+#include "iio_attr_cache.hpp"
 #include <QPair>
 
 #include <stdexcept>
@@ -128,7 +129,7 @@ HardwareTrigger::condition HardwareTrigger::analogCondition(uint chnIdx)
 	ssize_t ret;
 	char buf[4096];
 
-	ret = iio_channel_attr_read(m_analog_channels[chnIdx], "trigger", buf,
+	ret = IioAttrCache::read(m_analog_channels[chnIdx], "trigger", buf,
 		sizeof(buf));
 	if (ret < 0) {
 		throw std::runtime_error("failed to read attribute: trigger");
@@ -155,7 +156,7 @@ void HardwareTrigger::setAnalogCondition(uint chnIdx, condition cond)
 	}
 
 	QByteArray byteArray =  lut_analog_trigg_cond[cond].toLatin1();
-	iio_channel_attr_write(m_analog_channels[chnIdx], "trigger",
+	IioAttrCache::write(m_analog_channels[chnIdx], "trigger",
 		byteArray.data());
 }
 
@@ -169,7 +170,7 @@ HardwareTrigger::condition HardwareTrigger::digitalCondition(uint chnIdx)
 	ssize_t ret;
 	char buf[4096];
 
-	ret = iio_channel_attr_read(m_digital_channels[chnIdx], "trigger", buf,
+	ret = IioAttrCache::read(m_digital_channels[chnIdx], "trigger", buf,
 		sizeof(buf));
 	if (ret < 0)
 		throw "failed to read attribute: trigger";
@@ -189,7 +190,7 @@ void HardwareTrigger::setDigitalCondition(uint chnIdx, condition cond)
 	}
 
 	QByteArray byteArray =  lut_digital_trigg_cond[cond].toLatin1();
-	iio_channel_attr_write(m_digital_channels[chnIdx], "trigger",
+	IioAttrCache::write(m_digital_channels[chnIdx], "trigger",
 		byteArray.data());
 }
 
@@ -201,7 +202,7 @@ int HardwareTrigger::level(uint chnIdx) const
 
 	long long val;
 
-	iio_channel_attr_read_longlong(m_analog_channels[chnIdx],
+	IioAttrCache::read(m_analog_channels[chnIdx],
 		"trigger_level", &val);
 
 	return static_cast<int>(val);
@@ -213,7 +214,7 @@ void HardwareTrigger::setLevel(uint chnIdx, int level)
 		throw std::invalid_argument("Channel index is out of range");
 	}
 
-	iio_channel_attr_write_longlong(m_analog_channels[chnIdx],
+	IioAttrCache::write(m_analog_channels[chnIdx],
 		"trigger_level", static_cast<long long> (level));
 }
 
@@ -225,7 +226,7 @@ int HardwareTrigger::hysteresis(uint chnIdx) const
 
 	long long val;
 
-	iio_channel_attr_read_longlong(m_analog_channels[chnIdx],
+	IioAttrCache::read(m_analog_channels[chnIdx],
 		"trigger_hysteresis", &val);
 
 	return static_cast<int>(val);
@@ -237,7 +238,7 @@ void HardwareTrigger::setHysteresis(uint chnIdx, int histeresis)
 		throw std::invalid_argument("Channel index is out of range");
 	}
 
-	iio_channel_attr_write_longlong(m_analog_channels[chnIdx],
+	IioAttrCache::write(m_analog_channels[chnIdx],
 		"trigger_hysteresis", static_cast<long long>(histeresis));
 }
 
@@ -250,7 +251,7 @@ HardwareTrigger::mode HardwareTrigger::triggerMode(uint chnIdx) const
 	ssize_t ret;
 	char buf[4096];
 
-	ret = iio_channel_attr_read(m_logic_channels[chnIdx], "mode", buf,
+	ret = IioAttrCache::read(m_logic_channels[chnIdx], "mode", buf,
 		sizeof(buf));
 	if (ret < 0) {
 		throw ("failed to read attribute: mode");
@@ -271,7 +272,7 @@ void HardwareTrigger::setTriggerMode(uint chnIdx, HardwareTrigger::mode mode)
 	}
 
 	QByteArray byteArray =  lut_trigg_mode[mode].toLatin1();
-	iio_channel_attr_write(m_logic_channels[chnIdx], "mode",
+	IioAttrCache::write(m_logic_channels[chnIdx], "mode",
 		byteArray.data());
 }
 
@@ -279,7 +280,7 @@ QString HardwareTrigger::source() const
 {
 	char buf[4096];
 
-	iio_channel_attr_read(m_delay_trigger, "logic_mode", buf, sizeof(buf));
+	IioAttrCache::read(m_delay_trigger, "logic_mode", buf, sizeof(buf));
 
 	return QString(buf);
 }
@@ -287,7 +288,7 @@ QString HardwareTrigger::source() const
 void HardwareTrigger::setSource(const QString& source)
 {
 	QByteArray byteArray = source.toLatin1();
-	iio_channel_attr_write(m_delay_trigger, "logic_mode",
+	IioAttrCache::write(m_delay_trigger, "logic_mode",
 			       byteArray.data());
 }
 
@@ -331,14 +332,14 @@ int HardwareTrigger::delay() const
 {
 	long long delay;
 
-	iio_channel_attr_read_longlong(m_delay_trigger, "delay", &delay);
+	IioAttrCache::read(m_delay_trigger, "delay", &delay);
 
 	return static_cast<int>(delay);
 }
 
 void HardwareTrigger::setDelay(int delay)
 {
-	iio_channel_attr_write_longlong(m_delay_trigger, "delay", delay);
+	IioAttrCache::write(m_delay_trigger, "delay", (long long)delay);
 }
 
 HardwareTrigger::settings_uptr HardwareTrigger::getCurrentHwSettings()
@@ -1,5 +1,6 @@
 #include "hw_dac.h"
 #include "osc_adc.h" // because it contains the IioUtils class (TO DO: Move IioUils in separate file)
+#include "iio_attr_cache.hpp"
 
 #include <iio.h>
 
@@ -59,7 +60,7 @@ double GenericDac::sampleRate() const
 
 double GenericDac::readSampleRate()
 {
-	iio_device_attr_read_double(m_dac, "sampling_frequency",
+	IioAttrCache::read(m_dac, "sampling_frequency",
 		&m_sample_rate);
 
 	return m_sample_rate;
@@ -67,7 +68,7 @@ double GenericDac::readSampleRate()
 
 void GenericDac::setSampleRate(double sr)
 {
-	iio_device_attr_write_double(m_dac, "sampling_frequency", sr);
+	IioAttrCache::write(m_dac, "sampling_frequency", sr);
 	m_sample_rate = sr;
 }
 
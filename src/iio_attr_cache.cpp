@@ -0,0 +1,462 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <locale>
+#include <sstream>
+
+#include "iio_attr_cache.hpp"
+
+using namespace adiscope;
+
+std::recursive_mutex IioAttrCache::lock;
+std::map<IioAttrCache::Key, IioAttrCache::Entry> IioAttrCache::entries;
+std::vector<IioAttrCache::Pending> IioAttrCache::pending;
+unsigned int IioAttrCache::batch_depth = 0;
+uint64_t IioAttrCache::round_trips = 0;
+uint64_t IioAttrCache::saved_round_trips = 0;
+
+typedef std::vector<std::pair<std::string, std::string>> attr_list;
+
+/* Numbers are formatted as libiio does, whatever the locale */
+template<typename T>
+static std::string to_string(T val)
+{
+	std::ostringstream stream;
+
+	stream.imbue(std::locale::classic());
+	stream.setf(std::ios::fixed);
+	stream.precision(6);
+	stream << val;
+
+	return stream.str();
+}
+
+template<typename T>
+static int from_string(const std::string& str, T *val)
+{
+	std::istringstream stream(str);
+
+	stream.imbue(std::locale::classic());
+	stream >> *val;
+
+	return stream.fail() ? -EINVAL : 0;
+}
+
+static ssize_t fill_attr(const attr_list& attrs, const char *attr,
+		void *buf, size_t len)
+{
+	for (const auto& each : attrs) {
+		if (each.first != attr) {
+			continue;
+		}
+
+		size_t size = each.second.size() + 1;
+
+		if (size > len) {
+			return -ENOMEM;
+		}
+
+		memcpy(buf, each.second.c_str(), size);
+		return size;
+	}
+
+	// Attributes which aren't part of the batch are left untouched
+	return 0;
+}
+
+static ssize_t fill_channel_attr(struct iio_channel *chn, const char *attr,
+		void *buf, size_t len, void *d)
+{
+	return fill_attr(*static_cast<const attr_list *>(d), attr, buf, len);
+}
+
+static ssize_t fill_device_attr(struct iio_device *dev, const char *attr,
+		void *buf, size_t len, void *d)
+{
+	return fill_attr(*static_cast<const attr_list *>(d), attr, buf, len);
+}
+
+ssize_t IioAttrCache::readString(const void *object, bool is_channel,
+		const char *attr, std::string& value)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	const Key key(object, attr);
+
+	// Values written by the batch must reach the device first
+	for (const Pending& each : pending) {
+		if (each.object == object) {
+			flush();
+			break;
+		}
+	}
+
+	auto it = entries.find(key);
+
+	if (it != entries.end() && it->second.has_read) {
+		saved_round_trips++;
+		value = it->second.read;
+		return value.size() + 1;
+	}
+
+	char buf[4096];
+	ssize_t ret;
+
+	if (is_channel) {
+		ret = iio_channel_attr_read(
+				static_cast<const struct iio_channel *>(object),
+				attr, buf, sizeof(buf));
+	} else {
+		ret = iio_device_attr_read(
+				static_cast<const struct iio_device *>(object),
+				attr, buf, sizeof(buf));
+	}
+
+	round_trips++;
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	Entry& entry = entries[key];
+	entry.is_channel = is_channel;
+	entry.has_read = true;
+	entry.read = buf;
+	value = entry.read;
+
+	return ret;
+}
+
+ssize_t IioAttrCache::writeString(const void *object, bool is_channel,
+		const char *attr, const std::string& value)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	Entry& entry = entries[Key(object, attr)];
+
+	entry.is_channel = is_channel;
+
+	if (entry.has_written && entry.written == value) {
+		saved_round_trips++;
+		return value.size() + 1;
+	}
+
+	// The device may round the value, read it back next time
+	entry.has_read = false;
+
+	if (batch_depth) {
+		// Only writes in a row to one object are merged, so that the
+		// objects are written in the order of the calls
+		if (pending.empty() || pending.back().object != object) {
+			pending.push_back({ object, is_channel, attr_list() });
+		}
+
+		auto it = pending.end() - 1;
+
+		auto attr_it = std::find_if(it->attrs.begin(), it->attrs.end(),
+				[attr](const std::pair<std::string, std::string>& each) {
+			return each.first == attr;
+		});
+
+		if (attr_it != it->attrs.end()) {
+			saved_round_trips++;
+			attr_it->second = value;
+		} else {
+			it->attrs.push_back(std::make_pair(std::string(attr),
+					value));
+		}
+
+		entry.has_written = true;
+		entry.written = value;
+
+		return value.size() + 1;
+	}
+
+	ssize_t ret;
+
+	if (is_channel) {
+		ret = iio_channel_attr_write(
+				static_cast<const struct iio_channel *>(object),
+				attr, value.c_str());
+	} else {
+		ret = iio_device_attr_write(
+				static_cast<const struct iio_device *>(object),
+				attr, value.c_str());
+	}
+
+	round_trips++;
+	entry.has_written = ret >= 0;
+	entry.written = value;
+
+	return ret;
+}
+
+int IioAttrCache::flush()
+{
+	std::vector<Pending> batch;
+	int result = 0;
+
+	batch.swap(pending);
+
+	for (const Pending& each : batch) {
+		ssize_t ret;
+
+		if (each.attrs.size() == 1) {
+			const auto& attr = each.attrs.front();
+
+			if (each.is_channel) {
+				ret = iio_channel_attr_write(
+					static_cast<const struct iio_channel *>(
+						each.object),
+					attr.first.c_str(), attr.second.c_str());
+			} else {
+				ret = iio_device_attr_write(
+					static_cast<const struct iio_device *>(
+						each.object),
+					attr.first.c_str(), attr.second.c_str());
+			}
+		} else if (each.is_channel) {
+			ret = iio_channel_attr_write_all(
+				const_cast<struct iio_channel *>(
+					static_cast<const struct iio_channel *>(
+						each.object)),
+				fill_channel_attr, (void *) &each.attrs);
+		} else {
+			ret = iio_device_attr_write_all(
+				const_cast<struct iio_device *>(
+					static_cast<const struct iio_device *>(
+						each.object)),
+				fill_device_attr, (void *) &each.attrs);
+		}
+
+		round_trips++;
+		saved_round_trips += each.attrs.size() - 1;
+
+		if (ret < 0) {
+			result = ret;
+
+			for (const auto& attr : each.attrs) {
+				entries[Key(each.object, attr.first)]
+					.has_written = false;
+			}
+		}
+	}
+
+	return result;
+}
+
+void IioAttrCache::beginBatch()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	batch_depth++;
+}
+
+int IioAttrCache::endBatch()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	if (!batch_depth || --batch_depth) {
+		return 0;
+	}
+
+	return flush();
+}
+
+void IioAttrCache::invalidate(const void *object)
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	if (!object) {
+		entries.clear();
+		return;
+	}
+
+	auto it = entries.lower_bound(Key(object, std::string()));
+
+	while (it != entries.end() && it->first.first == object) {
+		it = entries.erase(it);
+	}
+}
+
+uint64_t IioAttrCache::roundTrips()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	return round_trips;
+}
+
+uint64_t IioAttrCache::savedRoundTrips()
+{
+	std::lock_guard<std::recursive_mutex> guard(lock);
+
+	return saved_round_trips;
+}
+
+ssize_t IioAttrCache::read(const struct iio_channel *chn, const char *attr,
+		char *dst, size_t len)
+{
+	std::string value;
+	ssize_t ret = readString(chn, true, attr, value);
+
+	if (ret >= 0 && len) {
+		size_t n = std::min(value.size(), len - 1);
+
+		memcpy(dst, value.c_str(), n);
+		dst[n] = '\0';
+	}
+
+	return ret;
+}
+
+int IioAttrCache::read(const struct iio_channel *chn, const char *attr,
+		long long *val)
+{
+	std::string value;
+	ssize_t ret = readString(chn, true, attr, value);
+
+	return ret < 0 ? ret : from_string(value, val);
+}
+
+int IioAttrCache::read(const struct iio_channel *chn, const char *attr,
+		double *val)
+{
+	std::string value;
+	ssize_t ret = readString(chn, true, attr, value);
+
+	return ret < 0 ? ret : from_string(value, val);
+}
+
+int IioAttrCache::read(const struct iio_channel *chn, const char *attr,
+		bool *val)
+{
+	long long value;
+	int ret = read(chn, attr, &value);
+
+	if (!ret) {
+		*val = !!value;
+	}
+
+	return ret;
+}
+
+ssize_t IioAttrCache::read(const struct iio_device *dev, const char *attr,
+		char *dst, size_t len)
+{
+	std::string value;
+	ssize_t ret = readString(dev, false, attr, value);
+
+	if (ret >= 0 && len) {
+		size_t n = std::min(value.size(), len - 1);
+
+		memcpy(dst, value.c_str(), n);
+		dst[n] = '\0';
+	}
+
+	return ret;
+}
+
+int IioAttrCache::read(const struct iio_device *dev, const char *attr,
+		long long *val)
+{
+	std::string value;
+	ssize_t ret = readString(dev, false, attr, value);
+
+	return ret < 0 ? ret : from_string(value, val);
+}
+
+int IioAttrCache::read(const struct iio_device *dev, const char *attr,
+		double *val)
+{
+	std::string value;
+	ssize_t ret = readString(dev, false, attr, value);
+
+	return ret < 0 ? ret : from_string(value, val);
+}
+
+int IioAttrCache::read(const struct iio_device *dev, const char *attr,
+		bool *val)
+{
+	long long value;
+	int ret = read(dev, attr, &value);
+
+	if (!ret) {
+		*val = !!value;
+	}
+
+	return ret;
+}
+
+ssize_t IioAttrCache::write(const struct iio_channel *chn, const char *attr,
+		const char *src)
+{
+	return writeString(chn, true, attr, src);
+}
+
+int IioAttrCache::write(const struct iio_channel *chn, const char *attr,
+		long long val)
+{
+	ssize_t ret = writeString(chn, true, attr, std::to_string(val));
+
+	return ret < 0 ? ret : 0;
+}
+
+int IioAttrCache::write(const struct iio_channel *chn, const char *attr,
+		double val)
+{
+	ssize_t ret = writeString(chn, true, attr, to_string(val));
+
+	return ret < 0 ? ret : 0;
+}
+
+int IioAttrCache::write(const struct iio_channel *chn, const char *attr,
+		bool val)
+{
+	return write(chn, attr, (long long) val);
+}
+
+ssize_t IioAttrCache::write(const struct iio_device *dev, const char *attr,
+		const char *src)
+{
+	return writeString(dev, false, attr, src);
+}
+
+int IioAttrCache::write(const struct iio_device *dev, const char *attr,
+		long long val)
+{
+	ssize_t ret = writeString(dev, false, attr, std::to_string(val));
+
+	return ret < 0 ? ret : 0;
+}
+
+int IioAttrCache::write(const struct iio_device *dev, const char *attr,
+		double val)
+{
+	ssize_t ret = writeString(dev, false, attr, to_string(val));
+
+	return ret < 0 ? ret : 0;
+}
+
+int IioAttrCache::write(const struct iio_device *dev, const char *attr,
+		bool val)
+{
+	return write(dev, attr, (long long) val);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef IIO_ATTR_CACHE_HPP
+#define IIO_ATTR_CACHE_HPP
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <iio.h>
+
+namespace adiscope {
+
+/*
+ * Drop-in replacement for the iio_{channel,device}_attr_{read,write}*()
+ * calls on settings, which saves the round trips to the device. Each
+ * one costs a network exchange on remote contexts.
+ *
+ * - Writing the value which was last written is skipped.
+ * - A read returns the value from the previous read, until the attribute
+ *   is written again; readings which change on their own (ADC / DAC raw
+ *   values...) must keep using libiio directly.
+ * - Between beginBatch() and endBatch(), writes are only recorded and
+ *   then flushed in the order of the calls. Writes in a row to the same
+ *   channel or device are merged into one write_all() round trip (the
+ *   last value wins), which writes them in the order the driver lists
+ *   the attributes; attributes of one object whose order matters must
+ *   not be written in a row within a batch.
+ *
+ * Every writer of a cached attribute, the calibration included, must go
+ * through the cache, or call invalidate() on every path after writing it
+ * directly. The logic analyzer, the pattern generator and the digital IO
+ * still use libiio directly; their attributes must not be accessed
+ * through the cache.
+ */
+class IioAttrCache
+{
+public:
+	static ssize_t read(const struct iio_channel *chn, const char *attr,
+			char *dst, size_t len);
+	static int read(const struct iio_channel *chn, const char *attr,
+			long long *val);
+	static int read(const struct iio_channel *chn, const char *attr,
+			double *val);
+	static int read(const struct iio_channel *chn, const char *attr,
+			bool *val);
+
+	static ssize_t read(const struct iio_device *dev, const char *attr,
+			char *dst, size_t len);
+	static int read(const struct iio_device *dev, const char *attr,
+			long long *val);
+	static int read(const struct iio_device *dev, const char *attr,
+			double *val);
+	static int read(const struct iio_device *dev, const char *attr,
+			bool *val);
+
+	static ssize_t write(const struct iio_channel *chn, const char *attr,
+			const char *src);
+	static int write(const struct iio_channel *chn, const char *attr,
+			long long val);
+	static int write(const struct iio_channel *chn, const char *attr,
+			double val);
+	static int write(const struct iio_channel *chn, const char *attr,
+			bool val);
+
+	static ssize_t write(const struct iio_device *dev, const char *attr,
+			const char *src);
+	static int write(const struct iio_device *dev, const char *attr,
+			long long val);
+	static int write(const struct iio_device *dev, const char *attr,
+			double val);
+	static int write(const struct iio_device *dev, const char *attr,
+			bool val);
+
+	/* Batches can be nested, the outermost endBatch() flushes */
+	static void beginBatch();
+	static int endBatch();
+
+	/* Forget what is known about an object, or about all of them */
+	static void invalidate(const void *object = nullptr);
+
+	static uint64_t roundTrips();
+	static uint64_t savedRoundTrips();
+
+private:
+	typedef std::pair<const void *, std::string> Key;
+
+	struct Entry {
+		bool is_channel;
+		bool has_read;
+		bool has_written;
+		std::string read;
+		std::string written;
+	};
+
+	struct Pending {
+		const void *object;
+		bool is_channel;
+		std::vector<std::pair<std::string, std::string>> attrs;
+	};
+
+	static ssize_t readString(const void *object, bool is_channel,
+			const char *attr, std::string& value);
+	static ssize_t writeString(const void *object, bool is_channel,
+			const char *attr, const std::string& value);
+	static int flush();
+
+	static std::recursive_mutex lock;
+	static std::map<Key, Entry> entries;
+	static std::vector<Pending> pending;
+	static unsigned int batch_depth;
+	static uint64_t round_trips;
+	static uint64_t saved_round_trips;
+};
+}
+
+#endif /* IIO_ATTR_CACHE_HPP */
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <QDebug>
+
+#include "iio_tx_stream.hpp"
+
+using namespace adiscope;
+
+const unsigned int IioTxStream::kernelBuffers = 4;
+
+IioTxStream::IioTxStream() :
+	txbuf(nullptr),
+	sampleRate(0),
+	stopRequested(false),
+	running(false),
+	underruns(0)
+{
+}
+
+IioTxStream::~IioTxStream()
+{
+	stop();
+}
+
+bool IioTxStream::open(const struct iio_device *dev, size_t samples,
+                       double sampleRate)
+{
+	stop();
+
+	if (!dev || samples == 0 || sampleRate <= 0) {
+		return false;
+	}
+
+	this->sampleRate = sampleRate;
+
+	iio_device_set_kernel_buffers_count(dev, kernelBuffers);
+	txbuf = iio_device_create_buffer(dev, samples, false);
+
+	if (!txbuf) {
+		qDebug("Could not create stream buffer - errno: %d - %s", errno,
+		       strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+void IioTxStream::launch()
+{
+	underruns = 0;
+	stopRequested = false;
+	running = true;
+	thread = std::thread(&IioTxStream::run, this);
+}
+
+void IioTxStream::stop()
+{
+	stopRequested = true;
+
+	if (txbuf) {
+		iio_buffer_cancel(txbuf);
+	}
+
+	if (thread.joinable()) {
+		thread.join();
+	}
+
+	if (txbuf) {
+		iio_buffer_destroy(txbuf);
+		txbuf = nullptr;
+	}
+
+	running = false;
+}
+
+bool IioTxStream::isRunning() const
+{
+	return running;
+}
+
+uint64_t IioTxStream::getUnderruns() const
+{
+	return underruns;
+}
+
+void IioTxStream::run()
+{
+	using namespace std::chrono;
+	typedef steady_clock::duration Duration;
+
+	/*
+	 * The device runs dry once it has played everything queued. The
+	 * queue is only known to be full when a push blocks: the device then
+	 * holds at least kernelBuffers - 1 chunks. Counting the chunks pushed
+	 * since then, at the nominal rate, only covers a few chunks, so the
+	 * drift between the clock of the device and ours can't add up.
+	 */
+	steady_clock::time_point dry;
+	bool pushed = false;
+
+	while (!stopRequested) {
+		size_t count = produce(txbuf);
+
+		if (count == 0) {
+			break;
+		}
+
+		Duration chunk = duration_cast<Duration>(
+		                         duration<double>(count / sampleRate));
+		auto before = steady_clock::now();
+		bool late = pushed && before > dry;
+
+		if (late) {
+			underruns++;
+		}
+
+		ssize_t ret = iio_buffer_push_partial(txbuf, count);
+
+		if (ret < 0) {
+			if (!stopRequested) {
+				qDebug("Stream push failed: %zd", ret);
+			}
+
+			break;
+		}
+
+		auto after = steady_clock::now();
+
+		if (!pushed || late) {
+			dry = after + chunk;
+		} else {
+			dry += chunk;
+		}
+
+		// A push which waited for a kernel buffer found the queue full
+		if (after - before > chunk / 8) {
+			dry = std::max(dry, after + chunk * (kernelBuffers - 1));
+		}
+
+		dry = std::min(dry, after + chunk * kernelBuffers);
+		pushed = true;
+	}
+
+	running = false;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef IIO_TX_STREAM_HPP
+#define IIO_TX_STREAM_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include <iio.h>
+
+namespace adiscope {
+
+/*
+ * Pushes samples to a device through a non-cyclic IIO buffer from a
+ * producer thread. Subclasses write each chunk straight into the memory
+ * of the buffer in produce(); the kernel buffers queue the chunks which
+ * are ready while the previous ones are played.
+ *
+ * Subclasses must call stop() from their destructor, since the producer
+ * thread calls back into them.
+ */
+class IioTxStream
+{
+public:
+	virtual ~IioTxStream();
+
+	void stop();
+	bool isRunning() const;
+
+	// Number of times the device ran out of samples
+	uint64_t getUnderruns() const;
+
+	static const unsigned int kernelBuffers;
+
+protected:
+	IioTxStream();
+
+	/*
+	 * Creates the buffer, of @samples samples played at @sampleRate,
+	 * then launch() starts the producer thread.
+	 */
+	bool open(const struct iio_device *dev, size_t samples,
+	          double sampleRate);
+	void launch();
+
+	/*
+	 * Called on the producer thread to write the next chunk into the
+	 * buffer. Returns the number of samples to push, 0 to stop.
+	 */
+	virtual size_t produce(struct iio_buffer *buf) = 0;
+
+	struct iio_buffer *txbuf;
+
+private:
+	void run();
+
+	double sampleRate;
+
+	std::thread thread;
+	std::atomic<bool> stopRequested;
+	std::atomic<bool> running;
+	std::atomic<uint64_t> underruns;
+};
+}
+
+#endif /* IIO_TX_STREAM_HPP */
@@ -18,10 +18,13 @@
 #include <QPainter>
 #include <QListView>
 #include <QFormLayout>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 #include "pulseview/pv/widgets/colourbutton.hpp"
 #include "pulseview/pv/view/tracepalette.hpp"
 #include "pulseview/pv/binding/decoder.hpp"
 #include "scroll_filter.hpp"
+#include "decoder_index.hpp"
 
 using std::dynamic_pointer_cast;
 
@@ -1102,16 +1105,42 @@ LogicAnalyzerChannelUI*
 
 void LogicAnalyzerChannelGroupUI::decoderChanged(const QString text)
 {
-	const srd_decoder *decoder;
+	const DecoderIndex::Decoder *info = nullptr;
 
-	if (text == "None") {
-		decoder = nullptr;
+	if (text != "None") {
+		info = DecoderIndex::find(text);
 	}
-	else {
-		decoder = chm_ui->chm->get_decoder_from_name(
-			text.toStdString().c_str());
+
+	if (!info) {
+		applyDecoder(nullptr);
+		return;
 	}
 
+	const srd_decoder *decoder = DecoderIndex::loaded(info->id);
+
+	if (decoder) {
+		applyDecoder(decoder);
+		return;
+	}
+
+	// The first use of a decoder imports its module, which takes a
+	// while; don't block the GUI meanwhile
+	auto watcher = new QFutureWatcher<const srd_decoder *>(this);
+
+	connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
+		watcher->deleteLater();
+
+		// Unless another decoder was picked in the meantime
+		if (ui->decoderCombo->currentText() == text) {
+			applyDecoder(watcher->result());
+		}
+	});
+
+	watcher->setFuture(QtConcurrent::run(&DecoderIndex::decoder, info->id));
+}
+
+void LogicAnalyzerChannelGroupUI::applyDecoder(const srd_decoder *decoder)
+{
 	if(decoder)
 	{
 		QLayoutItem* item;
@@ -1276,15 +1305,10 @@ void LogicAnalyzerChannelManager::remove(int index)
 
 void LogicAnalyzerChannelManager::initDecoderList(bool first_level_decode)
 {
-	GSList *dL = g_slist_sort(g_slist_copy(
-			(GSList *)srd_decoder_list()), decoder_name_cmp);
-
-	for (; dL; dL = dL->next) {
-		const srd_decoder *const d = (srd_decoder *)dL->data;
-		decoderList.push_back(d);
-		nameDecoderList << QString::fromUtf8(d->name);
+	/* The list comes from the index, the decoders aren't imported yet */
+	for (const DecoderIndex::Decoder& d : DecoderIndex::decoders()) {
+		nameDecoderList << d.name;
 	}
-	g_slist_free(dL);
 }
 
 QStringList LogicAnalyzerChannelManager::get_name_decoder_list()
@@ -1295,13 +1319,14 @@ QStringList LogicAnalyzerChannelManager::get_name_decoder_list()
 const srd_decoder *LogicAnalyzerChannelManager::get_decoder_from_name(
         const char *name)
 {
-	for (auto var : decoderList) {
-		if (strcmp(var->name, name) == 0) {
-			return var;
-		}
+	const DecoderIndex::Decoder *d = DecoderIndex::find(
+				QString::fromUtf8(name));
+
+	if (!d) {
+		return nullptr;
 	}
 
-	return nullptr;
+	return DecoderIndex::decoder(d->id);
 }
 
 void LogicAnalyzerChannelManager::splitChannel(int chgIndex, int chIndex)
@@ -1343,12 +1368,6 @@ LogicAnalyzerChannel *LogicAnalyzerChannelManager::getHighlightedChannel()
 	return highlightedChannel;
 }
 
-int LogicAnalyzerChannelManager::decoder_name_cmp(const void *a, const void *b)
-{
-	return strcmp(((const srd_decoder *)a)->name,
-	              ((const srd_decoder *)b)->name);
-}
-
 
 void LogicAnalyzerChannelManager::move(int from, int to, bool after)
 {
@@ -186,6 +186,9 @@ public:
 	std::shared_ptr<pv::view::DecodeTrace> getDecodeTrace();
 	bool eventFilter(QObject *watched, QEvent *event);
 
+private:
+	void applyDecoder(const srd_decoder *decoder);
+
 private Q_SLOTS:
 	void set_decoder(std::string value);
 	void collapse_group();
@@ -238,9 +241,7 @@ public:
 	void clearChannelGroups();
 	void clearTrigger();
 private:
-	std::vector<const srd_decoder *> decoderList;
 	QStringList nameDecoderList;
-	static int decoder_name_cmp(const void *a, const void *b);
 	LogicAnalyzerChannelGroup *highlightedChannelGroup;
 	LogicAnalyzerChannel *highlightedChannel;
 protected:
@@ -55,6 +55,8 @@
 #include "dynamicWidget.hpp"
 #include "config.h"
 #include "osc_export_settings.h"
+#include "logic_exporter.hpp"
+#include "capture_file.hpp"
 
 /* Sigrok includes */
 #include <libsigrokcxx/libsigrokcxx.hpp>
@@ -444,6 +446,12 @@ void LogicAnalyzer::init_export_settings()
 		exportSettings->addChannel(i, "DIO" + QString::number(i));
 	}
 
+	exporter = new LogicExporter(this);
+	connect(exporter, SIGNAL(progress(int)), this,
+		SLOT(exportProgress(int)));
+	connect(exporter, SIGNAL(finished(bool, QString)), this,
+		SLOT(exportFinished(bool, QString)));
+
 	connect(exportSettings->getExportButton(), SIGNAL(clicked()), this,
 		SLOT(btnExportPressed()));
 	connect(this, &LogicAnalyzer::activateExportButton,
@@ -476,6 +484,8 @@ LogicAnalyzer::~LogicAnalyzer()
 	api->save(*settings);
 	delete api;
 
+	delete exporter;
+
 	if(running)
 		startStop(false);
 	logic_analyzer_ptr.reset();
@@ -577,12 +587,19 @@ QString LogicAnalyzer::saveToFile()
 
 	QString filename = QFileDialog::getSaveFileName(this,
 		tr("Scopy Logic Analyzer export"), "",
-		tr("Comma-separated values files (*.csv);;Tab-delimited values files(*.txt);;Value Change Dump(*.vcd);;All Files(*)"),
+		tr("Comma-separated values files (*.csv);;Tab-delimited values files(*.txt);;Value Change Dump(*.vcd);;Scopy capture(*.scap);;All Files(*)"),
 		&selectedFilter);
 
 	if(filename.isEmpty())
 		return "";
 
+	if(selectedFilter.contains("Scopy capture", Qt::CaseInsensitive)) {
+		done = startExport(LogicExporter::BINARY, filename, "", "", "");
+		if(paused)
+			startStop(true);
+		return (done ? filename : "");
+	}
+
 	// Check the selected file type
 	if(selectedFilter != "") {
 		if(selectedFilter.contains("comma", Qt::CaseInsensitive))
@@ -622,145 +639,99 @@ QString LogicAnalyzer::saveToFile()
 	return (done ? filename : "");
 }
 
-bool LogicAnalyzer::exportVCD(QString filename, QString startSep, QString endSep)
+bool LogicAnalyzer::startExport(int format, QString filename,
+		QString separator, QString startSep, QString endSep)
 {
-	uint64_t current_sample, prev_sample;
-	int current_bit, prev_bit, p;
-	QString timescaleFormat;
-	double timescale;
-	double timestamp;
-	bool timestamp_written = false;
+	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
+	if(!logic_data || logic_data->logic_segments().empty())
+		return false;
 
-	QFile file(filename);
-	if( !file.open(QIODevice::Append)) {
+	shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
+	uint64_t sample_count = segment->get_sample_count();
+	if(sample_count == 0)
 		return false;
-	}
 
-	QTextStream out(&file);
+	std::vector<bool> channels(no_channels, false);
+	for(int ch = 0; ch < no_channels; ch++)
+		channels[ch] = exportConfig[ch];
 
-	/* Write the specific header */
-	if( active_plot_timebase < 1e-6 ) {
-		timescaleFormat = "ns";
-		timescale = 1e-9;
-	}
-	else if( active_plot_timebase < 1e-3 ) {
-		timescaleFormat = "us";
-		timescale = 1e-6;
-	}
-	else if( active_plot_timebase < 1 ) {
-		timescaleFormat = "ms";
-		timescale = 1e-3;
-	}
-	else {
-		timescaleFormat = "s";
-		timescale = 1;
-	}
-
-	out << startSep << "timescale 1 " << timescaleFormat << endSep;
-	out << startSep << "scope module Scopy" << endSep;
-	int counter = 0;
-	for(int ch = 0; ch < no_channels; ch++) {
-		if( exportConfig[ch] ) {
-			char c = '!' + counter;
-			out << startSep << "var wire 1" << c << " DIO" <<
-			       QString::number(ch) << endSep;
-			counter++;
-		}
-	}
-	out << startSep << "upscope" << endSep;
-	out << startSep << "enddefinitions" << endSep;
+	double sample_time = (active_plot_timebase * 10) / sample_count;
+	exporter->setTriggerPosition(-active_triggerSampleCount);
 
-	/* Write the values */
-	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
-	if(logic_data) {
-		shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
-		uint64_t sample_count = segment->get_sample_count();
-		for(int i = 0; i < sample_count; i++) {
-			current_sample = segment->get_sample(i);
-			if( i == 0)
-				prev_sample = current_sample;
-			else
-				prev_sample = segment->get_sample(i-1);
-			timestamp_written = false;
-			p = 0;
-			timestamp = ((i * active_plot_timebase * 10) / sample_count)/timescale;
-
-			for(int ch = 0; ch < no_channels; ch++) {
-				current_bit = (current_sample >> ch) & 1;
-				prev_bit = (prev_sample >> ch) & 1;
-
-				if((current_bit == prev_bit) && (i != 0))
-					continue;
-
-				if( !timestamp_written )
-					out << "#" << QString::number(timestamp);
-
-				if(exportConfig[ch]) {
-					char c = '0' + current_bit;
-					char c2 = '!' + p;
-					out << ' ' << c << c2;
-					p++;
-					timestamp_written = true;
-				}
-			}
-			if(timestamp_written)
-				out << "\n";
-		}
-	}
-	else {
-		file.close();
+	if(!exporter->start(segment, filename, (LogicExporter::Format)format,
+			channels, no_channels, separator, sample_time,
+			startSep, endSep))
 		return false;
-	}
-	file.close();
+
+	exportSettings->getExportButton()->setText(tr("Cancel"));
 	return true;
 }
 
+bool LogicAnalyzer::exportVCD(QString filename, QString startSep, QString endSep)
+{
+	return startExport(LogicExporter::VCD, filename, "", startSep, endSep);
+}
+
 bool LogicAnalyzer::exportTabCsv(QString separator, QString filename)
 {
-	QFile file(filename);
-	if( !file.open(QIODevice::Append)) {
-		return false;
-	}
+	return startExport(LogicExporter::CSV, filename, separator, "", "");
+}
 
-	QTextStream out(&file);
+bool LogicAnalyzer::loadCapture(QString filename)
+{
+	CaptureFileReader reader;
 
-	// Write the header ( sample number + channels)
-	for(int ch = 0; ch < no_channels; ch++) {
-		if( exportConfig[ch] ) {
-			out << "Channel " + QString::number(ch) +
-			       ((ch == no_channels - 1) ? "\n" : separator);
-		}
-		else if( ch == no_channels - 1)
-			out << "\n";
-	}
+	if(running)
+		startStop(false);
 
-	// Write the values
-	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
-	if(logic_data) {
-		shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
-		for(int i = 0; i < segment->get_sample_count(); i++) {
-			uint64_t sample = segment->get_sample(i);
-			for(int ch = 0; ch < no_channels; ch++) {
-				int bit = (sample >> ch) & 1;
-				if(exportConfig[ch]) {
-					out << (bit ? "1" : "0");
-					out << ((ch == no_channels - 1) ? "\n" : separator);
-				}
-				else if( ch == no_channels - 1)
-					out << "\n";
-			}
-		}
+	if(!reader.open(filename)) {
+		qDebug() << "Can't load" << filename << ":" << reader.errorString();
+		return false;
 	}
-	else {
-		file.close();
+
+	const CaptureFile::Info &info = reader.info();
+	if(info.format != CaptureFile::LOGIC) {
+		qDebug() << filename << "is not a logic capture";
 		return false;
 	}
-	file.close();
+
+	// The segment reads the samples straight from the mapped file
+	shared_ptr<pv::data::LogicSegment> segment =
+		make_shared<pv::data::LogicSegment>(info.unit_size,
+			(uint64_t)info.sample_rate, reader.payload(),
+			info.sample_count);
+
+	if(!main_win->session_.load_logic_segment(segment))
+		return false;
+
+	active_triggerSampleCount = -info.trigger_position;
+	main_win->view_->viewport()->setTimeTriggerSample(-active_triggerSampleCount);
+	Q_EMIT activateExportButton();
+
 	return true;
 }
 
+void LogicAnalyzer::exportProgress(int percent)
+{
+	exportSettings->getExportButton()->setText(
+		tr("Cancel (%1%)").arg(percent));
+}
+
+void LogicAnalyzer::exportFinished(bool success, QString filename)
+{
+	exportSettings->getExportButton()->setText(tr("Export"));
+
+	if(!success)
+		qDebug() << "Logic Analyzer export to" << filename << "failed";
+}
+
 void LogicAnalyzer::btnExportPressed()
 {
+	if(exporter->isRunning()) {
+		exporter->cancel();
+		return;
+	}
+
 	if( !main_win->session_.is_data())
 		return;
 
@@ -1863,6 +1834,11 @@ void LogicAnalyzer::onFrameEnded()
  */
 
 
+bool LogicAnalyzer_API::loadCapture(QString filename)
+{
+	return lga->loadCapture(filename);
+}
+
 bool LogicAnalyzer_API::running() const
 {
 	return lga->ui->btnRunStop->isChecked();
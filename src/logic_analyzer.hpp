@@ -74,6 +74,7 @@ class ScaleSpinButton;
 class PositionSpinButton;
 class StateUpdater;
 class ExportSettings;
+class LogicExporter;
 
 class LogicAnalyzer : public Tool
 {
@@ -119,6 +120,7 @@ public:
 	int getCurrent_acquisition_mode() const;
 	void setCurrent_acquisition_mode(int value);
 	QString saveToFile();
+	bool loadCapture(QString filename);
 	std::vector<std::string> get_iio_trigger_options();
 
 private Q_SLOTS:
@@ -146,6 +148,8 @@ private Q_SLOTS:
 	void startTimer();
 	void stopTimer();
 	void btnExportPressed();
+	void exportProgress(int percent);
+	void exportFinished(bool success, QString filename);
 	void runModeChanged(int index);
 	void validateSamplingFrequency();
 	void setTriggerState(int);
@@ -274,10 +278,13 @@ private:
 	StateUpdater *triggerUpdater;
 	bool trigger_is_forced;
 	ExportSettings *exportSettings;
+	LogicExporter *exporter;
 	QMap<int, bool> exportConfig;
 	void init_export_settings();
 	bool exportTabCsv(QString separator, QString);
 	bool exportVCD(QString, QString, QString);
+	bool startExport(int format, QString filename, QString separator,
+			 QString startSep, QString endSep);
 };
 
 class LogicAnalyzer_API : public ApiObject
@@ -329,6 +336,8 @@ public:
 	bool inactiveHidden() const;
 	void setInactiveHidden(bool en);
 
+	Q_INVOKABLE bool loadCapture(QString filename);
+
 private:
 	LogicAnalyzer *lga;
 };
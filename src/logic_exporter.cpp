@@ -0,0 +1,409 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/* Qt includes */
+#include <QFile>
+#include <QtConcurrentRun>
+
+/* Local includes */
+#include "logic_exporter.hpp"
+#include "capture_file.hpp"
+#include "pulseview/pv/data/logicsegment.hpp"
+
+using namespace adiscope;
+
+const size_t LogicExporter::bufferSize = 1024 * 1024;
+const uint64_t LogicExporter::progressStep = 1024 * 1024;
+
+static inline uint64_t read_sample(const uint8_t *ptr, unsigned int unit_size)
+{
+	uint64_t value = 0;
+
+	for (unsigned int i = 0; i < unit_size; i++)
+		value |= ((uint64_t)ptr[i]) << (8 * i);
+
+	return value;
+}
+
+LogicExporter::LogicExporter(QObject *parent) :
+	QObject(parent),
+	format(CSV),
+	nb_channels(0),
+	sample_time(0),
+	trigger_position(0),
+	last_progress(-1),
+	cancelled(false)
+{
+}
+
+LogicExporter::~LogicExporter()
+{
+	cancel();
+	future.waitForFinished();
+}
+
+bool LogicExporter::start(std::shared_ptr<pv::data::LogicSegment> segment,
+		const QString& filename, Format format,
+		const std::vector<bool>& channels, unsigned int nb_channels,
+		const QString& separator, double sample_time,
+		const QString& startSep, const QString& endSep)
+{
+	if (isRunning() || !segment)
+		return false;
+
+	this->segment = segment;
+	this->filename = filename;
+	this->format = format;
+	this->channels = channels;
+	this->channels.resize(nb_channels, false);
+	this->nb_channels = nb_channels;
+	this->separator = separator.toUtf8();
+	this->sample_time = sample_time;
+	this->startSep = startSep.toUtf8();
+	this->endSep = endSep.toUtf8();
+
+	last_progress = -1;
+	cancelled = false;
+	future = QtConcurrent::run(this, &LogicExporter::run);
+
+	return true;
+}
+
+void LogicExporter::cancel()
+{
+	cancelled = true;
+}
+
+bool LogicExporter::isRunning() const
+{
+	return future.isRunning();
+}
+
+void LogicExporter::setTriggerPosition(qint64 sample)
+{
+	trigger_position = sample;
+}
+
+void LogicExporter::run()
+{
+	bool done = false;
+	QFile file(filename);
+
+	if (format == BINARY) {
+		done = exportBinary();
+
+		if (cancelled)
+			file.remove();
+	} else if (file.open(QIODevice::Append)) {
+		buffer.resize(bufferSize);
+
+		if (format == CSV)
+			done = exportCsv(file);
+		else
+			done = exportVcd(file);
+
+		file.close();
+
+		// Don't leave half of a file behind
+		if (cancelled)
+			file.remove();
+	}
+
+	buffer.clear();
+	buffer.shrink_to_fit();
+	snapshot.clear();
+	snapshot.shrink_to_fit();
+	segment.reset();
+
+	Q_EMIT finished(done && !cancelled, filename);
+}
+
+bool LogicExporter::exportCsv(QFile& file)
+{
+	char *out = buffer.data();
+
+	// Write the header ( sample number + channels)
+	QByteArray header;
+	for (unsigned int ch = 0; ch < nb_channels; ch++) {
+		if (channels[ch]) {
+			header += "Channel " + QByteArray::number(ch) +
+				((ch == nb_channels - 1) ? "\n" : separator);
+		} else if (ch == nb_channels - 1) {
+			header += "\n";
+		}
+	}
+
+	if (!file.write(header))
+		return false;
+
+	// Build the row once, then only patch the values of the channels
+	// which changed since the previous sample
+	std::vector<char> row;
+	std::vector<std::pair<unsigned int, size_t>> positions;
+	uint64_t mask = 0;
+
+	for (unsigned int ch = 0; ch < nb_channels; ch++) {
+		if (channels[ch]) {
+			positions.push_back(std::make_pair(ch, row.size()));
+			row.push_back('0');
+			mask |= (uint64_t)1 << ch;
+
+			if (ch == nb_channels - 1)
+				row.push_back('\n');
+			else
+				row.insert(row.end(), separator.begin(),
+					separator.end());
+		} else if (ch == nb_channels - 1) {
+			row.push_back('\n');
+		}
+	}
+
+	const uint64_t sample_count = segment->get_sample_count();
+	const unsigned int unit_size = segment->unit_size();
+	const pv::data::Segment::SampleView view = samples();
+
+	uint64_t prev_value = 0;
+	const size_t row_size = row.size();
+	char *const end = buffer.data() + buffer.size() - row_size;
+
+	for (uint64_t i = 0; i < sample_count; i++) {
+		const uint64_t value = read_sample(view.data + i * unit_size,
+			unit_size) & mask;
+
+		if (value != prev_value) {
+			for (const auto& pos : positions)
+				row[pos.second] = '0' + ((value >> pos.first) & 1);
+			prev_value = value;
+		}
+
+		memcpy(out, row.data(), row_size);
+		out += row_size;
+
+		if (out > end) {
+			if (!flush(file, out))
+				return false;
+			out = buffer.data();
+		}
+
+		if ((i % progressStep) == 0) {
+			if (cancelled)
+				return false;
+			reportProgress(i, sample_count);
+		}
+	}
+
+	if (!flush(file, out))
+		return false;
+
+	reportProgress(sample_count, sample_count);
+	return true;
+}
+
+bool LogicExporter::exportVcd(QFile& file)
+{
+	static const char *const units[] = { "s", "ms", "us", "ns", "ps" };
+	const int nb_units = sizeof(units) / sizeof(units[0]);
+	char *out = buffer.data();
+
+	// Use the coarsest unit which still gives every sample its own
+	// integer timestamp
+	int unit = 0;
+	double step = sample_time;
+	while (unit < nb_units - 1 && step < 1) {
+		step *= 1000;
+		unit++;
+	}
+
+	QByteArray header;
+	header += startSep + "timescale 1 " + units[unit] + endSep;
+	header += startSep + "scope module Scopy" + endSep;
+
+	std::vector<std::pair<unsigned int, char>> ids;
+	uint64_t mask = 0;
+
+	for (unsigned int ch = 0; ch < nb_channels; ch++) {
+		if (channels[ch]) {
+			const char id = (char)('!' + ids.size());
+			header += startSep + "var wire 1" + id + " DIO" +
+				QByteArray::number(ch) + endSep;
+			ids.push_back(std::make_pair(ch, id));
+			mask |= (uint64_t)1 << ch;
+		}
+	}
+
+	header += startSep + "upscope" + endSep;
+	header += startSep + "enddefinitions" + endSep;
+
+	if (!file.write(header))
+		return false;
+
+	const uint64_t sample_count = segment->get_sample_count();
+	const unsigned int unit_size = segment->unit_size();
+	const pv::data::Segment::SampleView view = samples();
+
+	// '#', 20 digits, a value and an id for each channel, '\n'
+	const size_t max_line = 1 + 20 + 3 * ids.size() + 1;
+	char *const end = buffer.data() + buffer.size() - max_line;
+	uint64_t prev_value = 0;
+
+	for (uint64_t i = 0; i < sample_count; i++) {
+		const uint64_t value = read_sample(view.data + i * unit_size,
+			unit_size) & mask;
+
+		if ((i % progressStep) == 0) {
+			if (cancelled)
+				return false;
+			reportProgress(i, sample_count);
+		}
+
+		// Only the transitions make it into the file
+		const uint64_t changed = (i == 0) ? mask : (value ^ prev_value);
+		if (!changed)
+			continue;
+
+		*out++ = '#';
+		out = formatUInt(out, (uint64_t)llround(i * step));
+
+		for (const auto& id : ids) {
+			if (!((changed >> id.first) & 1))
+				continue;
+
+			*out++ = ' ';
+			*out++ = '0' + ((value >> id.first) & 1);
+			*out++ = id.second;
+		}
+
+		*out++ = '\n';
+		prev_value = value;
+
+		if (out > end) {
+			if (!flush(file, out))
+				return false;
+			out = buffer.data();
+		}
+	}
+
+	if (!flush(file, out))
+		return false;
+
+	reportProgress(sample_count, sample_count);
+	return true;
+}
+
+bool LogicExporter::exportBinary()
+{
+	const uint64_t sample_count = segment->get_sample_count();
+	const unsigned int unit_size = segment->unit_size();
+	const pv::data::Segment::SampleView view = samples();
+
+	// The raw samples of all the channels are saved, so that the
+	// capture can be loaded back as it was acquired
+	CaptureFile::Info info;
+	info.format = CaptureFile::LOGIC;
+	info.unit_size = unit_size;
+	info.sample_rate = segment->samplerate();
+	info.trigger_position = trigger_position;
+	info.sample_count = sample_count;
+
+	for (unsigned int ch = 0; ch < nb_channels; ch++) {
+		CaptureFile::Channel channel;
+		channel.name = "DIO" + QString::number(ch);
+		channel.gain = 1;
+		channel.offset = 0;
+		info.channels.push_back(channel);
+	}
+
+	CaptureFileWriter writer;
+	if (!writer.open(filename, info))
+		return false;
+
+	const uint64_t chunk = bufferSize / unit_size;
+
+	for (uint64_t i = 0; i < sample_count; i += chunk) {
+		if (cancelled)
+			return false;
+		reportProgress(i, sample_count);
+
+		const uint64_t n = std::min(chunk, sample_count - i);
+		if (!writer.append(view.data + i * unit_size, n))
+			return false;
+	}
+
+	if (!writer.close())
+		return false;
+
+	reportProgress(sample_count, sample_count);
+	return true;
+}
+
+pv::data::Segment::SampleView LogicExporter::samples()
+{
+	const uint64_t sample_count = segment->get_sample_count();
+	pv::data::Segment::SampleView view =
+		segment->get_sample_view(0, sample_count);
+
+	// A segment which is overwritten in place is copied first
+	if (!view.stable) {
+		snapshot.resize(sample_count * segment->unit_size() +
+			sizeof(uint64_t));
+		segment->get_samples(snapshot.data(), 0, sample_count);
+		view.storage.reset();
+		view.data = snapshot.data();
+		view.stable = true;
+	}
+
+	return view;
+}
+
+bool LogicExporter::flush(QFile& file, char *end)
+{
+	const qint64 size = end - buffer.data();
+
+	return file.write(buffer.data(), size) == size;
+}
+
+void LogicExporter::reportProgress(uint64_t sample, uint64_t sample_count)
+{
+	const int percent = sample_count ? (int)(sample * 100 / sample_count) : 100;
+
+	if (percent != last_progress) {
+		last_progress = percent;
+		Q_EMIT progress(percent);
+	}
+}
+
+char *LogicExporter::formatUInt(char *dst, uint64_t value)
+{
+	char digits[20];
+	int n = 0;
+
+	do {
+		digits[n++] = '0' + (value % 10);
+		value /= 10;
+	} while (value);
+
+	while (n)
+		*dst++ = digits[--n];
+
+	return dst;
+}
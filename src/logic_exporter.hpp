@@ -0,0 +1,125 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LOGIC_EXPORTER_HPP
+#define LOGIC_EXPORTER_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/* Qt includes */
+#include <QFuture>
+#include <QObject>
+#include <QString>
+
+/* Local includes */
+#include "pulseview/pv/data/segment.hpp"
+
+namespace pv {
+namespace data {
+class LogicSegment;
+}
+}
+
+class QFile;
+
+namespace adiscope {
+
+/*
+ * Writes the samples of a logic segment to a CSV/TXT, a VCD or a Scopy
+ * binary capture file on a background thread.
+ *
+ * The samples are read straight from the segment memory. CSV rows are
+ * only formatted again when the exported channels change value and VCD
+ * only visits the transitions; the text goes through a large reusable
+ * buffer which is flushed to the file in big writes.
+ */
+class LogicExporter : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum Format {
+		CSV,
+		VCD,
+		BINARY
+	};
+
+	explicit LogicExporter(QObject *parent = nullptr);
+	~LogicExporter();
+
+	/*
+	 * Starts appending the samples of the segment to the file.
+	 * @channels tells which of the @nb_channels channels are exported.
+	 * For CSV @separator goes between the values of a row; for VCD
+	 * @sample_time is the duration of a sample in seconds and
+	 * @startSep / @endSep are put around the header keywords.
+	 */
+	bool start(std::shared_ptr<pv::data::LogicSegment> segment,
+		const QString& filename, Format format,
+		const std::vector<bool>& channels, unsigned int nb_channels,
+		const QString& separator, double sample_time,
+		const QString& startSep, const QString& endSep);
+
+	void cancel();
+	bool isRunning() const;
+
+	/* Trigger position saved in binary captures, in samples */
+	void setTriggerPosition(qint64 sample);
+
+Q_SIGNALS:
+	void progress(int percent);
+	void finished(bool success, QString filename);
+
+private:
+	void run();
+	bool exportCsv(QFile& file);
+	bool exportVcd(QFile& file);
+	bool exportBinary();
+	pv::data::Segment::SampleView samples();
+	bool flush(QFile& file, char *end);
+	void reportProgress(uint64_t sample, uint64_t sample_count);
+
+	static char *formatUInt(char *dst, uint64_t value);
+
+private:
+	static const size_t bufferSize;
+	static const uint64_t progressStep;
+
+	std::shared_ptr<pv::data::LogicSegment> segment;
+	QString filename;
+	Format format;
+	std::vector<bool> channels;
+	unsigned int nb_channels;
+	QByteArray separator;
+	double sample_time;
+	QByteArray startSep;
+	QByteArray endSep;
+	qint64 trigger_position;
+
+	std::vector<char> buffer;
+	std::vector<uint8_t> snapshot;
+	int last_progress;
+	std::atomic<bool> cancelled;
+	QFuture<void> future;
+};
+}
+
+#endif /* LOGIC_EXPORTER_HPP */
@@ -20,22 +20,40 @@
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QSettings>
+#include <QTimer>
 #include <QtGlobal>
 
+#include <cstring>
+
 #include "config.h"
+#include "startup_trace.hpp"
 #include "tool_launcher.hpp"
 
 using namespace adiscope;
 
 int main(int argc, char **argv)
 {
+	StartupTrace::start();
+
+	// The platform has to be chosen before the application is created,
+	// so that no display is needed
+	bool headless = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--headless"))
+			headless = true;
+	}
+
+	if (headless && qgetenv("QT_QPA_PLATFORM").isEmpty())
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
 	QApplication app(argc, argv);
 
 	QFont font("sans");
 	font.setStyleStrategy(QFont::PreferAntialias);
 	app.setFont(font);
 
-	if (app.styleSheet().isEmpty()) {
+	if (app.styleSheet().isEmpty() && !headless) {
+		TraceScope trace("Stylesheet");
 		QFile file(":/stylesheets/stylesheets/global.qss");
 		file.open(QFile::ReadOnly);
 
@@ -60,13 +78,37 @@ int main(int argc, char **argv)
 
 	parser.addOptions({
 		{ {"s", "script"}, "Run given script.", "script" },
+		{ "startup-benchmark", "Exit as soon as the window is "
+			"interactive; fail if SCOPY_STARTUP_BUDGET_MS is exceeded." },
+		{ "headless", "Run the script without a display; "
+			"the plots are not drawn." },
 	});
 
 	parser.process(app);
 
+	QString script = parser.value("script");
+	if (headless && script.isEmpty()) {
+		qCritical() << "Headless mode needs a script";
+		return EXIT_FAILURE;
+	}
+
+	qint64 start = StartupTrace::now();
 	ToolLauncher launcher;
+	StartupTrace::record("ToolLauncher", start, StartupTrace::now());
+
+	launcher.setHeadless(headless);
+
+	const bool benchmark = parser.isSet("startup-benchmark");
+
+	// Runs once the first events were processed
+	QTimer::singleShot(0, [benchmark]() {
+		qint64 elapsed = StartupTrace::interactive();
+
+		if (benchmark)
+			QCoreApplication::exit(elapsed < 0 ? EXIT_FAILURE :
+					       EXIT_SUCCESS);
+	});
 
-	QString script = parser.value("script");
 	if (script.isEmpty()) {
 		launcher.show();
 	} else {
@@ -94,5 +136,8 @@ int main(int argc, char **argv)
 				 Q_ARG(QString, script));
 	}
 
-	return app.exec();
+	int ret = app.exec();
+
+	StartupTrace::write();
+	return ret;
 }
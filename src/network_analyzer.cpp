@@ -23,6 +23,7 @@
 #include "spinbox_a.hpp"
 #include "osc_adc.h"
 #include "hardware_trigger.hpp"
+#include "iio_attr_cache.hpp"
 #include "ui_network_analyzer.h"
 
 #include <gnuradio/analog/sig_source_c.h>
@@ -81,8 +82,8 @@ NetworkAnalyzer::NetworkAnalyzer(struct iio_context *ctx, Filter *filt,
 		this->amp1 = iio_device_find_channel(fabric, "voltage0", true);
 		this->amp2 = iio_device_find_channel(fabric, "voltage1", true);
 		if (amp1 && amp2) {
-			iio_channel_attr_write_bool(amp1, "powerdown", true);
-			iio_channel_attr_write_bool(amp2, "powerdown", true);
+			IioAttrCache::write(amp1, "powerdown", true);
+			IioAttrCache::write(amp2, "powerdown", true);
 		}
 	}
 
@@ -223,7 +224,7 @@ void NetworkAnalyzer::run()
 		double offset = ui->offset->value();
 
 		if (dev1 != dev2)
-			iio_device_attr_write_bool(dev1, "dma_sync", true);
+			IioAttrCache::write(dev1, "dma_sync", true);
 
 		struct iio_buffer *buf_dac1 = generateSinWave(dev1,
 				frequency, amplitude, offset,
@@ -243,12 +244,12 @@ void NetworkAnalyzer::run()
 				break;
 			}
 
-			iio_device_attr_write_bool(dev1, "dma_sync", false);
+			IioAttrCache::write(dev1, "dma_sync", false);
 		}
 
 		adc_rate = get_best_sample_rate(adc, frequency);
-		iio_device_attr_write_longlong(adc,
-				"sampling_frequency", adc_rate);
+		IioAttrCache::write(adc, "sampling_frequency",
+				(long long)adc_rate);
 
 		/* Lock the flowgraph if we are already started */
 		bool started = iio->started();
@@ -282,6 +283,7 @@ void NetworkAnalyzer::run()
 		iio->connect(cosine, 0, mult2, 1);
 
 		auto signal = boost::make_shared<signal_sample>();
+		signal->set_single_shot(true);
 		auto conj = blocks::multiply_conjugate_cc::make();
 
 		auto avg1 = blocks::moving_average_cc::make(buffer_size,
@@ -313,15 +315,7 @@ void NetworkAnalyzer::run()
 		iio->connect(c2a, 0, signal, 2);
 
 		bool got_it = false;
-		float mag1 = 0.0f, mag2 = 0.0f, phase = 0.0f;
-
-		connect(&*signal, &signal_sample::triggered,
-				[&](const std::vector<float> values) {
-			mag1 = values[0];
-			mag2 = values[1];
-			phase = values[2];
-			got_it = true;
-		});
+		signal_sample_values values;
 
 		iio->start(id1);
 		iio->start(id2);
@@ -335,6 +329,8 @@ void NetworkAnalyzer::run()
 
 			if (!ui->run_button->isChecked())
 				break;
+
+			got_it = signal->fetch(values);
 		} while (!got_it);
 
 		iio->stop(id1);
@@ -355,6 +351,12 @@ void NetworkAnalyzer::run()
 		if (!got_it) /* Process was cancelled */
 			return;
 
+		/* Only the first item after the skipheads averages a single
+		 * capture; the next windows straddle two ADC buffers */
+		float mag1 = values.first[0];
+		float mag2 = values.first[1];
+		float phase = values.first[2];
+
 		double mag;
 		if (ui->refCh1->isChecked()) {
 			phase = -phase;
@@ -403,8 +405,8 @@ void NetworkAnalyzer::startStop(bool pressed)
 
 	if (amp1 && amp2) {
 		/* FIXME: TODO: Move this into a HW class / lib M2k */
-		iio_channel_attr_write_bool(amp1, "powerdown", !pressed);
-		iio_channel_attr_write_bool(amp2, "powerdown", !pressed);
+		IioAttrCache::write(amp1, "powerdown", !pressed);
+		IioAttrCache::write(amp2, "powerdown", !pressed);
 	}
 
 	if (pressed) {
@@ -518,7 +520,7 @@ struct iio_buffer * NetworkAnalyzer::generateSinWave(
 		}
 	}
 
-	iio_device_attr_write_longlong(dev, "sampling_frequency", rate);
+	IioAttrCache::write(dev, "sampling_frequency", (long long)rate);
 
 	iio_buffer_push(buf);
 
@@ -535,8 +537,8 @@ void NetworkAnalyzer::configHwForNetworkAnalyzing()
 
 	auto m2k_adc = std::dynamic_pointer_cast<M2kAdc>(adc_dev);
 	if (m2k_adc) {
-		iio_device_attr_write_longlong(m2k_adc->iio_adc_dev(),
-			"oversampling_ratio", 1);
+		IioAttrCache::write(m2k_adc->iio_adc_dev(),
+			"oversampling_ratio", 1LL);
 	}
 }
 
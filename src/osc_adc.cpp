@@ -1,5 +1,6 @@
 #include "osc_adc.h"
 #include "hardware_trigger.hpp"
+#include "iio_attr_cache.hpp"
 #include <iio.h>
 #include <QString>
 #include <QDebug>
@@ -141,7 +142,7 @@ double GenericAdc::sampleRate() const
 
 double GenericAdc::readSampleRate()
 {
-	iio_device_attr_read_double(m_adc, "sampling_frequency",
+	IioAttrCache::read(m_adc, "sampling_frequency",
 		&m_sample_rate);
 
 	return m_sample_rate;
@@ -149,7 +150,7 @@ double GenericAdc::readSampleRate()
 
 void GenericAdc::setSampleRate(double sr)
 {
-	iio_device_attr_write_double(m_adc, "sampling_frequency", sr);
+	IioAttrCache::write(m_adc, "sampling_frequency", sr);
 	m_sample_rate = sr;
 }
 
@@ -309,7 +310,7 @@ void M2kAdc::setChnHwOffset(uint chnIdx, double offset)
 	int raw_offset = (int)(offset * (1 << numAdcBits()) * hw_chn_gain *
 		gain / 2.693 / vref) + m_chn_corr_offsets[chnIdx];
 
-	iio_channel_attr_write_longlong(m_offset_channels[chnIdx], "raw",
+	IioAttrCache::write(m_offset_channels[chnIdx], "raw",
 		(long long)raw_offset);
 
 	m_chn_hw_offsets[chnIdx] = offset;
@@ -325,8 +326,7 @@ void M2kAdc::setChnHwGainMode(uint chnIdx, GainMode gain_mode)
 	const char *str_gain_mode = (gain_mode == GainMode::HIGH_GAIN_MODE) ?
 		"high" : "low";
 
-	iio_channel_attr_write_raw(m_gain_channels[chnIdx], "gain",
-		str_gain_mode, strlen(str_gain_mode));
+	IioAttrCache::write(m_gain_channels[chnIdx], "gain", str_gain_mode);
 
 	m_chn_hw_gain_modes[chnIdx] = gain_mode;
 }
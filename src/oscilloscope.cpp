@@ -27,6 +27,7 @@
 #include <QVBoxLayout>
 #include <QtWidgets/QSpacerItem>
 #include <QSignalBlocker>
+#include <QJSEngine>
 
 /* Local includes */
 #include "adc_sample_conv.hpp"
@@ -43,6 +44,8 @@
 #include "config.h"
 #include "customplotpositionbutton.h"
 #include "channel_widget.hpp"
+#include "capture_file.hpp"
+#include "iio_attr_cache.hpp"
 
 /* Generated UI */
 #include "ui_math_panel.h"
@@ -650,7 +653,8 @@ void Oscilloscope::btnExport_clicked(){
 	export_dialog->setFileMode( QFileDialog::AnyFile );
 	export_dialog->setAcceptMode( QFileDialog::AcceptSave );
 	export_dialog->setNameFilters({"Comma-separated values files (*.csv)",
-					       "Tab-delimited values files (*.txt)"});
+					       "Tab-delimited values files (*.txt)",
+					       "Scopy capture (*.scap)"});
 	bool atleastOneChannelEnabled = false;
 	for (auto x : exportConfig.keys())
 		if (exportConfig[x]){
@@ -663,6 +667,20 @@ void Oscilloscope::btnExport_clicked(){
 
 	if (export_dialog->exec()){
 		QString filter = export_dialog->selectedNameFilter();
+		if (filter.contains(".scap")){
+			QString filename = export_dialog->selectedFiles().at(0);
+
+			if (!exportCapture(filename)) {
+				QMessageBox error(this);
+				error.setText(tr("Could not export the capture to %1")
+					.arg(filename));
+				error.exec();
+			}
+
+			pause(false);
+			return;
+		}
+
 		QFile f(export_dialog->selectedFiles().at(0));
 		f.open(QIODevice::WriteOnly);
 		QTextStream outputStream(&f);
@@ -715,6 +733,67 @@ void Oscilloscope::btnExport_clicked(){
 	pause(false);
 }
 
+bool Oscilloscope::exportCapture(const QString& filename)
+{
+	int channels_number = nb_channels + nb_math_channels;
+	std::vector<int> channels;
+
+	CaptureFile::Info info;
+	info.format = CaptureFile::FLOAT32;
+	info.sample_rate = active_sample_rate;
+	info.trigger_position = active_trig_sample_count;
+
+	// The plotted values are already in Volts
+	for (int i = 0; i < channels_number; ++i){
+		if (!exportConfig[i])
+			continue;
+
+		QString chNo = (i > 1) ? QString::number(i - 1) : QString::number(i + 1);
+		CaptureFile::Channel ch;
+		ch.name = ((i > 1) ? "Math" : "Channel") + chNo + "(V)";
+		ch.gain = 1;
+		ch.offset = 0;
+		info.channels.push_back(ch);
+		channels.push_back(i);
+	}
+
+	if (channels.empty())
+		return false;
+
+	// Only as many samples as all the exported channels have
+	info.sample_count = plot.Curve(channels[0])->data()->size();
+	for (int c : channels)
+		info.sample_count = std::min<quint64>(info.sample_count,
+			plot.Curve(c)->data()->size());
+
+	info.unit_size = channels.size() * sizeof(float);
+
+	CaptureFileWriter writer;
+	if (!writer.open(filename, info))
+		return false;
+
+	// Interleave the samples of the channels, a block at a time
+	const size_t block = 64 * 1024;
+	std::vector<float> frames(block * channels.size());
+
+	for (size_t start = 0; start < info.sample_count; start += block){
+		size_t n = std::min<size_t>(block, info.sample_count - start);
+
+		for (size_t c = 0; c < channels.size(); c++){
+			const QwtSeriesData<QPointF> *data =
+				plot.Curve(channels[c])->data();
+			for (size_t i = 0; i < n; i++)
+				frames[i * channels.size() + c] =
+					data->sample(start + i).y();
+		}
+
+		if (!writer.append(frames.data(), n))
+			return false;
+	}
+
+	return writer.close();
+}
+
 void Oscilloscope::create_math_panel()
 {
 	/* Math stuff */
@@ -2436,6 +2515,9 @@ void Oscilloscope::setAllSinksSampleCount(unsigned long sample_count)
 
 void Oscilloscope::writeAllSettingsToHardware()
 {
+	// Send the settings of each channel / device in a single round trip
+	IioAttrCache::beginBatch();
+
 	// Sample Rate
 	if (active_sample_rate != adc->sampleRate())
 		adc->setSampleRate(active_sample_rate);
@@ -2450,12 +2532,14 @@ void Oscilloscope::writeAllSettingsToHardware()
 			m2k_adc->setChnHwGainMode(i, mode);
 		}
 
-		iio_device_attr_write_longlong(adc->iio_adc_dev(),
-			"oversampling_ratio", 1);
+		IioAttrCache::write(adc->iio_adc_dev(),
+			"oversampling_ratio", 1LL);
 	}
 
 	// Writes all trigger settings to hardware
 	trigger_settings.setAdcRunningState(true);
+
+	IioAttrCache::endBatch();
 }
 
 void Oscilloscope::on_xyPlotLineType_toggled(bool checked)
@@ -2880,6 +2964,30 @@ QVariantList Oscilloscope_API::getChannels()
 	return list;
 }
 
+QJSValue Oscilloscope_API::getSamples(int ch) const
+{
+	QJSEngine *engine = qjsEngine(this);
+
+	if (!engine || ch < 0 || ch >= osc->nb_channels + osc->nb_math_channels)
+		return QJSValue();
+
+	// Copied in bulk into an ArrayBuffer, without a JS value per sample
+	const QwtSeriesData<QPointF> *data = osc->plot.Curve(ch)->data();
+	QByteArray buffer(data->size() * sizeof(double), Qt::Uninitialized);
+	double *dst = (double *)buffer.data();
+
+	for (size_t i = 0; i < data->size(); i++)
+		dst[i] = data->sample(i).y();
+
+	return engine->globalObject().property("Float64Array")
+		.callAsConstructor({ engine->toScriptValue(buffer) });
+}
+
+double Oscilloscope_API::sampleRate() const
+{
+	return osc->active_sample_rate;
+}
+
 /*
  * Channel_API
  */
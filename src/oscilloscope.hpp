@@ -34,6 +34,7 @@
 #include <QVector>
 #include <QWidget>
 #include <QButtonGroup>
+#include <QJSValue>
 #include <QMap>
 #include <QQueue>
 
@@ -206,6 +207,7 @@ namespace adiscope {
 		ExportSettings *exportSettings;
 
 		QMap<int, bool> exportConfig;
+		bool exportCapture(const QString& filename);
 
 		std::shared_ptr<SymmetricBufferMode> symmBufferMode;
 
@@ -367,6 +369,8 @@ namespace adiscope {
 		Q_PROPERTY(int current_channel READ getCurrentChannel
 				WRITE setCurrentChannel)
 
+		Q_PROPERTY(double sample_rate READ sampleRate STORED false)
+
 	public:
 		explicit Oscilloscope_API(Oscilloscope *osc) :
 			ApiObject(), osc(osc) {}
@@ -374,6 +378,14 @@ namespace adiscope {
 
 		QVariantList getChannels();
 
+		/*
+		 * Returns the last captured samples of a channel (math
+		 * channels follow the hardware ones) as a Float64Array,
+		 * in Volts.
+		 */
+		Q_INVOKABLE QJSValue getSamples(int ch) const;
+		double sampleRate() const;
+
 		bool running() const;
 		void run(bool en);
 
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <fcntl.h>
 #include <vector>
+#include <algorithm>
 #include <string.h>
 
 #include <iio.h>
@@ -121,11 +122,11 @@ PatternGenerator::runState PatternGenerator::pgStatus()
 void PatternGenerator::enableBufferUpdates(bool enabled)
 {
 	if (enabled) {
-		connect(getCurrentPatternUI(),SIGNAL(patternParamsChanged()),bufui,
-		        SLOT(updateUi()));
+		connect(getCurrentPatternUI(),SIGNAL(patternParamsChanged()),this,
+		        SLOT(updatePattern()));
 	} else {
-		disconnect(getCurrentPatternUI(),SIGNAL(patternParamsChanged()),bufui,
-		           SLOT(updateUi()));
+		disconnect(getCurrentPatternUI(),SIGNAL(patternParamsChanged()),this,
+		           SLOT(updatePattern()));
 	}
 }
 
@@ -146,7 +147,8 @@ PatternGenerator::PatternGenerator(struct iio_context *ctx, Filter *filt,
 	pgSettings(new Ui::PGSettings),
 	cgSettings(new Ui::PGCGSettings),
 	txbuf(0), buffer_created(0), currentUI(nullptr), offline_mode(offline_mode_),
-	diom(diom)
+	diom(diom), txSampleRate(0), txBufferSize(0), txGeneration(0),
+	txEnabledMask(0), txModeMask(0), txCyclic(false), streaming(false)
 {
 	// IIO
 	if (!offline_mode) {
@@ -305,6 +307,12 @@ void PatternGenerator::generatePattern()
 	bufman->update();
 }
 
+void PatternGenerator::updatePattern()
+{
+	// Only the group of the edited pattern is sampled again
+	bufui->updateUi(chm.getHighlightedChannelGroup());
+}
+
 void PatternGenerator::toggleRightMenu(QPushButton *btn)
 {
 	static rightMenuState rightMenuStatus=OPENED_CG;
@@ -542,7 +550,7 @@ void PatternGenerator::patternChanged(int index)
 	deleteSettingsWidget();
 	createSettingsWidget();
 	Q_EMIT currentUI->decoderChanged();
-	bufui->updateUi();
+	bufui->updateUi(chg);
 }
 
 void PatternGenerator::deleteSettingsWidget()
@@ -780,10 +788,34 @@ void PatternGenerator::updateBufferSize()
 
 void PatternGenerator::reloadBufferInDevice()
 {
-	if (pgStatus()!=STOPPED) {
-		stopPatternGeneration();
-		startPatternGeneration(true);
+	if (pgStatus()==STOPPED) {
+		return;
+	}
+
+	bool sameConfig = buffer_created && txCyclic &&
+	                  txSampleRate == bufman->getSampleRate() &&
+	                  txEnabledMask == chm.get_enabled_mask() &&
+	                  txModeMask == chm.get_mode_mask() &&
+	                  txBufferSize == bufman->getBufferSize();
+
+	if (sameConfig && txGeneration == bufman->getGeneration()) {
+		// Nothing the device outputs has changed
+		return;
+	}
+
+	if (sameConfig) {
+		// Only the samples changed: keep the channels, their direction
+		// and the sample rate, just replace the cyclic buffer
+		iio_buffer_destroy(txbuf);
+		buffer_created = false;
+
+		if (pushBuffer(true)) {
+			return;
+		}
 	}
+
+	stopPatternGeneration();
+	startPatternGeneration(true);
 }
 
 bool PatternGenerator::startPatternGeneration(bool cyclic)
@@ -820,6 +852,33 @@ bool PatternGenerator::startPatternGeneration(bool cyclic)
 	iio_device_attr_write(dev, "sampling_frequency",
 	                      std::to_string(bufman->getSampleRate()).c_str());
 
+	txSampleRate = bufman->getSampleRate();
+	txEnabledMask = chm.get_enabled_mask();
+	txModeMask = chm.get_mode_mask();
+
+	if (streaming) {
+		qDebug("Starting stream");
+
+		if (!stream.prepare(&chm, bufman->buffer, bufman->getBufferSize(),
+		                    bufman->getSampleRate(),
+		                    bufman->getRequiredBufferSize())) {
+			qWarning("Can't stream: %s", stream.getError().c_str());
+			return false;
+		}
+
+		if (!stream.start(dev, cyclic)) {
+			return false;
+		}
+	} else if (!pushBuffer(cyclic)) {
+		return false;
+	}
+
+	setPGStatus(RUNNING);
+	return true;
+}
+
+bool PatternGenerator::pushBuffer(bool cyclic)
+{
 	qDebug("Creating buffer");
 	txbuf = iio_device_create_buffer(dev, bufman->getBufferSize(), cyclic);
 
@@ -829,20 +888,27 @@ bool PatternGenerator::startPatternGeneration(bool cyclic)
 	}
 
 	buffer_created = true;
-	short *p_dat;
-	ptrdiff_t p_inc;
-
-	int i = 0;
-
-	for (p_dat = (short *)iio_buffer_start(txbuf); (p_dat < iio_buffer_end(txbuf));
-	     (uint16_t *)p_dat++,i++) {
-		*p_dat = bufman->buffer[i];
+	txCyclic = cyclic;
+	txBufferSize = bufman->getBufferSize();
+	txGeneration = bufman->getGeneration();
+
+	char *dst = (char *)iio_buffer_start(txbuf);
+	ptrdiff_t step = iio_buffer_step(txbuf);
+	size_t samples = std::min<size_t>(bufman->getBufferSize(),
+	                                  ((char *)iio_buffer_end(txbuf) - dst) / step);
+
+	// Samples are laid out contiguously, so a single copy is enough
+	if (step == sizeof(short)) {
+		memcpy(dst, bufman->buffer, samples * sizeof(short));
+	} else {
+		for (size_t i = 0; i < samples; i++, dst += step) {
+			memcpy(dst, &bufman->buffer[i], sizeof(short));
+		}
 	}
 
 	/* Push buffer       */
 	auto number_of_bytes = iio_buffer_push(txbuf);
 	qDebug("\nPushed %ld bytes to devices\r\n",number_of_bytes);
-	setPGStatus(RUNNING);
 	return true;
 }
 
@@ -853,6 +919,7 @@ void PatternGenerator::stopPatternGeneration()
 
 		/* Reset Tx Channls*/
 		diom->unlock();
+		stream.stop();
 
 		if (buffer_created == true) {
 			iio_buffer_destroy(txbuf);
@@ -900,8 +967,10 @@ void PatternGenerator::singleRun()
 	ui->btnRunStop->setChecked(false);
 
 	if (startPatternGeneration(false)) {
+		uint32_t samples = (streaming) ? stream.getTotalSamples() :
+		                   bufman->getBufferSize()/2;
 		uint32_t time_until_buffer_destroy = 500 + (uint32_t)(((
-		                bufman->getBufferSize()/2)/((
+		                samples)/((
 		                                float)bufman->getSampleRate()))*1000.0);
 		qDebug("Time until buffer destroy %d", time_until_buffer_destroy);
 
@@ -1188,4 +1257,22 @@ void PatternGenerator_API::run_single(bool en)
 	pg->ui->btnSingleRun->setChecked(en);
 }
 
+bool PatternGenerator_API::streaming() const
+{
+	return pg->streaming;
+}
+
+void PatternGenerator_API::setStreaming(bool en)
+{
+	if (pg->streaming != en) {
+		pg->streaming = en;
+		pg->reloadBufferInDevice();
+	}
+}
+
+int PatternGenerator_API::underruns() const
+{
+	return (int)pg->stream.getUnderruns();
+}
+
 }
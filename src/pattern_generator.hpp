@@ -30,6 +30,7 @@
 #include "pg_patterns.hpp"
 #include "pg_channel_manager.hpp"
 #include "pg_buffer_manager.hpp"
+#include "pg_stream.hpp"
 #include "tool.hpp"
 
 
@@ -101,6 +102,7 @@ public:
 private Q_SLOTS:
 
 	void generatePattern();
+	void updatePattern();
 	void startStop(bool start);
 	void singleRun();
 	void singleRunStop();
@@ -165,7 +167,20 @@ private:
 	struct iio_buffer *txbuf;
 	DIOManager *diom;
 
+	// What the TX buffer was created from
+	uint32_t txSampleRate;
+	uint32_t txBufferSize;
+	uint32_t txGeneration;
+	uint16_t txEnabledMask;
+	uint16_t txModeMask;
+	bool txCyclic;
+
+	// Plays sequences longer than the device memory
+	bool streaming;
+	PatternGeneratorStream stream;
+
 	bool startPatternGeneration(bool cyclic);
+	bool pushBuffer(bool cyclic);
 	void stopPatternGeneration();
 	void toggleRightMenu(QPushButton *btn);
 
@@ -323,6 +338,8 @@ class PatternGenerator_API : public ApiObject
 
 	Q_PROPERTY(bool running READ running WRITE run STORED false);
 	Q_PROPERTY(bool single READ single WRITE run_single STORED false);
+	Q_PROPERTY(bool streaming READ streaming WRITE setStreaming STORED false);
+	Q_PROPERTY(int underruns READ underruns STORED false);
 
 public:
 	explicit PatternGenerator_API(PatternGenerator *pg) :
@@ -343,6 +360,10 @@ public:
 	bool single() const;
 	void run_single(bool en);
 
+	bool streaming() const;
+	void setStreaming(bool en);
+	int underruns() const;
+
 private:
 	void refreshApi();
 	PatternGenerator *pg;
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "pg_buffer_manager.hpp"
 #include "pattern_generator.hpp"
 
@@ -10,55 +12,58 @@ PatternGeneratorBufferManager::PatternGeneratorBufferManager(
 	bufferSize = 1;
 	buffer = new short[bufferSize];
 	sampleRate = 1;
+	generatedBufferSize = 0;
+	generatedSampleRate = 0;
+	generation = 0;
+	requiredBufferSize = 1;
 }
 
 PatternGeneratorBufferManager::~PatternGeneratorBufferManager()
 {
-	delete buffer;
+	delete[] buffer;
 }
 
 void PatternGeneratorBufferManager::update(PatternGeneratorChannelGroup *chg)
 {
-	bool sampleRateChanged = false;
-
 	chm->preGenerate();
 	uint32_t suggestedSampleRate = (autoSet) ? chm->computeSuggestedSampleRate() :
 	                               sampleRate;
 	uint32_t adjustedSampleRate = adjustSampleRate(suggestedSampleRate);
 
-	if (sampleRate != adjustedSampleRate) {
-		sampleRate = adjustedSampleRate;
-		sampleRateChanged = true;
-	}
+	sampleRate = adjustedSampleRate;
 
-	bool bufferSizeChanged = false;
 	uint32_t suggestedBufferSize = (autoSet) ? chm->computeSuggestedBufferSize(
 	                                       sampleRate) : bufferSize;
 	uint32_t adjustedBufferSize = adjustBufferSize(suggestedBufferSize);
 
-	if (bufferSize != adjustedBufferSize) {
-		bufferSize = adjustedBufferSize;
-		bufferSizeChanged = true;
-	}
+	requiredBufferSize = std::max(suggestedBufferSize, adjustedBufferSize);
 
-	if (sampleRateChanged) {
-		// recreate sigrok buffer
-	}
+	bufferSize = adjustedBufferSize;
+
+	// setSampleRate()/setBufferSize() may have changed them since the
+	// last update, so compare with what the buffer was generated for
+	bool sampleRateChanged = (sampleRate != generatedSampleRate);
+	bool bufferSizeChanged = (bufferSize != generatedBufferSize);
 
 	if (bufferSizeChanged) {
 		// recreate local buffer
-		delete buffer;
+		delete[] buffer;
 		buffer = new short[bufferSize];
 	}
 
-	memset(buffer, 0x0000, (bufferSize)*sizeof(short));
-	chm->generatePatterns(buffer, sampleRate, bufferSize);
-
 	if (sampleRateChanged || bufferSizeChanged) {
 		// regenerate all
-	} else {
-		// only generate current ?
+		memset(buffer, 0x0000, (bufferSize)*sizeof(short));
+		chm->invalidatePatterns();
+		generation++;
 	}
+
+	if (chm->generatePatterns(buffer, sampleRate, bufferSize)) {
+		generation++;
+	}
+
+	generatedSampleRate = sampleRate;
+	generatedBufferSize = bufferSize;
 }
 
 void PatternGeneratorBufferManager::enableAutoSet(bool val)
@@ -98,6 +103,16 @@ uint32_t PatternGeneratorBufferManager::getBufferSize()
 	return bufferSize;
 }
 
+uint32_t PatternGeneratorBufferManager::getGeneration()
+{
+	return generation;
+}
+
+uint32_t PatternGeneratorBufferManager::getRequiredBufferSize()
+{
+	return requiredBufferSize;
+}
+
 void PatternGeneratorBufferManager::setSampleRate(uint32_t val)
 {
 	sampleRate = val;
@@ -130,9 +145,10 @@ PatternGeneratorBufferManagerUi::PatternGeneratorBufferManagerUi(
 	createBinaryBuffer();
 }
 
-void PatternGeneratorBufferManagerUi::updateUi()
+void PatternGeneratorBufferManagerUi::updateUi(PatternGeneratorChannelGroup
+                *chg)
 {
-	bufman->update();
+	bufman->update(chg);
 	reloadPVDevice();
 
 	auto scale = (1/(double)bufman->getSampleRate()) * bufman->getBufferSize() /
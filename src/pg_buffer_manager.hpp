@@ -49,6 +49,10 @@ class PatternGeneratorBufferManager
 	uint32_t start_sample;
 	uint32_t last_sample;
 	uint32_t sampleRate;
+	uint32_t generatedSampleRate;
+	uint32_t generatedBufferSize;
+	uint32_t generation;
+	uint32_t requiredBufferSize;
 	PatternGeneratorChannelManager *chm;
 
 public:
@@ -64,6 +68,13 @@ public:
 	uint32_t getSampleRate();
 	uint32_t getBufferSize();
 
+	// Changes every time the content of the buffer changes
+	uint32_t getGeneration();
+
+	// Number of samples the patterns need, even if it doesn't fit in
+	// the buffer
+	uint32_t getRequiredBufferSize();
+
 	uint32_t bufferSize;
 	short *buffer;
 
@@ -94,7 +105,7 @@ public:
 Q_SIGNALS:
 	void uiUpdated();
 public Q_SLOTS:
-	void updateUi();
+	void updateUi(PatternGeneratorChannelGroup *chg = nullptr);
 };
 
 
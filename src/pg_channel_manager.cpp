@@ -8,9 +8,12 @@
 #include "pulseview/pv/view/decodetrace.hpp"
 #include "pg_patterns.hpp"
 #include "pg_channel_manager.hpp"
+#include "pg_remap.hpp"
 #include "pattern_generator.hpp"
 #include "dynamicWidget.hpp"
+#include "decoder_index.hpp"
 #include <glib.h>
+#include <algorithm>
 #include "boost/math/common_factor.hpp"
 #include "libsigrokdecode/libsigrokdecode.h"
 
@@ -418,6 +421,7 @@ PatternGeneratorChannelGroup::PatternGeneratorChannelGroup(
 	enabled = false;
 	pattern=PatternFactory::create(0);
 	ch_thickness = 1.0;
+	dirty = true;
 }
 
 PatternGeneratorChannelGroup::~PatternGeneratorChannelGroup()
@@ -456,6 +460,38 @@ qreal PatternGeneratorChannelGroup::getCh_thickness() const
 	return ch_thickness;
 }
 
+void PatternGeneratorChannelGroup::invalidate()
+{
+	dirty = true;
+}
+
+bool PatternGeneratorChannelGroup::needsUpdate()
+{
+	if (dirty || pattern->is_dirty() ||
+	    generated_channels.size() != get_channel_count()) {
+		return true;
+	}
+
+	for (int i=0; i<get_channel_count(); i++) {
+		if (generated_channels[i] != get_channel(i)->get_id()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void PatternGeneratorChannelGroup::setUpToDate()
+{
+	dirty = false;
+	pattern->set_dirty(false);
+	generated_channels.clear();
+
+	for (int i=0; i<get_channel_count(); i++) {
+		generated_channels.push_back(get_channel(i)->get_id());
+	}
+}
+
 void PatternGeneratorChannelGroup::setCh_thickness(const qreal value)
 {
 	ch_thickness = value;
@@ -812,7 +848,7 @@ std::map<const srd_channel *,
                     std::vector<int> ids)
 {
 
-	auto decoder = srd_decoder_get_by_id(decstr);
+	auto decoder = DecoderIndex::decoder(decstr);
 
 	std::map<const srd_channel *,
 	    std::shared_ptr<pv::view::TraceTreeItem> > channel_map;
@@ -1154,7 +1190,7 @@ PatternGeneratorChannelManager::PatternGeneratorChannelManager() :
 	highlightedChannel = nullptr;
 	highlightedChannelGroup = static_cast<PatternGeneratorChannelGroup *>
 	                          (channel_group[0]);
-
+	generatedMask = 0;
 }
 
 PatternGeneratorChannel *PatternGeneratorChannelManager::get_channel(int index)
@@ -1341,24 +1377,76 @@ PatternGeneratorChannel *PatternGeneratorChannelManager::getHighlightedChannel()
 void PatternGeneratorChannelManager::preGenerate()
 {
 	for (auto&& chg : channel_group) {
-		static_cast<PatternGeneratorChannelGroup *>(chg)->pattern->pre_generate();
+		auto pgchg = static_cast<PatternGeneratorChannelGroup *>(chg);
+
+		// Marks the pattern dirty when its output changed
+		pgchg->pattern->pre_generate();
 	}
 }
 
-void PatternGeneratorChannelManager::generatePatterns(short *mainBuffer,
+void PatternGeneratorChannelManager::invalidatePatterns()
+{
+	for (auto&& chg : channel_group) {
+		static_cast<PatternGeneratorChannelGroup *>(chg)->invalidate();
+	}
+
+	generatedMask = 0;
+}
+
+bool PatternGeneratorChannelManager::generatePatterns(short *mainBuffer,
                 uint32_t sampleRate, uint32_t bufferSize)
 {
+	uint16_t enabled_mask = 0;
+	bool changed = false;
+
 	for (auto&& chg : channel_group) {
 		PatternGeneratorChannelGroup *pgchg =
 		        static_cast<PatternGeneratorChannelGroup *>(chg);
 
-		if (pgchg->is_enabled()) {
+		if (!pgchg->is_enabled()) {
+			// Sampled again once it is enabled
+			pgchg->invalidate();
+			continue;
+		}
+
+		enabled_mask |= pgchg->get_mask();
+
+		if (!pgchg->needsUpdate()) {
+			continue;
+		}
+
+		if (pgchg->pattern->generate_runs(sampleRate,bufferSize,
+		                                  pgchg->get_channel_count())) {
+			commitRuns(pgchg, mainBuffer, bufferSize);
+			pgchg->pattern->delete_runs();
+		} else {
 			pgchg->pattern->generate_pattern(sampleRate,bufferSize,
 			                                 pgchg->get_channel_count());
-			commitBuffer(pgchg, mainBuffer, bufferSize);
+
+			if (pgchg->pattern->get_buffer()) {
+				commitBuffer(pgchg, mainBuffer, bufferSize);
+			}
+
 			pgchg->pattern->delete_buffer();
 		}
+
+		pgchg->setUpToDate();
+		changed = true;
 	}
+
+	// Clear the channels which no longer belong to an enabled group
+	const uint16_t stale_mask = generatedMask & ~enabled_mask;
+
+	if (stale_mask) {
+		for (uint32_t j=0; j<bufferSize; j++) {
+			mainBuffer[j] &= ~stale_mask;
+		}
+
+		changed = true;
+	}
+
+	generatedMask = enabled_mask;
+	return changed;
 }
 
 
@@ -1366,39 +1454,73 @@ void PatternGeneratorChannelManager::generatePatterns(short *mainBuffer,
 short PatternGeneratorChannelManager::remap_buffer(uint8_t *mapping,
                 uint32_t val)
 {
-	short ret=0;
-	int i=0;
+	return PatternRemap::remap(mapping, val);
+}
 
-	while (val) {
-		if (val&0x01) {
-			ret = ret | (1<<mapping[i]);
-		}
+static void get_channel_mapping(PatternGeneratorChannelGroup *chg,
+                                uint8_t *channel_mapping)
+{
+	memset(channel_mapping,0x00,16*sizeof(uint8_t));
 
-		i++;
-		val>>=1;
+	for (int i=0; i<chg->get_channel_count(); i++) {
+		channel_mapping[i] = chg->get_channel(i)->get_id();
 	}
-
-	return ret;
 }
 
 void PatternGeneratorChannelManager::commitBuffer(PatternGeneratorChannelGroup
                 *chg, short *buffer, uint32_t bufferSize)
 {
 	uint8_t channel_mapping[16];
-	memset(channel_mapping,0x00,16*sizeof(uint8_t));
-	short *bufferPtr = chg->pattern->get_buffer();
-	int i=0,j=0;
-	auto channel_enable_mask_temp = chg->get_mask();
+
+	get_channel_mapping(chg, channel_mapping);
+
+	PatternRemap remap(channel_mapping, chg->get_channel_count(),
+	                   chg->get_mask());
+	remap.merge(buffer, chg->pattern->get_buffer(), bufferSize);
+}
+
+void PatternGeneratorChannelManager::commitRuns(PatternGeneratorChannelGroup
+                *chg, short *buffer, uint32_t bufferSize)
+{
+	uint8_t channel_mapping[16];
+	const std::vector<PatternRun>& runs = chg->pattern->get_runs();
 	auto buffer_channel_mask = (1<<chg->get_channel_count())-1;
+	const uint16_t keep_mask = ~(uint16_t)chg->get_mask();
+	uint64_t period = 0;
 
-	for (i=0; i<chg->get_channel_count(); i++) {
-		channel_mapping[i] = chg->get_channel(i)->get_id();
+	get_channel_mapping(chg, channel_mapping);
+
+	// Each run is remapped once, whatever its length
+	std::vector<uint16_t> values;
+	values.reserve(runs.size());
+
+	for (const PatternRun& run : runs) {
+		values.push_back(remap_buffer(channel_mapping,
+		                              run.value & buffer_channel_mask));
+		period += run.length;
 	}
 
-	for (auto i=0; i< bufferSize; i++) {
-		auto val = (bufferPtr[i] & buffer_channel_mask);
-		buffer[i] = (buffer[i] & ~(chg->get_mask())) | remap_buffer(channel_mapping,
-		                val);
+	if (period == 0) {
+		for (uint32_t j=0; j<bufferSize; j++) {
+			buffer[j] &= keep_mask;
+		}
+
+		return;
+	}
+
+	// Expand the runs, starting over until the buffer is full
+	uint32_t j=0;
+
+	while (j<bufferSize) {
+		for (size_t r=0; r<runs.size() && j<bufferSize; r++) {
+			const uint32_t end = (uint32_t)std::min<uint64_t>(bufferSize,
+			                     (uint64_t)j + runs[r].length);
+			const uint16_t value = values[r];
+
+			for (; j<end; j++) {
+				buffer[j] = (buffer[j] & keep_mask) | value;
+			}
+		}
 	}
 }
 
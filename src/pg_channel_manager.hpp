@@ -123,8 +123,16 @@ public:
 	qreal getCh_thickness() const;
 	void setCh_thickness(const qreal value);
 
+	// The samples of the group are kept in the main buffer until the
+	// pattern or the channels of the group change
+	void invalidate();
+	bool needsUpdate();
+	void setUpToDate();
+
 private:
 	qreal ch_thickness;
+	bool dirty;
+	std::vector<uint16_t> generated_channels;
 };
 
 class PatternGeneratorChannelGroupUI : public ChannelGroupUI
@@ -210,6 +218,7 @@ class PatternGeneratorChannelManager : public ChannelManager
 	PatternGeneratorChannelGroup *highlightedChannelGroup;
 	PatternGeneratorChannel *highlightedChannel;
 	const uint32_t maxBufferSize = 1000000;
+	uint16_t generatedMask;
 
 public:
 	void highlightChannel(PatternGeneratorChannelGroup *chg,
@@ -227,10 +236,13 @@ public:
 	void moveChannel(int fromChgIndex, int from, int to, bool after=true);
 	void splitChannel(int chgIndex, int chIndex);
 	void preGenerate();
-	void generatePatterns(short *mainbuffer, uint32_t sampleRate,
+	void invalidatePatterns();
+	bool generatePatterns(short *mainbuffer, uint32_t sampleRate,
 	                      uint32_t bufferSize);
 	void commitBuffer(PatternGeneratorChannelGroup *chg, short *mainBuffer,
 	                  uint32_t bufferSize);
+	void commitRuns(PatternGeneratorChannelGroup *chg, short *mainBuffer,
+	                uint32_t bufferSize);
 	short remap_buffer(uint8_t *mapping, uint32_t val);
 
 	uint32_t computeSuggestedSampleRate();
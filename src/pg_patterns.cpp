@@ -19,6 +19,7 @@
 
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
 #include <QtQml/QJSEngine>
 #include <QtQml/QQmlEngine>
 #include <QPushButton>
@@ -26,6 +27,7 @@
 #include <QDirIterator>
 
 #include <errno.h>
+#include <algorithm>
 #include "boost/math/common_factor.hpp"
 #include "pg_patterns.hpp"
 #include "pattern_generator.hpp"
@@ -35,6 +37,81 @@ using namespace adiscope;
 
 namespace adiscope {
 
+/*
+ * Pattern buffers only live from generate_pattern() until the samples are
+ * committed to the main buffer, so the blocks are recycled instead of
+ * going through the allocator for every pattern of every update.
+ *
+ * Only blocks up to the size of the main buffer are kept, which bounds the
+ * arena to maxBlocks * maxBlockSize samples; the much longer sequences
+ * generated for streaming are allocated and freed on their own.
+ */
+class PatternBufferArena
+{
+public:
+	static short *acquire(uint32_t size, uint32_t *capacity)
+	{
+		auto& free_blocks = blocks();
+
+		if (size > maxBlockSize) {
+			*capacity = size;
+			return new short[size];
+		}
+
+		for (auto it = free_blocks.begin(); it != free_blocks.end(); ++it) {
+			if (it->second >= size) {
+				short *block = it->first;
+				*capacity = it->second;
+				free_blocks.erase(it);
+				return block;
+			}
+		}
+
+		*capacity = size;
+		return new short[size];
+	}
+
+	static void release(short *block, uint32_t capacity)
+	{
+		auto& free_blocks = blocks();
+
+		if (capacity > maxBlockSize) {
+			delete[] block;
+			return;
+		}
+
+		if (free_blocks.size() >= maxBlocks) {
+			// Keep the largest blocks around
+			auto smallest = std::min_element(free_blocks.begin(),
+			                                 free_blocks.end(),
+			[](const std::pair<short *, uint32_t>& a,
+			   const std::pair<short *, uint32_t>& b) {
+				return a.second < b.second;
+			});
+
+			if (smallest->second >= capacity) {
+				delete[] block;
+				return;
+			}
+
+			delete[] smallest->first;
+			free_blocks.erase(smallest);
+		}
+
+		free_blocks.push_back(std::make_pair(block, capacity));
+	}
+
+private:
+	static std::vector<std::pair<short *, uint32_t>>& blocks()
+	{
+		static std::vector<std::pair<short *, uint32_t>> free_blocks;
+		return free_blocks;
+	}
+
+	static const size_t maxBlocks = 4;
+	static const uint32_t maxBlockSize = 1048576;
+};
+
 JSConsole::JSConsole(QObject *parent) :
 	QObject(parent)
 {
@@ -49,6 +126,8 @@ Pattern::Pattern()
 {
 	// qDebug()<<"PatternCreated";
 	buffer = nullptr;
+	buffer_capacity = 0;
+	dirty = true;
 }
 
 Pattern::~Pattern()
@@ -94,6 +173,7 @@ bool Pattern::is_periodic()
 
 void Pattern::set_periodic(bool periodic_)
 {
+	set_dirty(true);
 	periodic=periodic_;
 }
 
@@ -102,13 +182,54 @@ short *Pattern::get_buffer()
 	return buffer;
 }
 
+short *Pattern::allocate_buffer(uint32_t number_of_samples)
+{
+	if (buffer && buffer_capacity >= number_of_samples) {
+		return buffer;
+	}
+
+	delete_buffer();
+	buffer = PatternBufferArena::acquire(number_of_samples, &buffer_capacity);
+	return buffer;
+}
+
 void Pattern::delete_buffer()
 {
 	if (buffer) {
-		delete buffer;
+		PatternBufferArena::release(buffer, buffer_capacity);
 	}
 
 	buffer=nullptr;
+	buffer_capacity=0;
+}
+
+void Pattern::append_run(uint16_t value, uint32_t length)
+{
+	if (length == 0) {
+		return;
+	}
+
+	if (!runs.empty() && runs.back().value == value) {
+		runs.back().length += length;
+	} else {
+		runs.push_back({length, value});
+	}
+}
+
+bool Pattern::generate_runs(uint32_t sample_rate,
+                            uint32_t number_of_samples, uint16_t number_of_channels)
+{
+	return false;
+}
+
+const std::vector<PatternRun>& Pattern::get_runs()
+{
+	return runs;
+}
+
+void Pattern::delete_runs()
+{
+	runs.clear();
 }
 
 uint8_t Pattern::pre_generate()
@@ -116,6 +237,16 @@ uint8_t Pattern::pre_generate()
 	return 0;
 }
 
+bool Pattern::is_dirty()
+{
+	return dirty;
+}
+
+void Pattern::set_dirty(bool dirty_)
+{
+	dirty = dirty_;
+}
+
 std::string Pattern::toString()
 {
 	return "";
@@ -362,6 +493,7 @@ float ClockPattern::get_duty_cycle() const
 
 void ClockPattern::set_duty_cycle(float value)
 {
+	set_dirty(true);
 	if (value>100) {
 		value = 100;
 	}
@@ -378,6 +510,7 @@ float ClockPattern::get_frequency() const
 
 void ClockPattern::set_frequency(float value)
 {
+	set_dirty(true);
 	frequency = value;
 }
 
@@ -388,6 +521,7 @@ int ClockPattern::get_phase() const
 
 void ClockPattern::set_phase(int value)
 {
+	set_dirty(true);
 	phase = value;
 
 	if (phase>360) {
@@ -442,8 +576,7 @@ uint8_t ClockPattern::generate_pattern(uint32_t sample_rate,
 		period_number_of_samples=1;
 	}
 
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 	int i=0;
 
 	// phased samples
@@ -463,6 +596,47 @@ uint8_t ClockPattern::generate_pattern(uint32_t sample_rate,
 	return 0;
 }
 
+bool ClockPattern::generate_runs(uint32_t sample_rate,
+                                 uint32_t number_of_samples, uint16_t number_of_channels)
+{
+	float f_period_number_of_samples = (float)sample_rate/frequency;
+	float f_low_number_of_samples = (f_period_number_of_samples *
+	                                 (100-duty_cycle)) / 100;
+
+	int period_number_of_samples = (int)round(f_period_number_of_samples);
+	int low_number_of_samples = (int)round(f_low_number_of_samples);
+
+	if (period_number_of_samples==0) {
+		period_number_of_samples=1;
+	}
+
+	low_number_of_samples = std::min(std::max(low_number_of_samples, 0),
+	                                 period_number_of_samples);
+
+	// phased samples
+	int phased = (period_number_of_samples * phase/360) %
+	             period_number_of_samples;
+
+	if (phased < 0) {
+		phased += period_number_of_samples;
+	}
+
+	// A single period, starting from the phase offset
+	delete_runs();
+
+	if (phased < low_number_of_samples) {
+		append_run(0, low_number_of_samples - phased);
+		append_run(0xffff, period_number_of_samples - low_number_of_samples);
+		append_run(0, phased);
+	} else {
+		append_run(0xffff, period_number_of_samples - phased);
+		append_run(0, low_number_of_samples);
+		append_run(0xffff, phased - low_number_of_samples);
+	}
+
+	return true;
+}
+
 ClockPatternUI::ClockPatternUI(ClockPattern *pattern,
                                QWidget *parent) : PatternUI(parent), pattern(pattern)
 {
@@ -595,6 +769,7 @@ uint16_t NumberPattern::get_nr() const
 
 void NumberPattern::set_nr(const uint16_t& value)
 {
+	set_dirty(true);
 	nr = value;
 }
 
@@ -607,8 +782,7 @@ NumberPattern::NumberPattern()
 uint8_t NumberPattern::generate_pattern(uint32_t sample_rate,
                                         uint32_t number_of_samples, uint16_t number_of_channels)
 {
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 
 	for (auto i=0; i<number_of_samples; i++) {
 		buffer[i] = nr;
@@ -617,6 +791,14 @@ uint8_t NumberPattern::generate_pattern(uint32_t sample_rate,
 	return 0;
 }
 
+bool NumberPattern::generate_runs(uint32_t sample_rate,
+                                  uint32_t number_of_samples, uint16_t number_of_channels)
+{
+	delete_runs();
+	append_run(nr, number_of_samples);
+	return true;
+}
+
 
 NumberPatternUI::NumberPatternUI(NumberPattern *pattern,
                                  QWidget *parent) : PatternUI(parent), pattern(pattern)
@@ -709,14 +891,14 @@ uint32_t RandomPattern::get_frequency() const
 
 void RandomPattern::set_frequency(const uint32_t& value)
 {
+	set_dirty(true);
 	frequency = value;
 }
 
 uint8_t RandomPattern::generate_pattern(uint32_t sample_rate,
                                         uint32_t number_of_samples, uint16_t number_of_channels)
 {
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 	auto samples_per_count = ((float)sample_rate/(float)frequency);
 	int j=0;
 
@@ -805,6 +987,7 @@ uint32_t BinaryCounterPattern::get_frequency() const
 
 void BinaryCounterPattern::set_frequency(const uint32_t& value)
 {
+	set_dirty(true);
 	frequency = value;
 }
 
@@ -815,6 +998,7 @@ uint16_t BinaryCounterPattern::get_start_value() const
 
 void BinaryCounterPattern::set_start_value(const uint16_t& value)
 {
+	set_dirty(true);
 	start_value = value;
 }
 
@@ -825,6 +1009,7 @@ uint16_t BinaryCounterPattern::get_end_value() const
 
 void BinaryCounterPattern::set_end_value(const uint16_t& value)
 {
+	set_dirty(true);
 	end_value = value;
 }
 
@@ -835,6 +1020,7 @@ uint16_t BinaryCounterPattern::get_increment() const
 
 void BinaryCounterPattern::set_increment(const uint16_t& value)
 {
+	set_dirty(true);
 	increment = value;
 }
 
@@ -845,6 +1031,7 @@ uint16_t BinaryCounterPattern::get_init_value() const
 
 void BinaryCounterPattern::set_init_value(const uint16_t& value)
 {
+	set_dirty(true);
 	init_value = value;
 }
 
@@ -865,8 +1052,7 @@ BinaryCounterPattern::~BinaryCounterPattern()
 uint8_t BinaryCounterPattern::generate_pattern(uint32_t sample_rate,
                 uint32_t number_of_samples, uint16_t number_of_channels)
 {
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 	auto samples_per_count = ((float)sample_rate/(float)frequency);
 	//auto i=init_value;
 	auto i = 0;
@@ -894,6 +1080,32 @@ uint8_t BinaryCounterPattern::generate_pattern(uint32_t sample_rate,
 	return 0;
 }
 
+void BinaryCounterPattern::generate_counter_runs(uint32_t sample_rate,
+                uint32_t number_of_samples, uint16_t number_of_channels, bool gray)
+{
+	auto samples_per_count = ((float)sample_rate/(float)frequency);
+	uint32_t count_length = std::max((uint32_t)ceil(samples_per_count),
+	                                 (uint32_t)1);
+	uint32_t last_value = (1<<number_of_channels)-1;
+	uint32_t covered = 0;
+
+	// One counter cycle, or less if it doesn't fit in the buffer
+	delete_runs();
+
+	for (uint32_t i=0; i<=last_value && covered<number_of_samples; i++) {
+		append_run((gray) ? (i ^ (i >> 1)) : i, count_length);
+		covered += count_length;
+	}
+}
+
+bool BinaryCounterPattern::generate_runs(uint32_t sample_rate,
+                uint32_t number_of_samples, uint16_t number_of_channels)
+{
+	generate_counter_runs(sample_rate, number_of_samples, number_of_channels,
+	                      false);
+	return true;
+}
+
 BinaryCounterPatternUI::BinaryCounterPatternUI(BinaryCounterPattern *pattern,
                 QWidget *parent) : PatternUI(parent), pattern(pattern)
 {
@@ -966,8 +1178,7 @@ GrayCounterPattern::GrayCounterPattern()
 uint8_t GrayCounterPattern::generate_pattern(uint32_t sample_rate,
                 uint32_t number_of_samples, uint16_t number_of_channels)
 {
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 	auto samples_per_count = ((float)sample_rate/(float)frequency);
 	init_value = 0;
 	end_value =(1<< (number_of_channels))-1;
@@ -995,6 +1206,18 @@ uint8_t GrayCounterPattern::generate_pattern(uint32_t sample_rate,
 	return 0;
 }
 
+bool GrayCounterPattern::generate_runs(uint32_t sample_rate,
+                uint32_t number_of_samples, uint16_t number_of_channels)
+{
+	init_value = 0;
+	end_value =(1<< (number_of_channels))-1;
+	increment = 1;
+	start_value = 0;
+	generate_counter_runs(sample_rate, number_of_samples, number_of_channels,
+	                      true);
+	return true;
+}
+
 GrayCounterPatternUI::GrayCounterPatternUI(GrayCounterPattern *pattern,
                 QWidget *parent) : PatternUI(parent), pattern(pattern)
 {
@@ -1091,6 +1314,7 @@ enum UARTPattern::sp_parity UARTPattern::get_parity()
 
 void UARTPattern::set_string(std::string str_)
 {
+	set_dirty(true);
 	str = str_;
 }
 
@@ -1106,6 +1330,7 @@ std::string UARTPattern::get_params()
 
 int UARTPattern::set_params(std::string params_)
 {
+	set_dirty(true);
 	// https://github.com/analogdevicesinc/libiio/blob/master/serial.c#L426
 	params = params_;
 	const char *params = params_.c_str();
@@ -1174,6 +1399,7 @@ int UARTPattern::set_params(std::string params_)
 
 void UARTPattern::set_msb_first(bool msb_first_)
 {
+	set_dirty(true);
 	msb_first = msb_first_;
 }
 
@@ -1277,7 +1503,6 @@ uint32_t UARTPattern::get_required_nr_of_samples(uint32_t sample_rate,
 uint8_t UARTPattern::generate_pattern(uint32_t sample_rate,
                                       uint32_t number_of_samples, uint16_t number_of_channels)
 {
-	delete_buffer();
 	uint16_t number_of_frames = str.length();
 	uint32_t samples_per_bit = sample_rate/baud_rate;
 	qDebug()<< "samples_per_bit - "<<(float)sample_rate/(float)baud_rate;
@@ -1285,7 +1510,7 @@ uint8_t UARTPattern::generate_pattern(uint32_t sample_rate,
 	encapsulateUartFrame(*(str.c_str()), &bits_per_frame);
 	uint32_t samples_per_frame = samples_per_bit * bits_per_frame;
 
-	buffer = new short[number_of_samples]; // no need to recreate buffer
+	allocate_buffer(number_of_samples);
 	auto buffersize = (number_of_samples)*sizeof(short);
 	memset(buffer, 0xffff, (number_of_samples)*sizeof(short));
 
@@ -1331,6 +1556,47 @@ uint8_t UARTPattern::generate_pattern(uint32_t sample_rate,
 	return 0;
 }
 
+bool UARTPattern::generate_runs(uint32_t sample_rate,
+                                uint32_t number_of_samples, uint16_t number_of_channels)
+{
+	uint32_t samples_per_bit = sample_rate/baud_rate;
+	uint16_t bits_per_frame;
+	encapsulateUartFrame(*(str.c_str()), &bits_per_frame);
+	uint32_t samples_per_frame = samples_per_bit * bits_per_frame;
+	uint32_t covered = 0;
+
+	delete_runs();
+
+	append_run(1, samples_per_frame/2); // pad with half a frame
+	covered += samples_per_frame/2;
+
+	for (auto chr : str) {
+		auto frame_to_send = encapsulateUartFrame(chr, &bits_per_frame);
+
+		for (auto j=0; j<bits_per_frame; j++) {
+			short bit_to_send;
+
+			if (!msb_first) {
+				bit_to_send = (frame_to_send & 0x01);
+				frame_to_send = frame_to_send >> 1;
+			} else {
+				bit_to_send = ((frame_to_send & (1<<(bits_per_frame-1))) ? 1 :
+				               0);
+				frame_to_send = frame_to_send << 1;
+			}
+
+			append_run(bit_to_send, samples_per_bit);
+			covered += samples_per_bit;
+		}
+	}
+
+	// idle until the end of the buffer
+	if (covered < number_of_samples) {
+		append_run(1, number_of_samples - covered);
+	}
+
+	return true;
+}
 
 UARTPatternUI::UARTPatternUI(UARTPattern *pattern,
                              QWidget *parent) : PatternUI(parent), pattern(pattern)
@@ -1404,6 +1670,7 @@ uint8_t I2CPattern::getAddress() const
 
 void I2CPattern::setAddress(const uint8_t& value)
 {
+	set_dirty(true);
 	address = value;
 }
 
@@ -1414,6 +1681,7 @@ bool I2CPattern::getWrite() const
 
 void I2CPattern::setWrite(bool value)
 {
+	set_dirty(true);
 	read = value;
 }
 
@@ -1424,6 +1692,7 @@ bool I2CPattern::getMsbFirst() const
 
 void I2CPattern::setMsbFirst(bool value)
 {
+	set_dirty(true);
 	msbFirst = value;
 }
 
@@ -1434,6 +1703,7 @@ uint8_t I2CPattern::getInterFrameSpace() const
 
 void I2CPattern::setInterFrameSpace(const uint8_t& value)
 {
+	set_dirty(true);
 	interFrameSpace = value;
 }
 
@@ -1444,6 +1714,7 @@ uint32_t I2CPattern::getClkFrequency() const
 
 void I2CPattern::setClkFrequency(const uint32_t& value)
 {
+	set_dirty(true);
 	clkFrequency = value;
 }
 
@@ -1454,6 +1725,7 @@ uint8_t I2CPattern::getBytesPerFrame() const
 
 void I2CPattern::setBytesPerFrame(const uint8_t& value)
 {
+	set_dirty(true);
 	bytesPerFrame = value;
 }
 
@@ -1464,6 +1736,7 @@ bool I2CPattern::getTenbit() const
 
 void I2CPattern::setTenbit(bool value)
 {
+	set_dirty(true);
 	tenbit = value;
 }
 
@@ -1586,9 +1859,7 @@ void I2CPattern::sample_stop()
 uint8_t I2CPattern::generate_pattern(uint32_t sample_rate,
                                      uint32_t number_of_samples, uint16_t number_of_channels)
 {
-	delete_buffer();
-
-	buffer = new short[number_of_samples]; // no need to recreate buffer
+	allocate_buffer(number_of_samples);
 	buf_ptr = buffer;
 	auto buffersize = (number_of_samples)*sizeof(short);
 	memset(buffer, (0xffff), (number_of_samples)*sizeof(short));
@@ -1694,6 +1965,7 @@ void I2CPatternUI::parse_ui()
 	pattern->setWrite(ui->PB_readWrite->isChecked());
 	QStringList strList = ui->LE_toSend->text().split(' ',QString::SkipEmptyParts);
 	pattern->v.clear();
+	pattern->set_dirty(true);
 
 	bool fail = false;
 
@@ -1743,6 +2015,7 @@ bool SPIPattern::getMsbFirst() const
 
 void SPIPattern::setMsbFirst(bool value)
 {
+	set_dirty(true);
 	msbFirst = value;
 }
 
@@ -1784,6 +2057,7 @@ uint8_t SPIPattern::getWaitClocks() const
 
 void SPIPattern::setWaitClocks(const uint8_t& value)
 {
+	set_dirty(true);
 	waitClocks = value;
 }
 
@@ -1794,15 +2068,14 @@ uint8_t SPIPattern::getBytesPerFrame() const
 
 void SPIPattern::setBytesPerFrame(const uint8_t& value)
 {
+	set_dirty(true);
 	bytesPerFrame = value;
 }
 
 uint8_t SPIPattern::generate_pattern(uint32_t sample_rate,
                                      uint32_t number_of_samples, uint16_t number_of_channels)
 {
-	delete_buffer();
-
-	buffer = new short[number_of_samples]; // no need to recreate buffer
+	allocate_buffer(number_of_samples);
 	auto buffersize = (number_of_samples)*sizeof(short);
 
 	auto clkActiveBit = 0;
@@ -1877,6 +2150,7 @@ bool SPIPattern::getCPOL() const
 
 void SPIPattern::setCPOL(bool value)
 {
+	set_dirty(true);
 	CPOL = value;
 }
 
@@ -1887,6 +2161,7 @@ bool SPIPattern::getCPHA() const
 
 void SPIPattern::setCPHA(bool value)
 {
+	set_dirty(true);
 	CPHA = value;
 }
 
@@ -1897,6 +2172,7 @@ uint32_t SPIPattern::getClkFrequency() const
 
 void SPIPattern::setClkFrequency(const uint32_t& value)
 {
+	set_dirty(true);
 	clkFrequency = value;
 }
 
@@ -1907,6 +2183,7 @@ bool SPIPattern::getCSPol() const
 
 void SPIPattern::setCSPol(bool value)
 {
+	set_dirty(true);
 	CSPol = value;
 }
 
@@ -2013,6 +2290,7 @@ void SPIPatternUI::parse_ui()
 	pattern->setMsbFirst(ui->PB_MSB->isChecked());
 	QStringList strList = ui->LE_toSend->text().split(' ',QString::SkipEmptyParts);
 	pattern->v.clear();
+	pattern->set_dirty(true);
 	bool fail = false;
 
 	std::vector<uint8_t> b;
@@ -2064,6 +2342,8 @@ JSPattern::JSPattern(QJsonObject obj_) : obj(obj_)
 	set_name(obj["name"].toString().toStdString());
 	console = new JSConsole();
 	qEngine = nullptr;
+	native_buffer = false;
+	script_size = 0;
 }
 
 void JSPattern::init()
@@ -2075,6 +2355,7 @@ void JSPattern::init()
 	}
 
 	qEngine = new QJSEngine();
+	script_file.clear();
 }
 
 void JSPattern::deinit()
@@ -2084,6 +2365,8 @@ void JSPattern::deinit()
 		delete qEngine;
 		qEngine = nullptr;
 	}
+
+	script_file.clear();
 }
 
 uint32_t JSPattern::get_min_sampling_freq()
@@ -2137,9 +2420,16 @@ bool JSPattern::is_periodic()
 
 uint8_t JSPattern::pre_generate()
 {
-	bool ok;
 	QString fileName(obj["filepath"].toString() +
 	                 obj["generate_script"].toString());
+	QFileInfo info(fileName);
+
+	// The engine still holds the functions of the script
+	if (fileName == script_file && info.lastModified() == script_modified &&
+	    info.size() == script_size) {
+		return 0;
+	}
+
 	qDebug()<<fileName;
 	QFile scriptFile(fileName);
 	scriptFile.open(QIODevice::ReadOnly);
@@ -2153,10 +2443,15 @@ uint8_t JSPattern::pre_generate()
 	qEngine->evaluate("function generate(){ status_window.print(\"generate() not found\")}");
 
 	// if file does not exist, stream will be empty
-	handle_result(qEngine->evaluate(contents, fileName),"Eval generatescript");
-
+	if (handle_result(qEngine->evaluate(contents, fileName),"Eval generatescript")) {
+		script_file = fileName;
+		script_modified = info.lastModified();
+		script_size = info.size();
+	}
 
-	return 0;
+	// the pattern has to be generated again
+	set_dirty(true);
+	return 1;
 }
 
 bool JSPattern::handle_result(QJSValue result,QString str)
@@ -2166,11 +2461,12 @@ bool JSPattern::handle_result(QJSValue result,QString str)
 		                << "Uncaught exception at line"
 		                << result.property("lineNumber").toInt()
 		                << ":" << result.toString();
-		return -2;
+		return false;
 	} else {
 		qDebug()<<str<<" - Success";
 	}
 
+	return true;
 }
 
 uint8_t JSPattern::generate_pattern(uint32_t sample_rate,
@@ -2180,8 +2476,13 @@ uint8_t JSPattern::generate_pattern(uint32_t sample_rate,
 	this->sample_rate = sample_rate;
 	this->number_of_channels = number_of_channels;
 	this->number_of_samples = number_of_samples;
+	native_buffer = false;
 	handle_result(qEngine->evaluate("generate()"),"Eval generate");
-	commitBuffer(qEngine->evaluate("pg.buffer"),qEngine->evaluate("pg.buffersize"));
+
+	if (!native_buffer) {
+		commitBuffer(qEngine->evaluate("pg.buffer"),qEngine->evaluate("pg.buffersize"));
+	}
+
 	return 0;
 }
 
@@ -2205,28 +2506,130 @@ void JSPattern::JSErrorDialog(QString errorMessage)
 	qDebug()<<"JSErrorDialog: "<<errorMessage;
 }
 
-void JSPattern::commitBuffer(QJSValue jsBufferValue, QJSValue jsBufferSize)
+void JSPattern::useNativeBuffer()
 {
-	if (!jsBufferValue.isArray()) {
-		qDebug()<<"Not an array";
+	if (!native_buffer) {
+		allocate_buffer(number_of_samples);
+		memset(buffer, 0, number_of_samples * sizeof(short));
+		native_buffer = true;
+	}
+}
+
+void JSPattern::fill(quint32 start, quint32 length, int value)
+{
+	useNativeBuffer();
+
+	if (start >= number_of_samples) {
 		return;
 	}
 
+	length = std::min(length, number_of_samples - start);
+	std::fill_n(buffer + start, length, (short)value);
+}
+
+void JSPattern::repeat(quint32 start, quint32 length, quint32 count)
+{
+	useNativeBuffer();
+
+	quint64 end = (count) ? (quint64)start + (quint64)length * (count + 1) :
+	              number_of_samples;
+	repeatSamples(start, length, std::min<quint64>(end, number_of_samples));
+}
+
+void JSPattern::repeatSamples(quint32 start, quint32 length, quint64 end)
+{
+	if (length == 0 || start + (quint64)length >= end) {
+		return;
+	}
+
+	// Copy from the start of the pattern, doubling the copied block
+	// each time, so the period is preserved
+	quint64 filled = start + length;
+
+	while (filled < end) {
+		quint64 n = std::min(filled - start, end - filled);
+		memcpy(buffer + filled, buffer + start, n * sizeof(short));
+		filled += n;
+	}
+}
+
+bool JSPattern::copyArrayBuffer(QJSValue jsBufferValue, quint32 size)
+{
+	QJSValue arrayBuffer = jsBufferValue;
+	quint32 offset = 0;
+
+	// Typed arrays are views of an ArrayBuffer
+	if (jsBufferValue.hasProperty("BYTES_PER_ELEMENT")) {
+		if (jsBufferValue.property("BYTES_PER_ELEMENT").toInt() != sizeof(short)) {
+			return false;
+		}
+
+		offset = jsBufferValue.property("byteOffset").toUInt();
+		arrayBuffer = jsBufferValue.property("buffer");
+	}
+
+	QVariant data = arrayBuffer.toVariant();
+
+	if (data.type() != QVariant::ByteArray) {
+		return false;
+	}
+
+	QByteArray bytes = data.toByteArray();
+
+	if (offset > (quint32)bytes.size()) {
+		return false;
+	}
+
+	quint32 available = (bytes.size() - offset) / sizeof(short);
+	quint32 n = std::min(size, available);
+
+	memcpy(buffer, bytes.constData() + offset, n * sizeof(short));
+	memset(buffer + n, 0, (size - n) * sizeof(short));
+
+	return true;
+}
+
+void JSPattern::commitBuffer(QJSValue jsBufferValue, QJSValue jsBufferSize)
+{
 	if (!jsBufferSize.isNumber()) {
 		qDebug()<<"Not a valid size";
 		return;
 	}
 
-	delete_buffer();
-	buffer = new short[jsBufferSize.toInt()];
+	quint32 size = jsBufferSize.toUInt();
+	allocate_buffer(std::max(size, number_of_samples));
 
-	for (auto i=0; i<jsBufferSize.toInt(); i++) {
-		if (!jsBufferValue.property(i).isError()) {
-			auto val = jsBufferValue.property(i).toInt();
-			buffer[i] = val;
-		} else {
-			buffer[i] = 0;
+	if (copyArrayBuffer(jsBufferValue, size)) {
+		// ArrayBuffer or Int16Array, copied in one go
+	} else if (jsBufferValue.isArray()) {
+		QVariantList values = jsBufferValue.toVariant().toList();
+		quint32 n = std::min<quint32>(size, values.size());
+
+		for (quint32 i=0; i<n; i++) {
+			buffer[i] = values[i].toInt();
+		}
+
+		memset(buffer + n, 0, (size - n) * sizeof(short));
+	} else if (jsBufferValue.hasProperty("length")) {
+		// Other typed arrays
+		for (quint32 i=0; i<size; i++) {
+			if (!jsBufferValue.property(i).isError()) {
+				buffer[i] = jsBufferValue.property(i).toInt();
+			} else {
+				buffer[i] = 0;
+			}
 		}
+	} else {
+		qDebug()<<"Not an array";
+		delete_buffer();
+		return;
+	}
+
+	// Scripts may only describe a period of the pattern
+	if (size) {
+		repeatSamples(0, size, number_of_samples);
+	} else {
+		memset(buffer, 0, number_of_samples * sizeof(short));
 	}
 }
 
@@ -2368,6 +2771,8 @@ void JSPatternUI::post_load_ui()
 void JSPatternUI::parse_ui()
 {
 	handle_result(pattern->qEngine->evaluate("parse_ui_callback()"),"parse_ui");
+	// The script changes its parameters behind the pattern's setters
+	pattern->set_dirty(true);
 	Q_EMIT patternParamsChanged();
 }
 
@@ -2427,6 +2832,7 @@ uint32_t LFSRPattern::get_lfsr_poly() const
 
 void LFSRPattern::set_lfsr_poly(const uint32_t& value)
 {
+	set_dirty(true);
 	lfsr_poly = value;
 }
 
@@ -2437,6 +2843,7 @@ uint16_t LFSRPattern::get_start_state() const
 
 void LFSRPattern::set_start_state(const uint16_t& value)
 {
+	set_dirty(true);
 	start_state = value;
 }
 
@@ -2455,8 +2862,7 @@ uint8_t LFSRPattern::generate_pattern()
 	// https://en.wikipedia.org/wiki/Linear-feedback_shift_register
 	uint16_t lfsr = start_state;
 	int i=0;
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 
 	do {
 		unsigned lsb = lfsr & 1;   /* Get LSB (i.e., the output bit). */
@@ -2543,6 +2949,7 @@ bool ConstantPattern::get_constant() const
 
 void ConstantPattern::set_constant(bool value)
 {
+	set_dirty(true);
 	constant = value;
 }
 
@@ -2554,8 +2961,7 @@ ConstantPattern::ConstantPattern()
 }
 uint8_t ConstantPattern::generate_pattern()
 {
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 
 	for (auto i=0; i<number_of_samples; i++) {
 		if (constant) {
@@ -2609,16 +3015,13 @@ PulsePattern::PulsePattern()
 
 uint8_t PulsePattern::generate_pattern()
 {
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 
 	float period_number_of_samples = high_number_of_samples+low_number_of_samples;
 	qDebug()<<"period_number_of_samples - "<<period_number_of_samples;
 	float number_of_periods = number_of_samples / period_number_of_samples;
 	qDebug()<<"number_of_periods - " << number_of_periods;
 
-	delete_buffer();
-	buffer = new short[number_of_samples];
 	int i=0;
 
 	auto cnt = counter_init;
@@ -2684,26 +3087,32 @@ uint16_t PulsePattern::get_divider_init()
 
 void PulsePattern::set_start(bool val)
 {
+	set_dirty(true);
 	start=val;
 }
 void PulsePattern::set_low_number_of_samples(uint32_t val)
 {
+	set_dirty(true);
 	low_number_of_samples=val;
 }
 void PulsePattern::set_high_number_of_samples(uint32_t val)
 {
+	set_dirty(true);
 	high_number_of_samples=val;
 }
 void PulsePattern::set_counter_init(uint32_t val)
 {
+	set_dirty(true);
 	counter_init=val;
 }
 void PulsePattern::set_divider(uint16_t val)
 {
+	set_dirty(true);
 	divider=val;
 }
 void PulsePattern::set_divider_init(uint16_t val)
 {
+	set_dirty(true);
 	divider_init=val;
 }
 
@@ -2800,13 +3209,13 @@ uint32_t JohnsonCounterPattern::get_frequency() const
 
 void JohnsonCounterPattern::set_frequency(const uint32_t& value)
 {
+	set_dirty(true);
 	frequency = value;
 }
 
 uint8_t JohnsonCounterPattern::generate_pattern()
 {
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 	auto samples_per_count = ((float)sample_rate/(float)frequency);
 	auto i=0;
 	auto j=0;
@@ -2867,6 +3276,7 @@ uint32_t WalkingPattern::get_frequency() const
 
 void WalkingPattern::set_frequency(const uint32_t& value)
 {
+	set_dirty(true);
 	frequency = value;
 }
 
@@ -2877,6 +3287,7 @@ uint16_t WalkingPattern::get_length() const
 
 void WalkingPattern::set_length(const uint16_t& value)
 {
+	set_dirty(true);
 	length = value;
 }
 
@@ -2887,6 +3298,7 @@ bool WalkingPattern::get_right() const
 
 void WalkingPattern::set_right(bool value)
 {
+	set_dirty(true);
 	right = value;
 }
 
@@ -2897,6 +3309,7 @@ bool WalkingPattern::get_level() const
 
 void WalkingPattern::set_level(bool value)
 {
+	set_dirty(true);
 	level = value;
 }
 
@@ -2920,8 +3333,7 @@ uint32_t WalkingPattern::get_required_nr_of_samples()
 
 uint8_t WalkingPattern::generate_pattern()
 {
-	delete_buffer();
-	buffer = new short[number_of_samples];
+	allocate_buffer(number_of_samples);
 	auto samples_per_count = ((float)sample_rate/(float)frequency);
 	uint16_t i;
 	i = (1<<length) - 1;
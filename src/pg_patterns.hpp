@@ -25,6 +25,7 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QIntValidator>
+#include <QDateTime>
 #include <QtQml/QJSEngine>
 #include <QtUiTools/QUiLoader>
 #include <vector>
@@ -114,14 +115,30 @@ public:
 	Q_INVOKABLE void log(QString msg);
 };
 
+/*
+ * A run of identical samples. Patterns describing their output as runs
+ * never materialize their samples; the runs are repeated from the start
+ * when they cover less than the number of samples requested, so a
+ * periodic pattern only has to describe a single period.
+ */
+struct PatternRun {
+	uint32_t length;
+	uint16_t value;
+};
+
 class Pattern
 {
 private:
 	std::string name;
 	std::string description;
 	bool periodic;
+	uint32_t buffer_capacity;
+	bool dirty;
 protected: // temp
 	short *buffer;
+	std::vector<PatternRun> runs;
+	short *allocate_buffer(uint32_t number_of_samples);
+	void append_run(uint16_t value, uint32_t length);
 public:
 
 	Pattern(/*string name_, string description_*/);
@@ -135,12 +152,20 @@ public:
 	void delete_buffer();
 	virtual void init();
 	virtual uint8_t pre_generate();
+	// Set by the setters, until the output is generated again
+	bool is_dirty();
+	void set_dirty(bool dirty_);
 	virtual bool is_periodic();
 	virtual uint32_t get_min_sampling_freq();
 	virtual uint32_t get_required_nr_of_samples(uint32_t sample_rate,
 	                uint32_t number_of_channels);
 	virtual uint8_t generate_pattern(uint32_t sample_rate,
 	                                 uint32_t number_of_samples, uint16_t number_of_channels) = 0;
+	// Returns false if the pattern can only be generated sample by sample
+	virtual bool generate_runs(uint32_t sample_rate,
+	                           uint32_t number_of_samples, uint16_t number_of_channels);
+	const std::vector<PatternRun>& get_runs();
+	void delete_runs();
 	virtual void deinit();
 
 	virtual std::string toString();
@@ -194,6 +219,8 @@ public:
 	virtual ~ClockPattern();
 	uint8_t generate_pattern(uint32_t sample_rate, uint32_t number_of_samples,
 	                         uint16_t number_of_channels);
+	bool generate_runs(uint32_t sample_rate, uint32_t number_of_samples,
+	                   uint16_t number_of_channels);
 	float get_frequency() const;
 	void set_frequency(float value);
 	float get_duty_cycle() const;
@@ -272,11 +299,15 @@ protected:
 	uint16_t end_value;
 	uint16_t increment;
 	uint16_t init_value;
+	void generate_counter_runs(uint32_t sample_rate,
+	                           uint32_t number_of_samples, uint16_t number_of_channels, bool gray);
 public:
 	BinaryCounterPattern();
 	virtual ~BinaryCounterPattern();
 	virtual uint8_t generate_pattern(uint32_t sample_rate,
 	                                 uint32_t number_of_samples, uint16_t number_of_channels);
+	virtual bool generate_runs(uint32_t sample_rate,
+	                           uint32_t number_of_samples, uint16_t number_of_channels);
 	uint32_t get_min_sampling_freq();
 	uint32_t get_required_nr_of_samples(uint32_t sample_rate,
 	                                    uint32_t number_of_channels);
@@ -319,6 +350,8 @@ public:
 	virtual ~GrayCounterPattern() {}
 	uint8_t generate_pattern(uint32_t sample_rate,
 	                         uint32_t number_of_samples, uint16_t number_of_channels);
+	bool generate_runs(uint32_t sample_rate,
+	                   uint32_t number_of_samples, uint16_t number_of_channels);
 };
 
 class GrayCounterPatternUI : public PatternUI
@@ -364,6 +397,8 @@ public:
 
 	virtual uint8_t generate_pattern(uint32_t sample_rate,
 	                                 uint32_t number_of_samples, uint16_t number_of_channels);
+	virtual bool generate_runs(uint32_t sample_rate,
+	                           uint32_t number_of_samples, uint16_t number_of_channels);
 	uint32_t get_min_sampling_freq();
 	uint32_t get_required_nr_of_samples(uint32_t sample_rate,
 	                                    uint32_t number_of_channels);
@@ -538,6 +573,8 @@ public:
 	virtual ~NumberPattern() {}
 	virtual uint8_t generate_pattern(uint32_t sample_rate,
 	                                 uint32_t number_of_samples, uint16_t number_of_channels);
+	virtual bool generate_runs(uint32_t sample_rate,
+	                           uint32_t number_of_samples, uint16_t number_of_channels);
 	uint16_t get_nr() const;
 	void set_nr(const uint16_t& value);
 };
@@ -582,6 +619,14 @@ public:
 	Q_INVOKABLE quint32 get_nr_of_samples();
 	Q_INVOKABLE quint32 get_nr_of_channels();
 	Q_INVOKABLE quint32 get_sample_rate();
+
+	// Native helpers writing straight into the pattern buffer. Once a
+	// script uses them, pg.buffer is ignored. repeat() copies the
+	// samples [start, start + length) count times after themselves, or
+	// up to the end of the buffer when count is 0.
+	Q_INVOKABLE void fill(quint32 start, quint32 length, int value);
+	Q_INVOKABLE void repeat(quint32 start, quint32 length, quint32 count = 0);
+
 	/*Q_INVOKABLE*/ void JSErrorDialog(QString errorMessage);
 	/*Q_INVOKABLE*/ void commitBuffer(QJSValue jsBufferValue,
 	                                  QJSValue jsBufferSize);
@@ -594,6 +639,18 @@ public:
 	                         uint32_t number_of_samples, uint16_t number_of_channels);
 	void deinit();
 	virtual bool handle_result(QJSValue result,QString str = "");
+
+private:
+	bool native_buffer;
+
+	// The generate script is only evaluated again when the file changes
+	QString script_file;
+	QDateTime script_modified;
+	qint64 script_size;
+
+	void useNativeBuffer();
+	void repeatSamples(quint32 start, quint32 length, quint64 end);
+	bool copyArrayBuffer(QJSValue jsBufferValue, quint32 size);
 };
 
 class JSPatternUIStatusWindow : public QObject
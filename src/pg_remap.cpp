@@ -0,0 +1,59 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "pg_remap.hpp"
+
+using namespace adiscope;
+
+PatternRemap::PatternRemap(const uint8_t *mapping, int channel_count,
+                           uint16_t mask) :
+	keep_mask(~mask)
+{
+	const uint32_t channel_mask = (1 << channel_count) - 1;
+
+	for (uint32_t i = 0; i < 256; i++) {
+		low[i] = remap(mapping, i & channel_mask);
+		high[i] = remap(mapping, (i << 8) & channel_mask);
+	}
+}
+
+void PatternRemap::merge(short *dst, const short *src, uint32_t size) const
+{
+	for (uint32_t i = 0; i < size; i++) {
+		const uint16_t val = src[i];
+		dst[i] = (dst[i] & keep_mask) | low[val & 0xff] | high[val >> 8];
+	}
+}
+
+short PatternRemap::remap(const uint8_t *mapping, uint32_t val)
+{
+	short ret = 0;
+	int i = 0;
+
+	while (val) {
+		if (val & 0x01) {
+			ret = ret | (1 << mapping[i]);
+		}
+
+		i++;
+		val >>= 1;
+	}
+
+	return ret;
+}
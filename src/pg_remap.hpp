@@ -0,0 +1,51 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PG_REMAP_HPP
+#define PG_REMAP_HPP
+
+#include <cstdint>
+
+namespace adiscope {
+
+/*
+ * Scatters the samples of a channel group onto the pins of its channels.
+ *
+ * Bit i of a group sample drives the pin mapping[i]. The mapping is compiled
+ * into two 256-entry tables translating the low and the high byte of a
+ * sample, so merging a sample into the main buffer costs two table loads
+ * and a masked merge, whatever the number of channels.
+ */
+class PatternRemap
+{
+public:
+	PatternRemap(const uint8_t *mapping, int channel_count, uint16_t mask);
+
+	void merge(short *dst, const short *src, uint32_t size) const;
+
+	static short remap(const uint8_t *mapping, uint32_t val);
+
+private:
+	uint16_t low[256];
+	uint16_t high[256];
+	uint16_t keep_mask;
+};
+}
+
+#endif /* PG_REMAP_HPP */
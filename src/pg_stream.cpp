@@ -0,0 +1,263 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDebug>
+
+#include "pg_stream.hpp"
+#include "pg_channel_manager.hpp"
+
+using namespace adiscope;
+
+/* The HDL wants buffers which are a multiple of 4 samples */
+const uint32_t PatternGeneratorStream::chunkSize = 256 * 1024;
+const uint32_t PatternGeneratorStream::maxGeneratedSamples = 64 * 1024 * 1024;
+
+PatternGeneratorStream::PatternGeneratorStream() :
+	sampleRate(0),
+	totalSamples(0),
+	position(0),
+	loop(false)
+{
+}
+
+PatternGeneratorStream::~PatternGeneratorStream()
+{
+	stop();
+}
+
+bool PatternGeneratorStream::prepare(PatternGeneratorChannelManager *chm,
+                                     const short *buffer, uint32_t bufferSize,
+                                     uint32_t sampleRate, uint32_t totalSamples)
+{
+	uint16_t baseMask = 0;
+
+	this->sampleRate = sampleRate;
+	this->totalSamples = totalSamples;
+	groups.clear();
+	error.clear();
+
+	for (size_t i = 0; i < chm->get_channel_group_count(); i++) {
+		auto chg = static_cast<PatternGeneratorChannelGroup *>
+		           (chm->get_channel_group(i));
+
+		if (!chg->is_enabled()) {
+			continue;
+		}
+
+		uint8_t mapping[16];
+		uint32_t channelMask = (1 << chg->get_channel_count()) - 1;
+		memset(mapping, 0, sizeof(mapping));
+
+		for (int j = 0; j < chg->get_channel_count(); j++) {
+			mapping[j] = chg->get_channel(j)->get_id();
+		}
+
+		Group group;
+		group.mask = chg->get_mask();
+		group.run = 0;
+		group.offset = 0;
+
+		if (chg->pattern->generate_runs(sampleRate, totalSamples,
+		                                chg->get_channel_count())) {
+			for (const PatternRun& run : chg->pattern->get_runs()) {
+				group.runs.push_back({run.length,
+					(uint16_t)chm->remap_buffer(mapping,
+						run.value & channelMask)});
+			}
+
+			chg->pattern->delete_runs();
+			groups.push_back(group);
+			continue;
+		}
+
+		// The preview buffer already holds the whole sequence
+		if (totalSamples <= bufferSize) {
+			baseMask |= chg->get_mask();
+			continue;
+		}
+
+		if (totalSamples > maxGeneratedSamples) {
+			error = "The pattern of group " + chg->get_label() +
+			        " is too long to be streamed";
+			groups.clear();
+			return false;
+		}
+
+		chg->pattern->generate_pattern(sampleRate, totalSamples,
+		                               chg->get_channel_count());
+		const short *samples = chg->pattern->get_buffer();
+
+		if (!samples) {
+			error = "Could not generate the pattern of group " +
+			        chg->get_label();
+			groups.clear();
+			return false;
+		}
+
+		group.samples.resize(totalSamples);
+
+		for (uint32_t j = 0; j < totalSamples; j++) {
+			group.samples[j] = chm->remap_buffer(mapping,
+			                                     samples[j] & channelMask);
+		}
+
+		chg->pattern->delete_buffer();
+		groups.push_back(std::move(group));
+	}
+
+	base.clear();
+
+	if (baseMask) {
+		base.assign(buffer, buffer + bufferSize);
+
+		for (auto& sample : base) {
+			sample &= baseMask;
+		}
+	}
+
+	return true;
+}
+
+bool PatternGeneratorStream::start(struct iio_device *dev, bool loop)
+{
+	if (totalSamples == 0 || !open(dev, chunkSize, sampleRate)) {
+		return false;
+	}
+
+	if (iio_buffer_step(txbuf) != sizeof(short)) {
+		qDebug("Unexpected stream buffer layout");
+		stop();
+		return false;
+	}
+
+	this->loop = loop;
+	rewind();
+	launch();
+
+	return true;
+}
+
+uint32_t PatternGeneratorStream::getTotalSamples() const
+{
+	return totalSamples;
+}
+
+const std::string& PatternGeneratorStream::getError() const
+{
+	return error;
+}
+
+void PatternGeneratorStream::rewind()
+{
+	position = 0;
+
+	for (Group& group : groups) {
+		group.run = 0;
+		group.offset = 0;
+	}
+}
+
+void PatternGeneratorStream::fill(short *dst, uint32_t samples)
+{
+	if (base.empty()) {
+		memset(dst, 0, samples * sizeof(short));
+	} else {
+		for (uint32_t j = 0; j < samples;) {
+			uint32_t index = (position + j) % base.size();
+			uint32_t n = std::min<uint32_t>(samples - j,
+			                                 base.size() - index);
+
+			memcpy(dst + j, base.data() + index, n * sizeof(short));
+			j += n;
+		}
+	}
+
+	for (Group& group : groups) {
+		const uint16_t keep = ~group.mask;
+
+		if (!group.samples.empty()) {
+			const uint16_t *src = group.samples.data() + position;
+
+			for (uint32_t k = 0; k < samples; k++) {
+				dst[k] = (dst[k] & keep) | src[k];
+			}
+
+			continue;
+		}
+
+		if (group.runs.empty()) {
+			continue;
+		}
+
+		for (uint32_t j = 0; j < samples;) {
+			const PatternRun& run = group.runs[group.run];
+			uint32_t n = std::min(run.length - group.offset, samples - j);
+
+			for (uint32_t k = j; k < j + n; k++) {
+				dst[k] = (dst[k] & keep) | run.value;
+			}
+
+			j += n;
+			group.offset += n;
+
+			if (group.offset == run.length) {
+				group.offset = 0;
+				group.run = (group.run + 1) % group.runs.size();
+			}
+		}
+	}
+
+	position += samples;
+}
+
+size_t PatternGeneratorStream::produce(struct iio_buffer *buf)
+{
+	short *dst = (short *)iio_buffer_start(buf);
+	uint32_t filled = 0;
+
+	while (filled < chunkSize) {
+		if (position == totalSamples) {
+			if (!loop) {
+				break;
+			}
+
+			rewind();
+		}
+
+		uint32_t n = std::min(chunkSize - filled, totalSamples - position);
+		fill(dst + filled, n);
+		filled += n;
+	}
+
+	if (filled == 0) {
+		return 0;
+	}
+
+	// Hold the last sample up to a multiple of 4 samples
+	uint32_t count = std::min((filled + 3) / 4 * 4, chunkSize);
+
+	for (uint32_t j = filled; j < count; j++) {
+		dst[j] = dst[filled - 1];
+	}
+
+	return count;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PG_STREAM_HPP
+#define PG_STREAM_HPP
+
+#include <string>
+#include <vector>
+
+#include "iio_tx_stream.hpp"
+#include "pg_patterns.hpp"
+
+namespace adiscope {
+
+class PatternGeneratorChannelManager;
+
+/*
+ * Plays pattern sequences longer than the memory of the device.
+ *
+ * Groups whose pattern can be described as runs are expanded chunk by
+ * chunk over the whole sequence, so their length is only limited by the
+ * number of transitions. The other groups (SPI, I2C, JS, random...) are
+ * generated over the whole sequence up front, unless the sequence fits in
+ * the preview buffer, which then holds them already.
+ */
+class PatternGeneratorStream : public IioTxStream
+{
+public:
+	PatternGeneratorStream();
+	~PatternGeneratorStream();
+
+	/*
+	 * Takes a snapshot of the enabled groups. Must be called from the
+	 * GUI thread, before start(). Fails when a group can't be generated
+	 * over the whole sequence, see getError().
+	 */
+	bool prepare(PatternGeneratorChannelManager *chm, const short *buffer,
+	             uint32_t bufferSize, uint32_t sampleRate,
+	             uint32_t totalSamples);
+
+	/*
+	 * Starts pushing the sequence to the device, once or over and
+	 * over again when @loop is set.
+	 */
+	bool start(struct iio_device *dev, bool loop);
+
+	uint32_t getTotalSamples() const;
+	const std::string& getError() const;
+
+	static const uint32_t chunkSize;
+
+	// Longest sequence a group which isn't made of runs is generated for
+	static const uint32_t maxGeneratedSamples;
+
+private:
+	struct Group {
+		uint16_t mask;
+		std::vector<PatternRun> runs; // values already remapped
+		size_t run;
+		uint32_t offset;
+		std::vector<uint16_t> samples; // whole sequence, remapped
+	};
+
+	size_t produce(struct iio_buffer *buf);
+	void rewind();
+	void fill(short *dst, uint32_t samples);
+
+	std::vector<Group> groups;
+	std::vector<short> base;
+	uint32_t sampleRate;
+	uint32_t totalSamples;
+	uint32_t position;
+	std::string error;
+	bool loop;
+};
+}
+
+#endif // PG_STREAM_HPP
@@ -20,6 +20,7 @@
 #include "dynamicWidget.hpp"
 #include "power_controller.hpp"
 #include "filter.hpp"
+#include "iio_attr_cache.hpp"
 
 #include "ui_powercontrol.h"
 
@@ -60,26 +61,28 @@ PowerController::PowerController(struct iio_context *ctx,
 		/* These are the two ADC amplifiers */
 		chan = iio_device_find_channel(dev3, "voltage0", false);
 		if (chan)
-			iio_channel_attr_write_bool(chan, "powerdown", false);
+			IioAttrCache::write(chan, "powerdown", false);
 
 		chan = iio_device_find_channel(dev3, "voltage1", false);
 		if (chan)
-			iio_channel_attr_write_bool(chan, "powerdown", false);
+			IioAttrCache::write(chan, "powerdown", false);
 
 		/* ADF4360 globaal clock power down */
-		iio_device_attr_write(dev3, "clk_powerdown", "0");
+		IioAttrCache::write(dev3, "clk_powerdown", "0");
 	}
 
 	/* Power down DACs by default */
-	iio_channel_attr_write_bool(pd_pos, "user_supply_powerdown", true);
+	IioAttrCache::beginBatch();
+	IioAttrCache::write(pd_pos, "user_supply_powerdown", true);
 	if (pd_neg)
-		iio_channel_attr_write_bool(pd_neg, "user_supply_powerdown", true);
-	iio_channel_attr_write_bool(ch1w, "powerdown", true);
-	iio_channel_attr_write_bool(ch2w, "powerdown", true);
+		IioAttrCache::write(pd_neg, "user_supply_powerdown", true);
+	IioAttrCache::write(ch1w, "powerdown", true);
+	IioAttrCache::write(ch2w, "powerdown", true);
 
 	/* Set the default values */
-	iio_channel_attr_write_longlong(ch1w, "raw", 0LL);
-	iio_channel_attr_write_longlong(ch2w, "raw", 0LL);
+	IioAttrCache::write(ch1w, "raw", 0LL);
+	IioAttrCache::write(ch2w, "raw", 0LL);
+	IioAttrCache::endBatch();
 
 	connect(&this->timer, SIGNAL(timeout()), this, SLOT(update_lcd()));
 
@@ -107,11 +110,11 @@ PowerController::PowerController(struct iio_context *ctx,
 PowerController::~PowerController()
 {
 	/* Power down DACs */
-	iio_channel_attr_write_bool(ch1w, "powerdown", true);
-	iio_channel_attr_write_bool(ch2w, "powerdown", true);
-	iio_channel_attr_write_bool(pd_pos, "user_supply_powerdown", true);
+	IioAttrCache::write(ch1w, "powerdown", true);
+	IioAttrCache::write(ch2w, "powerdown", true);
+	IioAttrCache::write(pd_pos, "user_supply_powerdown", true);
 	if (pd_neg)
-		iio_channel_attr_write_bool(pd_neg, "user_supply_powerdown", true);
+		IioAttrCache::write(pd_neg, "user_supply_powerdown", true);
 
 	/* FIXME: TODO: Move this into a HW class / lib M2k */
 	struct iio_device *dev3 = iio_context_find_device(ctx, "m2k-fabric");
@@ -120,14 +123,14 @@ PowerController::~PowerController()
 		/* These are the two ADC amplifiers */
 		chan = iio_device_find_channel(dev3, "voltage0", false);
 		if (chan)
-			iio_channel_attr_write_bool(chan, "powerdown", true);
+			IioAttrCache::write(chan, "powerdown", true);
 
 		chan = iio_device_find_channel(dev3, "voltage1", false);
 		if (chan)
-			iio_channel_attr_write_bool(chan, "powerdown", true);
+			IioAttrCache::write(chan, "powerdown", true);
 
 		/* ADF4360 globaal clock power down */
-		iio_device_attr_write(dev3, "clk_powerdown", "1");
+		IioAttrCache::write(dev3, "clk_powerdown", "1");
 	}
 
 	api->save(*settings);
@@ -150,7 +153,7 @@ void PowerController::dac1_set_value(double value)
 {
 	long long val = value * 4095.0 / (5.02 * 1.2);
 
-	iio_channel_attr_write_longlong(ch1w, "raw", val);
+	IioAttrCache::write(ch1w, "raw", val);
 
 	if (in_sync) {
 		value = -value * ui->trackingRatio->value() / 100.0;
@@ -163,26 +166,26 @@ void PowerController::dac2_set_value(double value)
 {
 	long long val = value * 4095.0 / (-5.1 * 1.2);
 
-	iio_channel_attr_write_longlong(ch2w, "raw", val);
+	IioAttrCache::write(ch2w, "raw", val);
 }
 
 void PowerController::dac1_set_enabled(bool enabled)
 {
-	iio_channel_attr_write_bool(ch1w, "powerdown", !enabled);
+	IioAttrCache::write(ch1w, "powerdown", !enabled);
 
 	if (in_sync)
 		dac2_set_enabled(enabled);
 
 	if (pd_neg) { /* For HW Rev. >= C */
 		run_button->setChecked(enabled);
-		iio_channel_attr_write_bool(pd_pos, "user_supply_powerdown", !enabled);
+		IioAttrCache::write(pd_pos, "user_supply_powerdown", !enabled);
 	} else {
 		if (enabled) {
 			run_button->setChecked(true);
-			iio_channel_attr_write_bool(pd_pos, "user_supply_powerdown", false);
+			IioAttrCache::write(pd_pos, "user_supply_powerdown", false);
 		} else if (!ui->dac2->isChecked()) {
 			run_button->setChecked(false);
-			iio_channel_attr_write_bool(pd_pos, "user_supply_powerdown", true);
+			IioAttrCache::write(pd_pos, "user_supply_powerdown", true);
 		}
 	}
 
@@ -191,18 +194,18 @@ void PowerController::dac1_set_enabled(bool enabled)
 
 void PowerController::dac2_set_enabled(bool enabled)
 {
-	iio_channel_attr_write_bool(ch2w, "powerdown", !enabled);
+	IioAttrCache::write(ch2w, "powerdown", !enabled);
 
 	if (pd_neg) { /* For HW Rev. >= C */
 		run_button->setChecked(enabled);
-		iio_channel_attr_write_bool(pd_neg, "user_supply_powerdown", !enabled);
+		IioAttrCache::write(pd_neg, "user_supply_powerdown", !enabled);
 	} else {
 		if (enabled) {
 			run_button->setChecked(true);
-			iio_channel_attr_write_bool(pd_pos, "user_supply_powerdown", false);
+			IioAttrCache::write(pd_pos, "user_supply_powerdown", false);
 		} else if (!ui->dac1->isChecked()) {
 			run_button->setChecked(false);
-			iio_channel_attr_write_bool(pd_pos, "user_supply_powerdown", true);
+			IioAttrCache::write(pd_pos, "user_supply_powerdown", true);
 		}
 	}
 
@@ -232,6 +235,8 @@ void PowerController::update_lcd()
 {
 	long long val1 = 0, val2 = 0;
 
+	/* Live readings, they can't go through the IioAttrCache */
+
 	iio_channel_attr_read_longlong(ch1r, "raw", &val1);
 	iio_channel_attr_read_longlong(ch2r, "raw", &val2);
 
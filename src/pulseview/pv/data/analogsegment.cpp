@@ -70,9 +70,9 @@ void AnalogSegment::append_interleaved_samples(const float *data,
 	lock_guard<recursive_mutex> lock(mutex_);
 
 	// If we're out of memory, this will throw std::bad_alloc
-	data_.resize((sample_count_ + sample_count) * sizeof(float));
+	resize_data((sample_count_ + sample_count) * sizeof(float));
 
-	float *dst = (float*)data_.data() + sample_count_;
+	float *dst = (float*)data_->data() + sample_count_;
 	const float *dst_end = dst + sample_count;
 	while (dst != dst_end) {
 		*dst++ = *data;
@@ -97,7 +97,7 @@ const float* AnalogSegment::get_samples(
 	lock_guard<recursive_mutex> lock(mutex_);
 
 	float *const data = new float[end_sample - start_sample];
-	memcpy(data, (float*)data_.data() + start_sample, sizeof(float) *
+	memcpy(data, (const float*)sample_data() + start_sample, sizeof(float) *
 		(end_sample - start_sample));
 	return data;
 }
@@ -156,9 +156,9 @@ void AnalogSegment::append_payload_to_envelope_levels()
 	dest_ptr = e0.samples + prev_length;
 
 	// Iterate through the samples to populate the first level mipmap
-	const float *const end_src_ptr = (float*)data_.data() +
+	const float *const end_src_ptr = (const float*)sample_data() +
 		e0.length * EnvelopeScaleFactor;
-	for (const float *src_ptr = (float*)data_.data() +
+	for (const float *src_ptr = (const float*)sample_data() +
 			prev_length * EnvelopeScaleFactor;
 			src_ptr < end_src_ptr; src_ptr += EnvelopeScaleFactor) {
 		const EnvelopeSample sub_sample = {
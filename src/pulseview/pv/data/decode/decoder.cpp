@@ -99,6 +99,26 @@ bool Decoder::have_required_channels() const
 	return true;
 }
 
+string Decoder::key() const
+{
+	string key(decoder_->id);
+
+	for (const auto& option : options_) {
+		gchar *const value = g_variant_print(option.second, FALSE);
+		key += ";" + option.first + "=" + value;
+		g_free(value);
+	}
+
+	for (const auto& channel : channels_) {
+		shared_ptr<view::LogicSignal> signal(channel.second);
+		assert(signal);
+		key += string(";") + channel.first->id + ":" +
+			std::to_string(signal->channel()->index());
+	}
+
+	return key;
+}
+
 set< shared_ptr<pv::data::Logic> > Decoder::get_data()
 {
 	set< shared_ptr<pv::data::Logic> > data;
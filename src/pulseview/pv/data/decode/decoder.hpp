@@ -24,6 +24,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
 
 #include <glib.h>
 
@@ -67,6 +68,13 @@ public:
 
 	bool have_required_channels() const;
 
+	/**
+	 * Returns a string identifying the decoder together with its options
+	 * and channel assignments. Two decoders with the same key produce the
+	 * same output from the same data.
+	 */
+	std::string key() const;
+
 	srd_decoder_inst* create_decoder_inst(
 		srd_session *session) const;
 
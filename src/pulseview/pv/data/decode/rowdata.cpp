@@ -18,38 +18,256 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include <algorithm>
+#include <cassert>
+
 #include "rowdata.hpp"
 
+using std::max;
 using std::vector;
 
 namespace pv {
 namespace data {
 namespace decode {
 
-RowData::RowData()
+const size_t RowData::ChunkSize = 4096;
+
+namespace {
+
+/**
+ * Collects every visited annotation.
+ */
+class SubsetCollector
+{
+public:
+	SubsetCollector(vector<Annotation> &dest) :
+		dest_(dest)
+	{
+	}
+
+	void operator()(const Annotation &a)
+	{
+		dest_.push_back(a);
+	}
+
+private:
+	vector<Annotation> &dest_;
+};
+
+/**
+ * Collects the visited annotations, keeping only a few representatives
+ * of the annotations that are shorter than the given length: the first
+ * one of each bucket, the one ending last, and one of another format.
+ * Drawn as a block, they span exactly what the whole run spans.
+ */
+class LevelOfDetailCollector
+{
+public:
+	LevelOfDetailCollector(vector<Annotation> &dest, uint64_t min_length) :
+		dest_(dest),
+		min_length_(max<uint64_t>(min_length, 1)),
+		bucket_(0),
+		first_(nullptr),
+		last_end_(nullptr),
+		other_format_(nullptr)
+	{
+	}
+
+	~LevelOfDetailCollector()
+	{
+		flush();
+	}
+
+	void operator()(const Annotation &a)
+	{
+		if (a.end_sample() - a.start_sample() >= min_length_) {
+			flush();
+			dest_.push_back(a);
+			return;
+		}
+
+		const uint64_t bucket = a.start_sample() / min_length_;
+
+		if (!first_ || bucket != bucket_) {
+			flush();
+			bucket_ = bucket;
+			first_ = last_end_ = &a;
+			return;
+		}
+
+		if (!other_format_ && a.format() != first_->format())
+			other_format_ = &a;
+		if (a.end_sample() >= last_end_->end_sample())
+			last_end_ = &a;
+	}
+
+private:
+	void flush()
+	{
+		if (!first_)
+			return;
+
+		// The annotations are visited by start sample, keep them so
+		const Annotation *rest[2] = { other_format_, last_end_ };
+		if (rest[0] && rest[0]->start_sample() > rest[1]->start_sample())
+			std::swap(rest[0], rest[1]);
+
+		dest_.push_back(*first_);
+		if (rest[0] && rest[0] != first_)
+			dest_.push_back(*rest[0]);
+		if (rest[1] != first_ && rest[1] != rest[0])
+			dest_.push_back(*rest[1]);
+
+		first_ = last_end_ = other_format_ = nullptr;
+	}
+
+private:
+	vector<Annotation> &dest_;
+	const uint64_t min_length_;
+	uint64_t bucket_;
+	const Annotation *first_;
+	const Annotation *last_end_;
+	const Annotation *other_format_;
+};
+
+bool annotation_starts_before(const Annotation &a, const Annotation &b)
+{
+	return a.start_sample() < b.start_sample();
+}
+
+}
+
+RowData::RowData() :
+	max_end_sample_(0)
 {
 }
 
 uint64_t RowData::get_max_sample() const
 {
-	if (annotations_.empty())
-		return 0;
-	return annotations_.back().end_sample();
+	return max_end_sample_;
+}
+
+template<typename Visitor>
+void RowData::visit_annotations(uint64_t start_sample, uint64_t end_sample,
+	Visitor &visitor) const
+{
+	// The first chunk which can hold an annotation ending after
+	// start_sample. The running maximum is monotonic, so bisect it.
+	const auto first = std::partition_point(chunks_.begin(), chunks_.end(),
+		[&](const Chunk &c) {
+			return c.prefix_max_end_sample <= start_sample; });
+
+	// The first chunk which starts entirely after end_sample
+	const auto last = std::partition_point(first, chunks_.end(),
+		[&](const Chunk &c) {
+			return c.annotations.front().start_sample() <= end_sample; });
+
+	for (auto c = first; c != last; c++) {
+		if ((*c).max_end_sample <= start_sample)
+			continue;
+
+		for (const Annotation &a : (*c).annotations) {
+			if (a.start_sample() > end_sample)
+				break;
+			if (a.end_sample() > start_sample)
+				visitor(a);
+		}
+	}
 }
 
 void RowData::get_annotation_subset(
 	vector<pv::data::decode::Annotation> &dest,
 	uint64_t start_sample, uint64_t end_sample) const
 {
-	for (const auto& annotation : annotations_)
-		if (annotation.end_sample() > start_sample &&
-			annotation.start_sample() <= end_sample)
-			dest.push_back(annotation);
+	SubsetCollector collector(dest);
+	visit_annotations(start_sample, end_sample, collector);
+}
+
+void RowData::get_annotation_subset(
+	vector<pv::data::decode::Annotation> &dest,
+	uint64_t start_sample, uint64_t end_sample,
+	uint64_t min_length) const
+{
+	LevelOfDetailCollector collector(dest, min_length);
+	visit_annotations(start_sample, end_sample, collector);
 }
 
 void RowData::push_annotation(const Annotation &a)
 {
-	annotations_.push_back(a);
+	max_end_sample_ = max(max_end_sample_, a.end_sample());
+
+	// Decoders almost always emit annotations in order, so the common
+	// case is appending to the last chunk
+	if (chunks_.empty() || a.start_sample() >=
+		chunks_.back().annotations.back().start_sample()) {
+		if (chunks_.empty() ||
+			chunks_.back().annotations.size() >= ChunkSize) {
+			Chunk c;
+			c.annotations.reserve(ChunkSize);
+			c.max_end_sample = 0;
+			c.prefix_max_end_sample = chunks_.empty() ?
+				0 : chunks_.back().prefix_max_end_sample;
+			chunks_.push_back(std::move(c));
+		}
+
+		Chunk &c = chunks_.back();
+		c.annotations.push_back(a);
+		c.max_end_sample = max(c.max_end_sample, a.end_sample());
+		c.prefix_max_end_sample = max(c.prefix_max_end_sample,
+			a.end_sample());
+		return;
+	}
+
+	// Out of order annotation: insert it into the chunk it belongs to
+	auto c = std::partition_point(chunks_.begin(), chunks_.end(),
+		[&](const Chunk &chunk) {
+			return chunk.annotations.front().start_sample() <=
+				a.start_sample(); });
+	if (c != chunks_.begin())
+		c--;
+
+	vector<Annotation> &annotations = (*c).annotations;
+	annotations.insert(std::upper_bound(annotations.begin(),
+		annotations.end(), a, annotation_starts_before), a);
+	(*c).max_end_sample = max((*c).max_end_sample, a.end_sample());
+
+	size_t index = c - chunks_.begin();
+
+	// Keep the chunks bounded so that inserting stays cheap
+	if (annotations.size() >= 2 * ChunkSize) {
+		Chunk tail;
+		tail.annotations.assign(annotations.begin() + ChunkSize,
+			annotations.end());
+		annotations.erase(annotations.begin() + ChunkSize,
+			annotations.end());
+
+		(*c).max_end_sample = 0;
+		for (const Annotation &ann : annotations)
+			(*c).max_end_sample = max((*c).max_end_sample,
+				ann.end_sample());
+
+		tail.max_end_sample = 0;
+		for (const Annotation &ann : tail.annotations)
+			tail.max_end_sample = max(tail.max_end_sample,
+				ann.end_sample());
+
+		chunks_.insert(chunks_.begin() + index + 1, std::move(tail));
+	}
+
+	update_prefix_max(index);
+}
+
+void RowData::update_prefix_max(size_t from)
+{
+	assert(from < chunks_.size());
+
+	uint64_t prefix_max = (from == 0) ?
+		0 : chunks_[from - 1].prefix_max_end_sample;
+
+	for (size_t i = from; i < chunks_.size(); i++) {
+		prefix_max = max(prefix_max, chunks_[i].max_end_sample);
+		chunks_[i].prefix_max_end_sample = prefix_max;
+	}
 }
 
 } // decode
@@ -29,8 +29,26 @@ namespace pv {
 namespace data {
 namespace decode {
 
+/**
+ * Stores the annotations of one decoder row.
+ *
+ * Annotations are kept in chunks sorted by start sample. Every chunk
+ * records the largest end sample it contains and the chunk list keeps a
+ * running maximum of those values, so that a query for a visible window
+ * only visits the chunks that can overlap it.
+ */
 class RowData
 {
+private:
+	static const size_t ChunkSize;
+
+	struct Chunk
+	{
+		std::vector<Annotation> annotations;
+		uint64_t max_end_sample;
+		uint64_t prefix_max_end_sample;
+	};
+
 public:
 	RowData();
 
@@ -44,10 +62,31 @@ public:
 		std::vector<pv::data::decode::Annotation> &dest,
 		uint64_t start_sample, uint64_t end_sample) const;
 
+	/**
+	 * Extracts sorted annotations between two period into a vector,
+	 * thinning out the annotations shorter than @c min_length samples.
+	 * Of the ones falling into each @c min_length wide bucket, only the
+	 * first one and the one ending last are kept (one more is kept if
+	 * its format differs), which is enough to draw them as a density
+	 * block spanning from the first start to the last end.
+	 */
+	void get_annotation_subset(
+		std::vector<pv::data::decode::Annotation> &dest,
+		uint64_t start_sample, uint64_t end_sample,
+		uint64_t min_length) const;
+
 	void push_annotation(const Annotation &a);
 
 private:
-	std::vector<Annotation> annotations_;
+	template<typename Visitor>
+	void visit_annotations(uint64_t start_sample, uint64_t end_sample,
+		Visitor &visitor) const;
+
+	void update_prefix_max(size_t from);
+
+private:
+	std::vector<Chunk> chunks_;
+	uint64_t max_end_sample_;
 };
 
 }
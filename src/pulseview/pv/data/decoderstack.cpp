@@ -20,6 +20,7 @@
 
 #include <libsigrokdecode/libsigrokdecode.h>
 
+#include <algorithm>
 #include <stdexcept>
 
 #include <QDebug>
@@ -56,6 +57,7 @@ const double DecoderStack::DecodeMargin = 1.0;
 const double DecoderStack::DecodeThreshold = 0.2;
 const int64_t DecoderStack::DecodeChunkLength = 1024 * 256;
 const unsigned int DecoderStack::DecodeNotifyPeriod = 1024;
+const unsigned int DecoderStack::DecodeCacheSize = 4;
 
 mutex DecoderStack::global_srd_mutex_;
 
@@ -67,7 +69,8 @@ DecoderStack::DecoderStack(pv::Session &session,
 	sample_count_(0),
 	frame_complete_(false),
 	samples_decoded_(0),
-	active_decode_index_(0)
+	active_decode_index_(0),
+	decode_complete_(false)
 {
 	connect(&session_, SIGNAL(frame_began()),
 		this, SLOT(on_new_frame()));
@@ -88,11 +91,7 @@ DecoderStack::DecoderStack(pv::Session &session,
 
 DecoderStack::~DecoderStack()
 {
-	if (decode_thread_.joinable()) {
-		interrupt_ = true;
-		input_cond_.notify_one();
-		decode_thread_.join();
-	}
+	stop_decode();
 }
 
 QString DecoderStack::name()
@@ -201,6 +200,19 @@ void DecoderStack::get_annotation_subset(
 			start_sample, end_sample);
 }
 
+void DecoderStack::get_annotation_subset(
+	std::vector<pv::data::decode::Annotation> &dest,
+	const Row &row, uint64_t start_sample,
+	uint64_t end_sample, uint64_t min_length) const
+{
+	lock_guard<mutex> lock(output_mutex_);
+
+	const auto iter = rows_.find(row);
+	if (iter != rows_.end())
+		(*iter).second.get_annotation_subset(dest,
+			start_sample, end_sample, min_length);
+}
+
 QString DecoderStack::error_message()
 {
 	lock_guard<mutex> lock(output_mutex_);
@@ -222,14 +234,12 @@ void DecoderStack::begin_decode()
 	shared_ptr<pv::view::LogicSignal> logic_signal;
 	shared_ptr<pv::data::Logic> data;
 
-	if (decode_thread_.joinable()) {
-		interrupt_ = true;
-		input_cond_.notify_one();
-		decode_thread_.join();
-	}
+	stop_decode();
+	cache_results();
 
 	clear();
 	active_decode_index_ = 0;
+	decoder_keys_.clear();
 
 	// Check that all decoders have the required channels
 	for (const shared_ptr<decode::Decoder> &dec : stack_)
@@ -239,6 +249,9 @@ void DecoderStack::begin_decode()
 			return;
 		}
 
+	for (const shared_ptr<decode::Decoder> &dec : stack_)
+		decoder_keys_.push_back(dec->key());
+
 	// Add classes
 	for (const shared_ptr<decode::Decoder> &dec : stack_) {
 		assert(dec);
@@ -293,10 +306,102 @@ void DecoderStack::begin_decode()
 	if (samplerate_ == 0.0)
 		samplerate_ = 1.0;
 
+	if (restore_cached_results()) {
+		new_decode_data();
+		return;
+	}
+
 	interrupt_ = false;
 	decode_thread_ = std::thread(&DecoderStack::decode_proc, this);
 }
 
+void DecoderStack::stop_decode()
+{
+	if (decode_thread_.joinable()) {
+		interrupt_ = true;
+		input_cond_.notify_one();
+		decode_thread_.join();
+	}
+}
+
+void DecoderStack::cache_results()
+{
+	assert(!decode_thread_.joinable());
+
+	// Forget about results of data which no longer exists
+	decode_cache_.remove_if([](const CachedDecode &c) {
+		return c.segment.expired(); });
+
+	const bool complete = decode_complete_;
+	decode_complete_ = false;
+
+	if (!complete || !segment_ || decoder_keys_.empty())
+		return;
+
+	CachedDecode c;
+	c.decoder_keys = decoder_keys_;
+	c.segment = segment_;
+	c.sample_count = samples_decoded_;
+	c.rows = std::move(rows_);
+
+	// Drop an older copy of the same results
+	decode_cache_.remove_if([&](const CachedDecode &cached) {
+		return cached.decoder_keys == c.decoder_keys; });
+
+	decode_cache_.push_front(std::move(c));
+	while (decode_cache_.size() > DecodeCacheSize)
+		decode_cache_.pop_back();
+}
+
+bool DecoderStack::restore_cached_results()
+{
+	assert(segment_);
+
+	// Results are only reusable once the data stopped changing
+	if (session_.get_capture_state() != Session::Stopped)
+		return false;
+
+	const int64_t sample_count = segment_->get_sample_count();
+
+	for (auto c = decode_cache_.begin(); c != decode_cache_.end(); c++) {
+		if ((*c).segment.lock() != segment_ ||
+			(*c).sample_count != sample_count ||
+			(*c).decoder_keys.size() < decoder_keys_.size() ||
+			!std::equal(decoder_keys_.begin(), decoder_keys_.end(),
+				(*c).decoder_keys.begin()))
+			continue;
+
+		lock_guard<mutex> lock(output_mutex_);
+
+		if ((*c).decoder_keys.size() == decoder_keys_.size()) {
+			// The same stack, take the results back
+			rows_ = std::move((*c).rows);
+			decode_cache_.erase(c);
+		} else {
+			// Decoders are not affected by the ones stacked on top
+			// of them, so the rows of the bottom of a bigger stack
+			// are exactly what this stack produces
+			for (auto &row : rows_) {
+				const auto iter = (*c).rows.find(row.first);
+				if (iter != (*c).rows.end())
+					row.second = (*iter).second;
+			}
+		}
+
+		{
+			lock_guard<mutex> input_lock(input_mutex_);
+			sample_count_ = sample_count;
+			frame_complete_ = true;
+		}
+
+		samples_decoded_ = active_decode_index_ = sample_count;
+		decode_complete_ = true;
+		return true;
+	}
+
+	return false;
+}
+
 uint64_t DecoderStack::max_sample_count() const
 {
 	uint64_t max_sample_count = 0;
@@ -334,17 +439,33 @@ void DecoderStack::decode_data(
 	const int64_t sample_count, const unsigned int unit_size,
 	srd_session *const session)
 {
-	uint8_t chunk[DecodeChunkLength];
+	// Take a single view of the pending samples: the segment memory is
+	// then fed to the decoders without copying it and without holding
+	// the segment lock, so acquisition can keep appending meanwhile
+	const int64_t start = min(active_decode_index_, sample_count);
+	const Segment::SampleView view =
+		segment_->get_sample_view(start, sample_count);
 
 	const unsigned int chunk_sample_count =
 		DecodeChunkLength / segment_->unit_size();
 
-	for (int64_t i = active_decode_index_; !interrupt_ && i < sample_count;
+	// In replace mode the segment is overwritten in place, so only the
+	// chunk being decoded is copied, under the segment lock
+	vector<uint8_t> snapshot;
+	if (!view.stable)
+		snapshot.resize(chunk_sample_count * unit_size);
+
+	for (int64_t i = start; !interrupt_ && i < sample_count;
 			i += chunk_sample_count) {
 
 		const int64_t chunk_end = min(
 			i + chunk_sample_count, sample_count);
-		segment_->get_samples(chunk, i, chunk_end);
+		const uint8_t *chunk = view.data + (i - start) * unit_size;
+
+		if (!view.stable) {
+			segment_->get_samples(snapshot.data(), i, chunk_end);
+			chunk = snapshot.data();
+		}
 
 		if (srd_session_send(session, i, chunk_end, chunk,
 				(chunk_end - i) * unit_size, unit_size) != SRD_OK) {
@@ -418,6 +539,11 @@ void DecoderStack::decode_proc()
 		decode_data(*sample_count, unit_size, session);
 	} while (error_message_.isEmpty() && (sample_count = wait_for_data()));
 
+	{
+		lock_guard<mutex> lock(output_mutex_);
+		decode_complete_ = !interrupt_ && error_message_.isEmpty();
+	}
+
 	// Destroy the session
 	srd_session_destroy(session);
 }
@@ -465,6 +591,11 @@ void DecoderStack::annotation_callback(srd_proto_data *pdata, void *decoder)
 
 void DecoderStack::on_new_frame()
 {
+	// The cached results describe the previous frame
+	stop_decode();
+	decode_complete_ = false;
+	decode_cache_.clear();
+
 	begin_decode();
 }
 
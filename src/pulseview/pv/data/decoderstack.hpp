@@ -28,7 +28,9 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <boost/optional.hpp>
 
@@ -77,6 +79,19 @@ private:
 	static const double DecodeThreshold;
 	static const int64_t DecodeChunkLength;
 	static const unsigned int DecodeNotifyPeriod;
+	static const unsigned int DecodeCacheSize;
+
+	/**
+	 * The results of a finished decode, kept around so that going back
+	 * to a previous decoder configuration doesn't need a re-decode.
+	 */
+	struct CachedDecode
+	{
+		std::vector<std::string> decoder_keys;
+		std::weak_ptr<pv::data::LogicSegment> segment;
+		int64_t sample_count;
+		std::map<const decode::Row, decode::RowData> rows;
+	};
 
 public:
 	DecoderStack(pv::Session &session,
@@ -106,6 +121,15 @@ public:
 		const decode::Row &row, uint64_t start_sample,
 		uint64_t end_sample) const;
 
+	/**
+	 * Extracts sorted annotations between two period into a vector,
+	 * merging the ones shorter than min_length samples.
+	 */
+	void get_annotation_subset(
+		std::vector<pv::data::decode::Annotation> &dest,
+		const decode::Row &row, uint64_t start_sample,
+		uint64_t end_sample, uint64_t min_length) const;
+
 	QString error_message();
 
 	void clear();
@@ -117,6 +141,21 @@ public:
 	QString name();
 
 private:
+	void stop_decode();
+
+	/**
+	 * Moves the results of the last decode into the cache, if the
+	 * decode went through all of the data.
+	 */
+	void cache_results();
+
+	/**
+	 * Looks for cached results produced by the current stack, or by a
+	 * stack it is the bottom part of, and loads them into the rows.
+	 * @return true if the results were loaded and no decode is needed.
+	 */
+	bool restore_cached_results();
+
 	boost::optional<int64_t> wait_for_data() const;
 
 	void decode_data(const int64_t sample_count,
@@ -168,6 +207,10 @@ private:
 
 	std::map<std::pair<const srd_decoder*, int>, decode::Row> class_rows_;
 
+	std::vector<std::string> decoder_keys_;
+	bool decode_complete_;
+	std::list<CachedDecode> decode_cache_;
+
 	QString error_message_;
 
 	std::thread decode_thread_;
@@ -50,7 +50,9 @@ LogicSegment::LogicSegment(shared_ptr<Logic> logic, uint64_t samplerate,
 				const uint64_t expected_num_samples) :
 	Segment(samplerate, logic->unit_size()),
 	last_append_sample_(0),
-	replace_mode(false)
+	replace_mode(false),
+	mipmap_ready_(true),
+	mipmap_cancel_(false)
 {
 	set_capacity(expected_num_samples);
 
@@ -58,8 +60,26 @@ LogicSegment::LogicSegment(shared_ptr<Logic> logic, uint64_t samplerate,
 	memset(mip_map_, 0, sizeof(mip_map_));
 }
 
+LogicSegment::LogicSegment(unsigned int unit_size, uint64_t samplerate,
+	shared_ptr<const uint8_t> data, uint64_t sample_count) :
+	Segment(samplerate, unit_size),
+	last_append_sample_(0),
+	replace_mode(false),
+	mipmap_ready_(false),
+	mipmap_cancel_(false)
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+	memset(mip_map_, 0, sizeof(mip_map_));
+
+	set_external_data(data, sample_count);
+}
+
 LogicSegment::~LogicSegment()
 {
+	mipmap_cancel_ = true;
+	if (mipmap_thread_.joinable())
+		mipmap_thread_.join();
+
 	lock_guard<recursive_mutex> lock(mutex_);
 	for (MipMapLevel &l : mip_map_)
 		free(l.data);
@@ -151,6 +171,7 @@ void LogicSegment::append_payload(shared_ptr<Logic> logic)
 	replace_mode = false;
 	// Generate the first mip-map from the data
 	append_payload_to_mipmap();
+	mipmap_ready_ = true;
 }
 
 void LogicSegment::replace_payload(shared_ptr<Logic> logic)
@@ -163,6 +184,7 @@ void LogicSegment::replace_payload(shared_ptr<Logic> logic)
 
 	replace_mode = true;
 	append_payload_to_mipmap(previous_active_index);
+	mipmap_ready_ = true;
 }
 
 void LogicSegment::get_samples(uint8_t *const data,
@@ -178,7 +200,7 @@ void LogicSegment::get_samples(uint8_t *const data,
 	lock_guard<recursive_mutex> lock(mutex_);
 
 	const size_t size = (end_sample - start_sample) * unit_size_;
-	memcpy(data, (const uint8_t*)data_.data() + start_sample * unit_size_, size);
+	memcpy(data, sample_data() + start_sample * unit_size_, size);
 }
 
 void LogicSegment::reallocate_mipmap_level(MipMapLevel &m)
@@ -225,9 +247,9 @@ void LogicSegment::append_payload_to_mipmap(uint64_t prev_active)
 	dest_ptr = (uint8_t*)m0.data + prev_index * unit_size_;
 
 	// Iterate through the samples to populate the first level mipmap
-	const uint8_t *const end_src_ptr = (uint8_t*)data_.data() +
+	const uint8_t *const end_src_ptr = sample_data() +
 		end_index * unit_size_ * MipMapScaleFactor;
-	for (src_ptr = (uint8_t*)data_.data() +
+	for (src_ptr = sample_data() +
 			prev_index * unit_size_ * MipMapScaleFactor;
 			src_ptr < end_src_ptr;) {
 		// Accumulate transitions which have occurred in this sample
@@ -287,11 +309,108 @@ void LogicSegment::append_payload_to_mipmap(uint64_t prev_active)
 	}
 }
 
+bool LogicSegment::mipmap_ready() const
+{
+	return mipmap_ready_;
+}
+
+void LogicSegment::build_mipmap_async(std::function<void()> done)
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	if (mipmap_ready_ || mipmap_thread_.joinable())
+		return;
+
+	mipmap_thread_ = std::thread(&LogicSegment::build_mipmap, this,
+		get_sample_view(0, sample_count_), done);
+}
+
+void LogicSegment::build_mipmap(Segment::SampleView view,
+	std::function<void()> done)
+{
+	// The levels are built aside, the segment is only locked to swap
+	// them in, so that it can be drawn meanwhile
+	MipMapLevel levels[ScaleStepCount];
+	memset(levels, 0, sizeof(levels));
+
+	const uint8_t *src_ptr = view.data;
+	uint64_t last_sample = 0;
+
+	MipMapLevel &m0 = levels[0];
+	m0.length = view.sample_count / MipMapScaleFactor;
+	reallocate_mipmap_level(m0);
+
+	uint8_t *dest_ptr = (uint8_t*)m0.data;
+	for (uint64_t i = 0; i < m0.length; i++) {
+		if ((i % MipMapDataUnit) == 0 && mipmap_cancel_)
+			break;
+
+		uint64_t accumulator = 0;
+		for (int j = 0; j < MipMapScaleFactor; j++) {
+			const uint64_t sample = unpack_sample(src_ptr);
+			accumulator |= last_sample ^ sample;
+			last_sample = sample;
+			src_ptr += unit_size_;
+		}
+
+		pack_sample(dest_ptr, accumulator);
+		dest_ptr += unit_size_;
+	}
+
+	for (unsigned int level = 1; level < ScaleStepCount &&
+			!mipmap_cancel_; level++) {
+		MipMapLevel &m = levels[level];
+		const MipMapLevel &ml = levels[level - 1];
+
+		m.length = ml.length / MipMapScaleFactor;
+		if (m.length == 0)
+			break;
+
+		reallocate_mipmap_level(m);
+
+		src_ptr = (const uint8_t*)ml.data;
+		dest_ptr = (uint8_t*)m.data;
+		for (uint64_t i = 0; i < m.length; i++) {
+			uint64_t accumulator = 0;
+			for (int j = 0; j < MipMapScaleFactor; j++) {
+				accumulator |= unpack_sample(src_ptr);
+				src_ptr += unit_size_;
+			}
+
+			pack_sample(dest_ptr, accumulator);
+			dest_ptr += unit_size_;
+		}
+	}
+
+	bool installed = false;
+
+	{
+		lock_guard<recursive_mutex> lock(mutex_);
+
+		// Samples appended meanwhile built the mip-map themselves
+		if (!mipmap_cancel_ && !mipmap_ready_) {
+			for (unsigned int level = 0; level < ScaleStepCount;
+					level++)
+				std::swap(mip_map_[level], levels[level]);
+
+			last_append_sample_ = last_sample;
+			mipmap_ready_ = true;
+			installed = true;
+		}
+	}
+
+	for (MipMapLevel &l : levels)
+		free(l.data);
+
+	if (installed && done)
+		done();
+}
+
 uint64_t LogicSegment::get_sample(uint64_t index) const
 {
 	assert(index < sample_count_);
 
-	return unpack_sample((uint8_t*)data_.data() + index * unit_size_);
+	return unpack_sample(sample_data() + index * unit_size_);
 }
 
 void LogicSegment::get_subsampled_edges(
@@ -23,6 +23,9 @@
 
 #include "segment.hpp"
 
+#include <atomic>
+#include <functional>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -65,6 +68,17 @@ public:
 	LogicSegment(std::shared_ptr<sigrok::Logic> logic,
 		uint64_t samplerate, uint64_t expected_num_samples = 0);
 
+	/**
+	 * Creates a segment on top of already captured samples, e.g. the
+	 * payload of a memory mapped capture file. See
+	 * @c Segment::set_external_data().
+	 *
+	 * The mip-map of these samples is not built by the constructor, see
+	 * @c build_mipmap_async().
+	 */
+	LogicSegment(unsigned int unit_size, uint64_t samplerate,
+		std::shared_ptr<const uint8_t> data, uint64_t sample_count);
+
 	virtual ~LogicSegment();
 
 	void append_payload(std::shared_ptr<sigrok::Logic> logic);
@@ -74,6 +88,17 @@ public:
 		int64_t start_sample, int64_t end_sample) const;
 	uint64_t get_sample(uint64_t index) const;
 
+	bool mipmap_ready() const;
+
+	/**
+	 * Builds the mip-map of the samples on a background thread, without
+	 * touching them from the caller's thread. Until it is done, the
+	 * edges are looked for one sample per block.
+	 * @param[in] done Called from the background thread once the
+	 * mip-map is in use.
+	 */
+	void build_mipmap_async(std::function<void()> done);
+
 private:
 	uint64_t unpack_sample(const uint8_t *ptr) const;
 	void pack_sample(uint8_t *ptr, uint64_t value);
@@ -82,6 +107,8 @@ private:
 
 	void append_payload_to_mipmap(uint64_t prev_active=0);
 
+	void build_mipmap(Segment::SampleView view, std::function<void()> done);
+
 
 
 public:
@@ -109,6 +136,10 @@ private:
 	uint64_t last_append_sample_;
 	bool replace_mode;
 
+	std::thread mipmap_thread_;
+	std::atomic<bool> mipmap_ready_;
+	std::atomic<bool> mipmap_cancel_;
+
 	friend struct LogicSegmentTest::Pow2;
 	friend struct LogicSegmentTest::Basic;
 	friend struct LogicSegmentTest::LargeData;
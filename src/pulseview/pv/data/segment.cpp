@@ -20,24 +20,30 @@
 
 #include "segment.hpp"
 
+#include <algorithm>
+
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
 using std::lock_guard;
+using std::make_shared;
 using std::recursive_mutex;
+using std::vector;
 
 namespace pv {
 namespace data {
 
 Segment::Segment(uint64_t samplerate, unsigned int unit_size) :
+	data_(make_shared<vector<uint8_t>>()),
 	sample_count_(0),
 	total_sample_count_(0),
 	start_time_(0),
 	samplerate_(samplerate),
 	capacity_(0),
 	unit_size_(unit_size),
-	active_sample_index_(0)
+	active_sample_index_(0),
+	in_place_(false)
 {
 	lock_guard<recursive_mutex> lock(mutex_);
 	assert(unit_size_ > 0);
@@ -86,7 +92,7 @@ void Segment::set_capacity(const uint64_t new_capacity)
 	assert(capacity_ >= sample_count_);
 	if (new_capacity > capacity_) {
 		// If we're out of memory, this will throw std::bad_alloc
-		data_.resize((new_capacity * unit_size_) + sizeof(uint64_t));
+		resize_data((new_capacity * unit_size_) + sizeof(uint64_t));
 		capacity_ = new_capacity;
 	}
 }
@@ -94,13 +100,100 @@ void Segment::set_capacity(const uint64_t new_capacity)
 uint64_t Segment::capacity() const
 {
 	lock_guard<recursive_mutex> lock(mutex_);
-	return data_.size();
+	return data_->size();
+}
+
+Segment::SampleView Segment::get_sample_view(int64_t start_sample,
+	int64_t end_sample) const
+{
+	assert(start_sample >= 0);
+	assert(end_sample >= 0);
+	assert(start_sample <= end_sample);
+
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	assert(end_sample <= (int64_t)sample_count_);
+
+	SampleView view;
+	if (external_data_)
+		view.storage = external_data_;
+	else
+		view.storage = data_;
+	view.data = sample_data() + start_sample * unit_size_;
+	view.sample_count = end_sample - start_sample;
+	view.stable = !in_place_;
+	return view;
+}
+
+void Segment::set_external_data(std::shared_ptr<const uint8_t> data,
+	uint64_t samples)
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	assert(data);
+
+	external_data_ = data;
+	data_ = make_shared<vector<uint8_t>>();
+	sample_count_ = samples;
+	total_sample_count_ = samples;
+	active_sample_index_ = samples;
+	capacity_ = samples;
+	in_place_ = false;
+}
+
+const uint8_t* Segment::sample_data() const
+{
+	return external_data_ ? external_data_.get() : data_->data();
+}
+
+void Segment::resize_data(size_t size)
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	if (external_data_)
+		detach_data();
+
+	if (data_.use_count() == 1) {
+		data_->resize(size);
+		return;
+	}
+
+	// The storage is still being read through a view, leave it to the
+	// reader and continue in a copy
+	const auto data = make_shared<vector<uint8_t>>(size);
+	memcpy(data->data(), data_->data(), std::min(size, data_->size()));
+	data_ = data;
+}
+
+void Segment::detach_data()
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	if (external_data_) {
+		const size_t size = capacity_ * unit_size_ + sizeof(uint64_t);
+		data_ = make_shared<vector<uint8_t>>(external_data_.get(),
+			external_data_.get() + size);
+		external_data_.reset();
+		return;
+	}
+
+	if (data_.use_count() != 1)
+		data_ = make_shared<vector<uint8_t>>(*data_);
+}
+
+bool Segment::overwrites_in_place() const
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+	return in_place_;
 }
 
 void Segment::append_data(void *data, uint64_t samples)
 {
 	lock_guard<recursive_mutex> lock(mutex_);
 
+	// New views are stable again, as appending never overwrites samples
+	in_place_ = false;
+
 	assert(capacity_ >= sample_count_);
 
 	// Ensure there's enough capacity to copy.
@@ -108,7 +201,7 @@ void Segment::append_data(void *data, uint64_t samples)
 	if (free_space < samples)
 		set_capacity(sample_count_ + samples);
 
-	memcpy((uint8_t*)data_.data() + sample_count_ * unit_size_,
+	memcpy((uint8_t*)data_->data() + sample_count_ * unit_size_,
 		data, samples * unit_size_);
 	sample_count_ += samples;
 	total_sample_count_ += samples;
@@ -121,17 +214,25 @@ void Segment::replace_data(void *data, uint64_t samples)
         assert(capacity_ == sample_count_);
         uint64_t free_space = capacity_ - active_sample_index_;
 
+        // The samples are overwritten in place. The storage only has to
+        // be detached from the stable views once, when switching to this
+        // mode; the views taken from now on are copied from under the lock
+        if (!in_place_) {
+                detach_data();
+                in_place_ = true;
+        }
+
         uint64_t samples_to_copy = samples;
         uint64_t samples_left = 0;
         if( samples > free_space )
                 samples_to_copy = free_space;
 
-        memcpy((uint8_t*)data_.data() + active_sample_index_ * unit_size_,
+        memcpy((uint8_t*)data_->data() + active_sample_index_ * unit_size_,
                data, samples_to_copy * unit_size_);
 
         if(samples_to_copy !=  samples) {
                 samples_left =  samples - samples_to_copy;
-                memcpy((uint8_t*)data_.data(),
+                memcpy((uint8_t*)data_->data(),
                         (uint8_t*)data + samples_to_copy * unit_size_,
                         samples_left * unit_size_);
         }
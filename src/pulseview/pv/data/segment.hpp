@@ -21,6 +21,7 @@
 #ifndef PULSEVIEW_PV_DATA_SEGMENT_HPP
 #define PULSEVIEW_PV_DATA_SEGMENT_HPP
 #include "../util.hpp"
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <vector>
@@ -30,6 +31,29 @@ namespace data {
 
 class Segment
 {
+public:
+	/**
+	 * A read-only view of a range of the segment's samples.
+	 *
+	 * The view shares ownership of the memory it points into: the segment
+	 * never reallocates storage that is referenced by a view, it moves to
+	 * a fresh copy instead. Unless the view is not @c stable, the samples
+	 * can therefore be read without holding the segment mutex for as long
+	 * as the view exists.
+	 *
+	 * In replace mode the segment is a ring buffer which is overwritten
+	 * in place, without copying it on every refill. Views taken in that
+	 * mode are not stable: their samples must be copied under the segment
+	 * mutex, a window at a time.
+	 */
+	struct SampleView
+	{
+		std::shared_ptr<const void> storage;
+		const uint8_t *data;
+		uint64_t sample_count;
+		bool stable;
+	};
+
 public:
 	Segment(uint64_t samplerate, unsigned int unit_size);
 
@@ -73,16 +97,61 @@ public:
 	 */
 	uint64_t capacity() const;
 
+	/**
+	 * @brief Get a zero-copy view of the samples in a range.
+	 *
+	 * @param[in] start_sample The first sample of the range.
+	 * @param[in] end_sample The sample after the last one of the range.
+	 */
+	SampleView get_sample_view(int64_t start_sample,
+		int64_t end_sample) const;
+
+	/**
+	 * @brief Use externally owned memory, e.g. a memory mapped capture
+	 * file, as the samples of the segment.
+	 *
+	 * The memory is only read; it is copied into the segment's own
+	 * storage the first time the segment is modified. It must be padded
+	 * with at least @c sizeof(uint64_t) bytes after the last sample.
+	 *
+	 * @param[in] data The samples. The segment keeps a reference to them.
+	 * @param[in] samples The number of samples.
+	 */
+	void set_external_data(std::shared_ptr<const uint8_t> data,
+		uint64_t samples);
+
 protected:
+	const uint8_t* sample_data() const;
+
 	void append_data(void *data, uint64_t samples);
 	void replace_data(void *data, uint64_t samples);
 
+	/**
+	 * Resizes the sample storage, moving to a new buffer if the current
+	 * one is referenced by a @c SampleView.
+	 */
+	void resize_data(size_t size);
+
+	/**
+	 * Makes sure the sample storage is not referenced by any
+	 * @c SampleView, nor external, before it is modified in place.
+	 */
+	void detach_data();
+
+	/**
+	 * Whether the samples are overwritten in place by @c replace_data(),
+	 * in which case the views are not stable.
+	 */
+	bool overwrites_in_place() const;
+
 protected:
 	mutable std::recursive_mutex mutex_;
-	std::vector<uint8_t> data_;
+	std::shared_ptr<std::vector<uint8_t>> data_;
+	std::shared_ptr<const uint8_t> external_data_;
 	uint64_t sample_count_;
 	uint64_t total_sample_count_;
 	uint64_t active_sample_index_;
+	bool in_place_;
 	pv::util::Timestamp start_time_;
 	double samplerate_;
 	uint64_t capacity_;
@@ -738,6 +738,41 @@ std::shared_ptr<data::Logic> Session::get_logic_data()
 	return logic_data_;
 }
 
+bool Session::load_logic_segment(shared_ptr<data::LogicSegment> segment)
+{
+	assert(segment);
+
+	if (get_capture_state() != Stopped)
+		return false;
+
+	{
+		lock_guard<recursive_mutex> lock(data_mutex_);
+
+		if (!logic_data_)
+			update_signals();
+		if (!logic_data_)
+			return false;
+
+		for (const shared_ptr<data::SignalData> d : get_data())
+			d->clear_old_data();
+
+		cur_samplerate_ = segment->samplerate();
+		logic_data_->push_segment(segment);
+	}
+
+	// The view is drawn again once the mip-map of the loaded samples is
+	// ready; until then the edges are looked for one sample per block
+	if (!segment->mipmap_ready())
+		segment->build_mipmap_async([this]() { data_received(); });
+
+	frame_began();
+	new_segment_received();
+	data_received();
+	frame_ended();
+
+	return true;
+}
+
 void Session::feed_in_analog(shared_ptr<Analog> analog)
 {
 	lock_guard<recursive_mutex> lock(data_mutex_);
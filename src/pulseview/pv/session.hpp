@@ -161,6 +161,12 @@ public:
 
 	std::shared_ptr<data::Logic> get_logic_data();
 
+	/**
+	 * Replaces the logic data with an already captured segment, as if
+	 * it had just been acquired.
+	 */
+	bool load_logic_segment(std::shared_ptr<data::LogicSegment> segment);
+
 	void clear_data();
 
 private:
@@ -225,6 +225,10 @@ void DecodeTrace::paint_mid(QPainter &p, const ViewItemPaintParams &pp)
 	pair<uint64_t, uint64_t> sample_range = get_sample_range(
 		pp.left(), pp.right());
 
+	double samples_per_pixel, pixels_offset;
+	tie(pixels_offset, samples_per_pixel) =
+		get_pixels_offset_samples_per_pixel();
+
 	assert(decoder_stack_);
 	const vector<Row> rows(decoder_stack_->get_visible_rows());
 
@@ -248,9 +252,12 @@ void DecodeTrace::paint_mid(QPainter &p, const ViewItemPaintParams &pp)
 		boost::hash_combine(base_colour, row.row());
 		base_colour >>= 16;
 
+		// Annotations narrower than a pixel are only drawn as part of
+		// a block, so there is no need to fetch all of them
 		vector<Annotation> annotations;
 		decoder_stack_->get_annotation_subset(annotations, row,
-			sample_range.first,sample_range.second);
+			sample_range.first, sample_range.second,
+			(uint64_t)max(samples_per_pixel, 1.0));
 		if (!annotations.empty()) {
 			draw_annotations(annotations, p, annotation_height, pp, y,
 				base_colour, row_title_width);
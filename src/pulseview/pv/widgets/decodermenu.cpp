@@ -23,6 +23,7 @@
 #include <libsigrokdecode/libsigrokdecode.h>
 
 #include "decodermenu.hpp"
+#include "../../../decoder_index.hpp"
 
 namespace pv {
 namespace widgets {
@@ -31,42 +32,32 @@ DecoderMenu::DecoderMenu(QWidget *parent, bool first_level_decoder) :
 	QMenu(parent),
 	mapper_(this)
 {
-	GSList *l = g_slist_sort(g_slist_copy(
-		(GSList*)srd_decoder_list()), decoder_name_cmp);
-
-	for (; l; l = l->next) {
-		const srd_decoder *const d = (srd_decoder*)l->data;
-		assert(d);
-		const bool have_channels = (d->channels || d->opt_channels) != 0;
+	// Listed from the index, so that the decoders are only imported
+	// once they are selected
+	for (const auto& d : adiscope::DecoderIndex::decoders()) {
+		const bool have_channels = !d.channels.empty() ||
+			!d.opt_channels.empty();
 		if (first_level_decoder == have_channels) {
-			QAction *const action =
-				addAction(QString::fromUtf8(d->name));
-			action->setData(qVariantFromValue(l->data));
+			QAction *const action = addAction(d.name);
+			action->setData(d.id);
 			mapper_.setMapping(action, action);
 			connect(action, SIGNAL(triggered()),
 				&mapper_, SLOT(map()));
 		}
 	}
-	g_slist_free(l);
 
 	connect(&mapper_, SIGNAL(mapped(QObject*)),
 		this, SLOT(on_action(QObject*)));
 }
 
-int DecoderMenu::decoder_name_cmp(const void *a, const void *b)
-{
-	return strcmp(((const srd_decoder*)a)->name,
-		((const srd_decoder*)b)->name);
-}
-
 void DecoderMenu::on_action(QObject *action)
 {
 	assert(action);
-	srd_decoder *const dec =
-		(srd_decoder*)((QAction*)action)->data().value<void*>();
-	assert(dec);
+	const srd_decoder *const dec = adiscope::DecoderIndex::decoder(
+		((QAction*)action)->data().toString());
 
-	decoder_selected(dec);	
+	if (dec)
+		decoder_selected((srd_decoder*)dec);
 }
 
 } // widgets
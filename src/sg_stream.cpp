@@ -0,0 +1,219 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QDebug>
+
+#include <volk/volk.h>
+
+#include "sg_stream.hpp"
+
+using namespace adiscope;
+
+const unsigned int SignalGeneratorStream::controlInterval = 64;
+
+/* Chunks of ~20ms, within what the kernel buffers of the DAC can hold.
+ * The HDL wants buffers which are a multiple of 4 samples. */
+static const size_t minChunkSize = 1024;
+static const size_t maxChunkSize = 256 * 1024;
+
+SignalGeneratorStream::SignalGeneratorStream() :
+	sampleRate(0),
+	scale(1),
+	chunkSize(minChunkSize),
+	position(0),
+	phase(0),
+	noiseState(1)
+{
+	memset(&settings, 0, sizeof(settings));
+}
+
+SignalGeneratorStream::~SignalGeneratorStream()
+{
+	stop();
+}
+
+void SignalGeneratorStream::prepare(const Settings& settings,
+                                    double sampleRate, float scale)
+{
+	this->settings = settings;
+	this->sampleRate = sampleRate;
+	this->scale = scale;
+
+	chunkSize = (size_t)(sampleRate / 50);
+	chunkSize = std::min(std::max(chunkSize, minChunkSize), maxChunkSize);
+	chunkSize &= ~(size_t)3;
+
+	double start = settings.phase / 360.0;
+	start -= std::floor(start);
+
+	position = 0;
+	phase = (uint64_t)std::ldexp(start, 32) << 32;
+	noiseState = 0x9e3779b9;
+}
+
+bool SignalGeneratorStream::start(const struct iio_device *dev)
+{
+	if (!open(dev, chunkSize, sampleRate)) {
+		return false;
+	}
+
+	launch();
+
+	return true;
+}
+
+double SignalGeneratorStream::getMaxFrequency(const Settings& settings)
+{
+	double frequency = std::max(settings.startFrequency,
+	                            settings.stopFrequency);
+
+	if (settings.fmFrequency > 0) {
+		frequency += std::max(settings.fmDeviation, 0.0);
+	}
+
+	return frequency;
+}
+
+double SignalGeneratorStream::frequencyAt(double time) const
+{
+	const Settings& s = settings;
+	double frequency = s.startFrequency;
+
+	if (s.sweepTime > 0 && s.stopFrequency != s.startFrequency) {
+		double x = std::fmod(time, s.sweepTime) / s.sweepTime;
+
+		if (s.logSweep && s.startFrequency > 0 && s.stopFrequency > 0) {
+			frequency = s.startFrequency *
+			            std::pow(s.stopFrequency / s.startFrequency, x);
+		} else {
+			frequency = s.startFrequency +
+			            (s.stopFrequency - s.startFrequency) * x;
+		}
+	}
+
+	if (s.fmDeviation > 0 && s.fmFrequency > 0) {
+		frequency += s.fmDeviation *
+		             std::sin(2.0 * M_PI * s.fmFrequency * time);
+	}
+
+	// Keep the phase increment below half a period
+	return std::min(std::max(frequency, 0.0), sampleRate * 0.49);
+}
+
+double SignalGeneratorStream::gainAt(double time) const
+{
+	const Settings& s = settings;
+
+	if (s.amDepth <= 0 || s.amFrequency <= 0) {
+		return 1.0;
+	}
+
+	return 1.0 - s.amDepth *
+	       (1.0 - std::sin(2.0 * M_PI * s.amFrequency * time)) / 2.0;
+}
+
+void SignalGeneratorStream::fill(int16_t *dst, ptrdiff_t stride,
+                                 size_t samples)
+{
+	const size_t blockSize = WaveformSynth::blockSize;
+	const double periodUnit = std::ldexp(1.0, 64);
+	const float amplitude = settings.amplitude;
+	const float offset = settings.offset;
+	const float noise = settings.noise;
+
+	uint32_t phases[blockSize];
+	float gains[blockSize];
+	float block[blockSize];
+	int16_t converted[blockSize];
+	char *out = (char *)dst;
+
+	for (size_t i = 0; i < samples; i += blockSize) {
+		size_t n = std::min(blockSize, samples - i);
+
+		// The frequency and the gain follow straight lines between
+		// the control points
+		for (size_t j = 0; j < n; j += controlInterval) {
+			size_t m = std::min<size_t>(controlInterval, n - j);
+			double t0 = (position + j) / sampleRate;
+			double t1 = (position + j + m) / sampleRate;
+			double inc0 = frequencyAt(t0) / sampleRate * periodUnit;
+			double inc1 = frequencyAt(t1) / sampleRate * periodUnit;
+			int64_t inc = (int64_t)inc0;
+			int64_t dinc = (int64_t)((inc1 - inc0) / m);
+			float g0 = gainAt(t0);
+			float dg = (gainAt(t1) - g0) / m;
+
+			for (size_t k = 0; k < m; k++) {
+				phases[j + k] = phase >> 32;
+				gains[j + k] = g0 + k * dg;
+				phase += inc;
+				inc += dinc;
+			}
+		}
+
+		position += n;
+
+		WaveformSynth::renderPhases(settings.shape, phases, block, n,
+		                            amplitude, 0.0f);
+
+		if (noise > 0) {
+			// xorshift32, uniform over [-noise / 2, noise / 2]
+			const float noiseUnit = noise / 4294967296.0f;
+			uint32_t state = noiseState;
+
+			for (size_t j = 0; j < n; j++) {
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				block[j] = offset + gains[j] * block[j] +
+				           (int32_t)state * noiseUnit;
+			}
+
+			noiseState = state;
+		} else {
+			for (size_t j = 0; j < n; j++) {
+				block[j] = offset + gains[j] * block[j];
+			}
+		}
+
+		if (stride == sizeof(int16_t)) {
+			volk_32f_s32f_convert_16i((int16_t *)out, block, scale, n);
+			out += n * sizeof(int16_t);
+			continue;
+		}
+
+		volk_32f_s32f_convert_16i(converted, block, scale, n);
+
+		for (size_t j = 0; j < n; j++) {
+			*(int16_t *)out = converted[j];
+			out += stride;
+		}
+	}
+}
+
+size_t SignalGeneratorStream::produce(struct iio_buffer *buf)
+{
+	fill((int16_t *)iio_buffer_start(buf), iio_buffer_step(buf), chunkSize);
+
+	return chunkSize;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SG_STREAM_HPP
+#define SG_STREAM_HPP
+
+#include <cstdint>
+
+#include "iio_tx_stream.hpp"
+#include "waveform_synth.hpp"
+
+namespace adiscope {
+
+/*
+ * Plays a signal generator channel as a continuous stream instead of a
+ * cyclic buffer, for signals which never repeat within the memory of the
+ * device: frequency sweeps, AM / FM modulation and noise.
+ *
+ * The producer thread runs a phase accumulator (DDS) over each chunk.
+ * The frequency and the AM gain are computed once every
+ * few samples and interpolated in between, so the inner loop only
+ * accumulates the phase and looks up the waveform.
+ */
+class SignalGeneratorStream : public IioTxStream
+{
+public:
+	struct Settings {
+		WaveformSynth::Shape shape;
+		double amplitude;	// peak to peak, volts
+		double offset;		// volts
+		double phase;		// degrees
+
+		/* The frequency sweeps from start to stop over sweepTime
+		 * seconds, then starts over. A null sweep time, or equal
+		 * frequencies, give a fixed frequency. */
+		double startFrequency;
+		double stopFrequency;
+		double sweepTime;
+		bool logSweep;
+
+		/* The amplitude goes down to (1 - amDepth) of its value */
+		double amDepth;
+		double amFrequency;
+
+		double fmDeviation;	// Hz
+		double fmFrequency;
+
+		double noise;		// peak to peak, volts
+	};
+
+	SignalGeneratorStream();
+	~SignalGeneratorStream();
+
+	/*
+	 * @scale converts volts to DAC codes, as for WaveformSynth.
+	 * Must be called before start().
+	 */
+	void prepare(const Settings& settings, double sampleRate, float scale);
+
+	bool start(const struct iio_device *dev);
+
+	// Highest frequency which the settings can produce
+	static double getMaxFrequency(const Settings& settings);
+
+	static const unsigned int controlInterval;
+
+protected:
+	size_t produce(struct iio_buffer *buf);
+
+private:
+	void fill(int16_t *dst, ptrdiff_t stride, size_t samples);
+	double frequencyAt(double time) const;
+	double gainAt(double time) const;
+
+	Settings settings;
+	double sampleRate;
+	float scale;
+	size_t chunkSize;
+
+	uint64_t position;
+	uint64_t phase;
+	uint32_t noiseState;
+};
+}
+
+#endif /* SG_STREAM_HPP */
@@ -22,12 +22,15 @@
 #include "spinbox_a.hpp"
 #include "ui_signal_generator.h"
 #include "channel_widget.hpp"
+#include "waveform_synth.hpp"
+#include "awg_file.hpp"
+#include "iio_attr_cache.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QBrush>
 #include <QFileDialog>
-#include <QFileInfo>
 #include <QPalette>
 #include <QSharedPointer>
 #include <QElapsedTimer>
@@ -35,13 +38,13 @@
 #include <gnuradio/analog/sig_source_f.h>
 #include <gnuradio/analog/sig_source_waveform.h>
 #include <gnuradio/blocks/delay.h>
-#include <gnuradio/blocks/file_source.h>
 #include <gnuradio/blocks/float_to_short.h>
 #include <gnuradio/blocks/head.h>
 #include <gnuradio/blocks/int_to_float.h>
 #include <gnuradio/blocks/multiply_const_ff.h>
 #include <gnuradio/blocks/nop.h>
 #include <gnuradio/blocks/skiphead.h>
+#include <gnuradio/blocks/vector_source_f.h>
 #include <gnuradio/blocks/vector_sink_s.h>
 #include <gnuradio/iio/device_sink.h>
 #include <gnuradio/iio/math.h>
@@ -55,6 +58,19 @@
 
 #define AMPLITUDE_VOLTS	5.0
 
+/* Relative frequency errors accepted for the generated signals: the first
+ * one for perfect sample rates, then the ones tried in turn for the other
+ * rates. 1 ppm is in the range of the accuracy of the DAC clock. */
+static const double exact_tolerance = 1e-12;
+static const double frequency_tolerances[] = { 1e-6, 1e-5, 1e-4, 1e-3, 1e-2 };
+
+/* Buffer sizes checked by the joint solver before it settles for the LCM */
+static const size_t max_solver_steps = 4096;
+
+/* Streamed signals use the lowest sample rate giving at least this many
+ * samples per period of their highest frequency */
+static const double stream_oversampling = 32.0;
+
 using namespace adiscope;
 using namespace gr;
 
@@ -83,7 +99,19 @@ struct adiscope::signal_generator_data {
 	double phase;
 	enum sg_waveform waveform;
 	QString file;
+	std::shared_ptr<AwgFile> file_data;
 	QString function;
+	double frequency_error;
+
+	/* Only used in streaming mode */
+	double sweep_stop_freq;
+	double sweep_time;
+	bool sweep_log;
+	double am_depth;
+	double am_freq;
+	double fm_deviation;
+	double fm_freq;
+	double noise;
 };
 Q_DECLARE_METATYPE(QSharedPointer<signal_generator_data>);
 
@@ -103,7 +131,8 @@ SignalGenerator::SignalGenerator(struct iio_context *_ctx,
 	time_block_data(new adiscope::time_block_data),
 	dacs(dacs),
 	currentChannel(0), sample_rate(0),
-	settings_group(new QButtonGroup(this)),nb_points(NB_POINTS)
+	settings_group(new QButtonGroup(this)),nb_points(NB_POINTS),
+	streaming(false)
 {
 	zoomT1=0;
 	zoomT2=1;
@@ -144,8 +173,8 @@ SignalGenerator::SignalGenerator(struct iio_context *_ctx,
 		this->amp2 = iio_device_find_channel(fabric, "voltage1", true);
 
 		if (amp1 && amp2) {
-			iio_channel_attr_write_bool(amp1, "powerdown", true);
-			iio_channel_attr_write_bool(amp2, "powerdown", true);
+			IioAttrCache::write(amp1, "powerdown", true);
+			IioAttrCache::write(amp2, "powerdown", true);
 		}
 	}
 
@@ -175,6 +204,15 @@ SignalGenerator::SignalGenerator(struct iio_context *_ctx,
 		ptr->phase = ui->phase->value();
 		ptr->waveform = SG_SIN_WAVE;
 		ptr->math_freq = ui->mathFrequency->value();
+		ptr->frequency_error = 0.0;
+		ptr->sweep_stop_freq = ptr->frequency;
+		ptr->sweep_time = 0.0;
+		ptr->sweep_log = false;
+		ptr->am_depth = 0.0;
+		ptr->am_freq = 0.0;
+		ptr->fm_deviation = 0.0;
+		ptr->fm_freq = 0.0;
+		ptr->noise = 0.0;
 
 		ptr->type = SIGNAL_TYPE_CONSTANT;
 		ptr->id = i;
@@ -316,7 +354,19 @@ void SignalGenerator::resetZoom()
 
 			switch (ptr->type) {
 			case SIGNAL_TYPE_CONSTANT:
+				break;
+
 			case SIGNAL_TYPE_BUFFER:
+				if (ptr->file_data) {
+					double duration = ptr->file_data->sampleCount() /
+					                  ptr->file_data->sampleRate();
+
+					if (period < duration) {
+						period = duration;
+						slowSignalId = ptr->id;
+					}
+				}
+
 				break;
 
 			case SIGNAL_TYPE_WAVEFORM:
@@ -488,32 +538,73 @@ void SignalGenerator::tabChanged(int index)
 
 void SignalGenerator::updatePreview()
 {
-	gr::top_block_sptr top = make_top_block("Signal Generator Update");
-	unsigned int i = 0;
 	bool enabled = false;
+	bool synthesize = true;
 
 	for (auto it = channels.begin(); it != channels.end(); ++it) {
-		basic_block_sptr source;
-
 		if ((*it)->enableButton()->isChecked()) {
-
-			source = getSource((*it), sample_rate, top, true);
 			enabled = true;
-		} else {
-			source = blocks::nop::make(sizeof(float));
+			synthesize &= getData(*it)->type != SIGNAL_TYPE_MATH;
 		}
-
-		auto head = blocks::head::make(sizeof(float), nb_points);
-		top->connect(source, 0, head, 0);
-
-		top->connect(head, 0, time_block_data->time_block, i++);
 	}
 
 	QElapsedTimer timer;
 	timer.start();
-	top->run();
-	qDebug() << "The slow operation took" << timer.elapsed() << "milliseconds";
-	top->disconnect_all();
+
+	if (synthesize) {
+		std::vector<double *> points;
+
+		preview_data.resize(channels.size());
+
+		for (int i = 0; i < channels.size(); i++) {
+			std::vector<double>& data = preview_data[i];
+
+			data.resize(nb_points);
+
+			auto ptr = getData(channels[i]);
+
+			if (!channels[i]->enableButton()->isChecked()) {
+				std::fill(data.begin(), data.end(), 0.0);
+			} else if (ptr->type == SIGNAL_TYPE_BUFFER) {
+				getFilePreview(*ptr, data.data());
+			} else {
+				double phase = getPreviewPhase(
+				                       ptr->type == SIGNAL_TYPE_WAVEFORM ?
+				                       ptr->frequency : 0);
+
+				getSynth(*ptr, sample_rate, phase).generate(
+				        data.data(), nb_points);
+			}
+
+			points.push_back(data.data());
+		}
+
+		plot->plotNewData(time_block_data->time_block->name(),
+		                  points, nb_points, 0);
+	} else {
+		gr::top_block_sptr top = make_top_block("Signal Generator Update");
+		unsigned int i = 0;
+
+		for (auto it = channels.begin(); it != channels.end(); ++it) {
+			basic_block_sptr source;
+
+			if ((*it)->enableButton()->isChecked()) {
+				source = getSource((*it), sample_rate, top, true);
+			} else {
+				source = blocks::nop::make(sizeof(float));
+			}
+
+			auto head = blocks::head::make(sizeof(float), nb_points);
+			top->connect(source, 0, head, 0);
+
+			top->connect(head, 0, time_block_data->time_block, i++);
+		}
+
+		top->run();
+		top->disconnect_all();
+	}
+
+	qDebug() << "Preview updated in" << timer.elapsed() << "milliseconds";
 
 	if (ui->run_button->isChecked()) {
 		if (enabled) {
@@ -529,12 +620,32 @@ void SignalGenerator::loadFile()
 {
 	auto ptr = getCurrentData();
 
-	ptr->file = QFileDialog::getOpenFileName(this, tr("Open File"));
+	ptr->file = QFileDialog::getOpenFileName(this, tr("Open File"),
+	                QString(), tr("All files (*);;"
+	                              "Float32 samples (*.bin *.raw *.f32);;"
+	                              "Int16 samples (*.s16 *.i16);;"
+	                              "CSV files (*.csv *.txt);;"
+	                              "WAV files (*.wav)"));
+	ptr->file_data.reset();
 	this->ui->label_path->setText(ptr->file);
 
-	auto info = QFileInfo(ptr->file);
-	this->ui->label_size->setText(QString("%1 ").arg(
-	                                      info.size() / sizeof(float)) + tr("samples"));
+	if (!ptr->file.isEmpty()) {
+		auto file = std::make_shared<AwgFile>();
+
+		if (file->open(ptr->file)) {
+			// Files without a sample rate play at the rate of the DAC
+			if (file->sampleRate() <= 0) {
+				file->setSampleRate(max_sample_rate);
+			}
+
+			ptr->file_data = file;
+		} else {
+			qDebug() << "Unable to load" << ptr->file << ":"
+			         << file->errorString();
+		}
+	}
+
+	updateFileSize(*ptr);
 
 	resetZoom();
 }
@@ -544,7 +655,7 @@ void SignalGenerator::start()
 	QVector<struct iio_channel *> enabled_channels;
 
 	/* Avoid from being started twice */
-	if (buffers.size() > 0) {
+	if (buffers.size() > 0 || !streams.empty()) {
 		return;
 	}
 
@@ -557,7 +668,7 @@ void SignalGenerator::start()
 		enabled_channels.append(static_cast<struct iio_channel *>(ptr));
 	}
 
-	do {
+	while (!enabled_channels.empty()) {
 		const struct iio_device *dev =
 		        iio_channel_get_device(enabled_channels[0]);
 
@@ -575,11 +686,30 @@ void SignalGenerator::start()
 			}
 		}
 
+		/* In streaming mode, a waveform alone on its device is played
+		 * as a stream instead of a cyclic buffer */
+		if (streaming) {
+			QVector<struct iio_channel *> dev_channels;
+
+			for (auto each : enabled_channels) {
+				if (dev == iio_channel_get_device(each)) {
+					dev_channels.append(each);
+				}
+			}
+
+			if (dev_channels.size() == 1 &&
+			    start_stream(dev_channels[0])) {
+				enabled_channels.removeOne(dev_channels[0]);
+				continue;
+			}
+		}
+
 		/* Enable the (optional) DMA sync */
-		iio_device_attr_write_bool(dev, "dma_sync", true);
+		IioAttrCache::write(dev, "dma_sync", true);
 
-		unsigned long best_rate = get_best_sample_rate(dev);
-		size_t samples_count = get_samples_count(dev, best_rate);
+		size_t samples_count;
+		unsigned long best_rate = get_best_sample_rate(dev,
+		                          &samples_count);
 
 		/* Create the IIO buffer */
 		struct iio_buffer *buf = iio_device_create_buffer(
@@ -607,39 +737,81 @@ void SignalGenerator::start()
 
 			enabled_channels.remove(enabled_channels.indexOf(each));
 
-			top_block = gr::make_top_block("Signal Generator");
-
 			void *ptr = iio_channel_get_data(each);
 			QWidget *w = static_cast<QWidget *>(ptr);
-			auto source = getSource(w, best_rate, top_block);
 
-			float volts_to_raw_coef;
-			double vlsb = 1;
-			double corr = 1; // interpolation correction
-			auto pair_it = std::find_if(channel_dac.begin(),
-			                            channel_dac.end(),
-			                            [&each](const QPair<struct iio_channel *,
-			std::shared_ptr<GenericDac>>& element) {
-				return element.first == each;
+			float volts_to_raw_coef = get_volts_to_raw_coef(each,
+			                          final_rate);
+
+			auto signal_data = getData(w);
+			bool periodic = signal_data->type == SIGNAL_TYPE_WAVEFORM ||
+			                signal_data->type == SIGNAL_TYPE_MATH;
+			double frequency = signal_data->type == SIGNAL_TYPE_MATH ?
+			                   signal_data->math_freq : signal_data->frequency;
+			double played = get_played_frequency(frequency,
+			                                     best_rate, samples_count);
+
+			signal_data->frequency_error = 0.0;
+
+			if (periodic && frequency > 0) {
+				signal_data->frequency_error = played / frequency - 1.0;
+
+				qDebug() << QString("Channel %1 plays %2 Hz instead of %3 Hz (%4 ppm)")
+				         .arg(signal_data->id).arg(played, 0, 'f')
+				         .arg(frequency, 0, 'f')
+				         .arg(signal_data->frequency_error * 1e6);
 			}
-			                           );
 
-			if (pair_it != channel_dac.end()) {
-				std::shared_ptr<GenericDac> dac =(*pair_it).second;
-				vlsb = dac->vlsb();
-				auto m2k_dac = std::dynamic_pointer_cast<M2kDac>
-				               (dac);
+			int16_t *dst = static_cast<int16_t *>(
+			                       iio_buffer_first(buf, each));
+
+			// Periodic waveforms are written straight into the buffer
+			if (canSynthesize(*signal_data)) {
+				/* Synthesize the frequency which fits the buffer,
+				 * so that the waveform loops without a glitch */
+				struct signal_generator_data data = *signal_data;
+
+				if (data.type == SIGNAL_TYPE_WAVEFORM) {
+					data.frequency = played;
+				} else if (data.type == SIGNAL_TYPE_MATH) {
+					data.math_freq = played;
+				}
+
+				getSynth(data, best_rate).generate(dst,
+				                samples_count, iio_buffer_step(buf),
+				                volts_to_raw_coef);
+				continue;
+			}
 
-				if (m2k_dac) {
-					corr = m2k_dac->compTable(final_rate);
+			// Files are converted from their mapping, a block at a time
+			if (signal_data->type == SIGNAL_TYPE_BUFFER) {
+				if (signal_data->file_data) {
+					signal_data->file_data->read(dst, 0,
+					                samples_count, iio_buffer_step(buf),
+					                volts_to_raw_coef, best_rate);
+				} else {
+					WaveformSynth(WaveformSynth::CONSTANT, 0, 0,
+					              0, 0, best_rate).generate(dst,
+					                samples_count, iio_buffer_step(buf),
+					                volts_to_raw_coef);
 				}
+
+				continue;
 			}
 
-			// DAC_RAW = (-Vout / (voltage corresponding to a LSB));
-			// Multiplying with 16 because the HDL considers the DAC data as 16 bit
-			// instead of 12 bit(data is shifted to the left)
-			// Divide by corr when interpolation is used
-			volts_to_raw_coef = (-1 * (1 / vlsb) * 16) / corr;
+			top_block = gr::make_top_block("Signal Generator");
+
+			/* Math functions are generated at the played frequency
+			 * too; the user's value is kept for the UI */
+			double math_freq = signal_data->math_freq;
+
+			if (signal_data->type == SIGNAL_TYPE_MATH && played > 0) {
+				signal_data->math_freq = played;
+			}
+
+			auto source = getSource(w, best_rate, top_block);
+
+			signal_data->math_freq = math_freq;
 
 			auto f2s = blocks::float_to_short::make(1,
 			                                        volts_to_raw_coef);
@@ -663,31 +835,36 @@ void SignalGenerator::start()
 		}
 
 		if (iio_device_find_attr(dev, "oversampling_ratio")) {
-			iio_device_attr_write_longlong(dev,
-			                               "oversampling_ratio", oversampling);
+			IioAttrCache::write(dev, "oversampling_ratio",
+			                    (long long)oversampling);
 		}
 
-		iio_device_attr_write_longlong(dev, "sampling_frequency",
-		                               final_rate);
+		IioAttrCache::write(dev, "sampling_frequency",
+		                    (long long)final_rate);
 
 		qDebug() << "Pushed cyclic buffer";
 
 		iio_buffer_push_partial(buf, samples_count);
 		buffers.append(buf);
-
-	} while (!enabled_channels.empty());
+	}
 
 	/* Now that we pushed all the buffers, disable the (optional) DMA sync
 	 * for the devices that support it. */
 	for (auto buf : buffers) {
 		const struct iio_device *dev = iio_buffer_get_device(buf);
 
-		iio_device_attr_write_bool(dev, "dma_sync", false);
+		IioAttrCache::write(dev, "dma_sync", false);
 	}
 }
 
 void SignalGenerator::stop()
 {
+	for (auto& stream : streams) {
+		stream->stop();
+	}
+
+	streams.clear();
+
 	for (auto each : buffers) {
 		iio_buffer_destroy(each);
 	}
@@ -706,8 +883,8 @@ void SignalGenerator::startStop(bool pressed)
 
 	if (amp1 && amp2) {
 		/* FIXME: TODO: Move this into a HW class / lib M2k */
-		iio_channel_attr_write_bool(amp1, "powerdown", !pressed);
-		iio_channel_attr_write_bool(amp2, "powerdown", !pressed);
+		IioAttrCache::write(amp1, "powerdown", !pressed);
+		IioAttrCache::write(amp2, "powerdown", !pressed);
 	}
 
 	setDynamicProperty(ui->run_button, "running", pressed);
@@ -781,6 +958,207 @@ basic_block_sptr SignalGenerator::getSignalSource(gr::top_block_sptr top,
 	}
 }
 
+bool SignalGenerator::canSynthesize(const struct signal_generator_data& data)
+{
+	return data.type == SIGNAL_TYPE_CONSTANT ||
+	       data.type == SIGNAL_TYPE_WAVEFORM;
+}
+
+WaveformSynth::Shape SignalGenerator::get_synth_shape(enum sg_waveform waveform)
+{
+	switch (waveform) {
+	case SG_SQR_WAVE:
+		return WaveformSynth::SQUARE;
+
+	case SG_TRI_WAVE:
+		return WaveformSynth::TRIANGLE;
+
+	case SG_SAW_WAVE:
+		return WaveformSynth::SAWTOOTH;
+
+	case SG_INV_SAW_WAVE:
+		return WaveformSynth::INV_SAWTOOTH;
+
+	case SG_SIN_WAVE:
+	default:
+		return WaveformSynth::SINE;
+	}
+}
+
+WaveformSynth SignalGenerator::getSynth(const struct signal_generator_data& data,
+                                        unsigned long samp_rate, double phase_correction)
+{
+	if (data.type == SIGNAL_TYPE_CONSTANT) {
+		return WaveformSynth(WaveformSynth::CONSTANT, 0, data.constant,
+		                     0, 0, samp_rate);
+	}
+
+	return WaveformSynth(get_synth_shape(data.waveform), data.amplitude,
+	                     data.offset, data.frequency,
+	                     data.phase + phase_correction, samp_rate);
+}
+
+bool SignalGenerator::canStream(const struct signal_generator_data& data)
+{
+	return data.type == SIGNAL_TYPE_WAVEFORM;
+}
+
+SignalGeneratorStream::Settings SignalGenerator::get_stream_settings(
+        const struct signal_generator_data& data)
+{
+	SignalGeneratorStream::Settings settings;
+
+	settings.shape = get_synth_shape(data.waveform);
+	settings.amplitude = data.amplitude;
+	settings.offset = data.offset;
+	settings.phase = data.phase;
+	settings.startFrequency = data.frequency;
+	settings.stopFrequency = data.sweep_stop_freq;
+	settings.sweepTime = data.sweep_time;
+	settings.logSweep = data.sweep_log;
+	settings.amDepth = data.am_depth;
+	settings.amFrequency = data.am_freq;
+	settings.fmDeviation = data.fm_deviation;
+	settings.fmFrequency = data.fm_freq;
+	settings.noise = data.noise;
+
+	return settings;
+}
+
+bool SignalGenerator::start_stream(struct iio_channel *chn)
+{
+	QWidget *w = static_cast<QWidget *>(iio_channel_get_data(chn));
+	auto signal_data = getData(w);
+
+	if (!canStream(*signal_data)) {
+		return false;
+	}
+
+	const struct iio_device *dev = iio_channel_get_device(chn);
+	SignalGeneratorStream::Settings settings =
+	        get_stream_settings(*signal_data);
+	double min_rate = stream_oversampling *
+	                  SignalGeneratorStream::getMaxFrequency(settings);
+
+	/* The rates are sorted from the highest to the lowest */
+	QVector<unsigned long> rates = get_available_sample_rates(dev);
+	unsigned long rate = rates.empty() ? 0 : rates.first();
+
+	for (auto each : rates) {
+		if (each >= min_rate) {
+			rate = each;
+		}
+	}
+
+	if (!rate) {
+		return false;
+	}
+
+	unsigned long final_rate;
+	unsigned long oversampling;
+
+	calc_sampling_params(dev, rate, final_rate, oversampling);
+
+	if (iio_device_find_attr(dev, "oversampling_ratio")) {
+		IioAttrCache::write(dev, "oversampling_ratio",
+		                    (long long)oversampling);
+	}
+
+	IioAttrCache::write(dev, "sampling_frequency", (long long)final_rate);
+
+	/* The stream starts on its own, it is not synced with the
+	 * cyclic buffers */
+	IioAttrCache::write(dev, "dma_sync", false);
+
+	std::unique_ptr<SignalGeneratorStream> stream(new SignalGeneratorStream);
+	stream->prepare(settings, rate, get_volts_to_raw_coef(chn, final_rate));
+
+	if (!stream->start(dev)) {
+		return false;
+	}
+
+	qDebug() << QString("Streaming channel %1 at %2 SPS")
+	         .arg(signal_data->id).arg(rate);
+
+	signal_data->frequency_error = 0.0;
+	streams.push_back(std::move(stream));
+
+	return true;
+}
+
+float SignalGenerator::get_volts_to_raw_coef(struct iio_channel *chn,
+                unsigned long final_rate) const
+{
+	double vlsb = 1;
+	double corr = 1; // interpolation correction
+	auto pair_it = std::find_if(channel_dac.begin(),
+	                            channel_dac.end(),
+	                            [&chn](const QPair<struct iio_channel *,
+	std::shared_ptr<GenericDac>>& element) {
+		return element.first == chn;
+	}
+	                           );
+
+	if (pair_it != channel_dac.end()) {
+		std::shared_ptr<GenericDac> dac =(*pair_it).second;
+		vlsb = dac->vlsb();
+		auto m2k_dac = std::dynamic_pointer_cast<M2kDac>
+		               (dac);
+
+		if (m2k_dac) {
+			corr = m2k_dac->compTable(final_rate);
+		}
+	}
+
+	// DAC_RAW = (-Vout / (voltage corresponding to a LSB));
+	// Multiplying with 16 because the HDL considers the DAC data as 16 bit
+	// instead of 12 bit(data is shifted to the left)
+	// Divide by corr when interpolation is used
+	return (-1 * (1 / vlsb) * 16) / corr;
+}
+
+void SignalGenerator::getFilePreview(const struct signal_generator_data& data,
+                                     double *dst) const
+{
+	if (!data.file_data) {
+		std::fill(dst, dst + nb_points, 0.0);
+		return;
+	}
+
+	/* The preview rate is usually much lower than the one of the file,
+	 * so this picks a strided view of the visible part; the playback
+	 * alone pays for the anti-alias filter */
+	uint64_t first = zoomT1OnScreen > 0 ?
+	                 (uint64_t)(zoomT1OnScreen * sample_rate) : 0;
+
+	data.file_data->preview(dst, first, nb_points, sample_rate);
+}
+
+void SignalGenerator::updateFileSize(const struct signal_generator_data& data)
+{
+	if (data.file_data) {
+		ui->label_size->setText(QString("%1 ").arg(
+		                                data.file_data->sampleCount())
+		                        + tr("samples"));
+	} else if (!data.file.isEmpty()) {
+		ui->label_size->setText(tr("Unsupported file"));
+	} else {
+		ui->label_size->setText("");
+	}
+}
+
+double SignalGenerator::getPreviewPhase(double frequency) const
+{
+	if (frequency == 0) {
+		return 0;
+	}
+
+	int full_periods=(int)((double)zoomT1OnScreen*frequency);
+	double phase_in_time = zoomT1OnScreen - full_periods/frequency;
+
+	return (phase_in_time*frequency) * 360.0;
+}
+
 gr::basic_block_sptr SignalGenerator::getSource(QWidget *obj,
                 unsigned long samp_rate, gr::top_block_sptr top, bool preview)
 {
@@ -796,19 +1174,19 @@ gr::basic_block_sptr SignalGenerator::getSource(QWidget *obj,
 
 	case SIGNAL_TYPE_WAVEFORM:
 		if (preview) {
-			int full_periods=(int)((double)zoomT1OnScreen*ptr->frequency);
-			double phase_in_time = zoomT1OnScreen - full_periods/ptr->frequency;
-			phase = (phase_in_time*ptr->frequency) * 360.0;
+			phase = getPreviewPhase(ptr->frequency);
 		}
 
 		return getSignalSource(top, samp_rate, *ptr, phase);
 
 	case SIGNAL_TYPE_BUFFER:
-		if (!ptr->file.isNull()) {
-			auto str = ptr->file.toStdString();
+		if (ptr->file_data && preview) {
+			std::vector<double> samples(nb_points);
 
-			return blocks::file_source::make(
-			               sizeof(float), str.c_str(), true);
+			getFilePreview(*ptr, samples.data());
+
+			return blocks::vector_source_f::make(std::vector<float>(
+			                samples.begin(), samples.end()), true);
 		}
 
 		break;
@@ -818,9 +1196,7 @@ gr::basic_block_sptr SignalGenerator::getSource(QWidget *obj,
 			auto str = ptr->function.toStdString();
 
 			if (preview) {
-				int full_periods=(int)((double)zoomT1OnScreen*ptr->math_freq);
-				double phase_in_time = zoomT1OnScreen - full_periods/ptr->math_freq;
-				phase = (phase_in_time*ptr->math_freq) * 360.0;
+				phase = getPreviewPhase(ptr->math_freq);
 				auto src = iio::iio_math_gen::make(samp_rate,
 				                                   ptr->math_freq, str);
 
@@ -934,14 +1310,7 @@ void SignalGenerator::updateRightMenuForChn(int chIdx)
 	ui->mathWidget->setFunction(ptr->function);
 	ui->mathFrequency->setValue(ptr->math_freq);
 
-	if (!ptr->file.isNull()) {
-		auto info = QFileInfo(ptr->file);
-		ui->label_size->setText(QString("%1 ").arg(
-		                                info.size() / sizeof(float))
-		                        + tr("samples"));
-	} else {
-		ui->label_size->setText("");
-	}
+	updateFileSize(*ptr);
 
 	ui->type->setCurrentIndex(sg_waveform_to_idx(ptr->waveform));
 
@@ -1013,8 +1382,8 @@ QVector<unsigned long> SignalGenerator::get_available_sample_rates(
 	char buf[1024];
 	int ret;
 
-	ret = iio_device_attr_read(dev, "sampling_frequency_available",
-	                           buf, sizeof(buf));
+	ret = IioAttrCache::read(dev, "sampling_frequency_available",
+	                         buf, sizeof(buf));
 
 	if (ret > 0) {
 		QStringList list = QString::fromUtf8(buf).split(' ');
@@ -1025,8 +1394,8 @@ QVector<unsigned long> SignalGenerator::get_available_sample_rates(
 	}
 
 	if (values.empty()) {
-		ret = iio_device_attr_read(dev, "sampling_frequency",
-		                           buf, sizeof(buf));
+		ret = IioAttrCache::read(dev, "sampling_frequency",
+		                         buf, sizeof(buf));
 
 		if (!ret) {
 			values.append(QString::fromUtf8(buf).toULong());
@@ -1039,7 +1408,7 @@ QVector<unsigned long> SignalGenerator::get_available_sample_rates(
 }
 
 unsigned long SignalGenerator::get_best_sample_rate(
-        const struct iio_device *dev)
+        const struct iio_device *dev, size_t *samples_count)
 {
 	QVector<unsigned long> values = get_available_sample_rates(dev);
 
@@ -1054,28 +1423,66 @@ unsigned long SignalGenerator::get_best_sample_rate(
 		size_t buf_size = get_samples_count(dev, rate, true);
 
 		if (buf_size) {
+			if (samples_count) {
+				*samples_count = buf_size;
+			}
+
 			return rate;
 		}
 
 		qDebug() << QString("Rate %1 not ideal").arg(rate);
 	}
 
-	/* If we can't find a perfect sample rate, use the highest one */
+	/* If we can't find a perfect sample rate, use the one which gives
+	 * the lowest frequency error; among the ones within the first
+	 * tolerance, the one which needs the smallest buffer */
 	if (use_oversampling(dev)) {
 		qSort(values.begin(), values.end(), qGreater<unsigned long>());
 	}
 
+	unsigned long best_rate = 0;
+	size_t best_size = 0;
+	double best_error = 0.0;
+
 	for (unsigned long rate : values) {
-		size_t buf_size = get_samples_count(dev, rate);
+		double error;
+		size_t buf_size = get_samples_count(dev, rate, false, &error);
 
-		if (buf_size) {
-			return rate;
+		if (!buf_size) {
+			qDebug() << QString("Rate %1 not possible").arg(rate);
+			continue;
 		}
 
-		qDebug() << QString("Rate %1 not possible").arg(rate);
+		bool better;
+
+		if (!best_size) {
+			better = true;
+		} else if (error <= frequency_tolerances[0]) {
+			better = best_error > frequency_tolerances[0] ||
+			         buf_size < best_size;
+		} else {
+			better = error < best_error;
+		}
+
+		if (better) {
+			best_rate = rate;
+			best_size = buf_size;
+			best_error = error;
+		}
+	}
+
+	if (!best_size) {
+		throw std::runtime_error("Unable to calculate best sample rate");
 	}
 
-	throw std::runtime_error("Unable to calculate best sample rate");
+	qDebug() << QString("Rate %1 with %2 samples, frequency error %3 ppm")
+	         .arg(best_rate).arg(best_size).arg(best_error * 1e6);
+
+	if (samples_count) {
+		*samples_count = best_size;
+	}
+
+	return best_rate;
 }
 
 unsigned long SignalGenerator::get_max_sample_rate(const struct iio_device *dev)
@@ -1161,12 +1568,170 @@ double SignalGenerator::get_best_ratio(double ratio, double max, double *fract)
 	return best_ratio;
 }
 
+bool SignalGenerator::get_best_fraction(double value, double tolerance,
+                size_t max_denominator, size_t& num, size_t& denom)
+{
+	double lo = value * (1.0 - tolerance);
+	double hi = value * (1.0 + tolerance);
+
+	/* Convergents of the continued fraction shared by both ends of the
+	 * interval; the first term on which they differ is rounded to the
+	 * smallest one which lands inside, which gives the fraction with
+	 * the smallest denominator in [lo, hi] */
+	size_t p0 = 1, p1 = 0;
+	size_t q0 = 0, q1 = 1;
+
+	if (value <= 0.0) {
+		return false;
+	}
+
+	for (;;) {
+		double term = std::floor(lo);
+		bool last = true;
+
+		if (term != lo && term + 1.0 <= hi) {
+			term += 1.0;
+		} else if (term != lo) {
+			last = false;
+		}
+
+		if (term > (double) max_denominator) {
+			return false;
+		}
+
+		size_t a = (size_t) term;
+		size_t p = a * p0 + p1;
+		size_t q = a * q0 + q1;
+
+		if (q > max_denominator) {
+			return false;
+		}
+
+		if (last) {
+			num = p;
+			denom = q;
+			return true;
+		}
+
+		p1 = p0;
+		q1 = q0;
+		p0 = p;
+		q0 = q;
+
+		double new_lo = 1.0 / (hi - term);
+		hi = 1.0 / (lo - term);
+		lo = new_lo;
+	}
+}
+
+size_t SignalGenerator::get_periodic_samples_count(
+        const std::vector<double>& ratios, size_t base, size_t max_size,
+        double tolerance, double *error)
+{
+	const size_t step = lcm(base, 4);
+	size_t size = step;
+	size_t lower = size;
+
+	/* Smallest number of samples that hold a whole number of periods
+	 * of each signal on its own, within the tolerance. The fraction is
+	 * searched in blocks of @step samples, so that the sizes it gives
+	 * are already aligned. */
+	for (double ratio : ratios) {
+		size_t periods, blocks;
+
+		if (!get_best_fraction(step / ratio, tolerance,
+		                       max_size / step, periods, blocks)) {
+			return 0;
+		}
+
+		size_t samples = blocks * step;
+
+		size = lcm(size, samples);
+		lower = std::max(lower, samples);
+
+		if (size > max_size) {
+			size = 0;
+		}
+
+		if (!size) {
+			break;
+		}
+	}
+
+	if (size && size < min_buffer_size) {
+		size *= (min_buffer_size + size - 1) / size;
+	}
+
+	/* Buffer sizes below the LCM can still fit all the signals at once
+	 * when they don't need to be exact */
+	lower = std::max(lower, (size_t) min_buffer_size);
+	lower = (lower + step - 1) / step * step;
+
+	size_t limit = size ? size : max_size;
+	size_t steps = 0;
+
+	for (size_t n = lower; n < limit && steps < max_solver_steps;
+	     n += step, steps++) {
+		double worst = 0.0;
+
+		for (double ratio : ratios) {
+			double periods = std::round(n / ratio);
+
+			if (periods < 1.0) {
+				worst = HUGE_VAL;
+				break;
+			}
+
+			worst = std::max(worst,
+			                 std::fabs(periods * ratio / n - 1.0));
+		}
+
+		if (worst <= tolerance) {
+			size = n;
+			break;
+		}
+	}
+
+	if (!size || size > max_size) {
+		return 0;
+	}
+
+	if (error) {
+		double worst = 0.0;
+
+		for (double ratio : ratios) {
+			double periods = std::round(size / ratio);
+
+			worst = std::max(worst,
+			                 std::fabs(periods * ratio / size - 1.0));
+		}
+
+		*error = worst;
+	}
+
+	return size;
+}
+
+double SignalGenerator::get_played_frequency(double frequency,
+                unsigned long rate, size_t samples_count)
+{
+	if (frequency <= 0.0 || !samples_count) {
+		return frequency;
+	}
+
+	double periods = std::max(1.0, std::round(samples_count * frequency /
+	                          rate));
+
+	return periods * rate / samples_count;
+}
+
 size_t SignalGenerator::get_samples_count(const struct iio_device *dev,
-                unsigned long rate, bool perfect)
+                unsigned long rate, bool perfect, double *error)
 {
 	size_t max_buffer_size = 4 * 1024 * 1024 /
 	                         (size_t) iio_device_get_sample_size(dev);
 	size_t size = 1;
+	std::vector<double> ratios;
 
 	for (unsigned int i = 0; i < iio_device_get_channels_count(dev); i++) {
 		struct iio_channel *chn = iio_device_get_channel(dev, i);
@@ -1177,7 +1742,7 @@ size_t SignalGenerator::get_samples_count(const struct iio_device *dev,
 
 		QWidget *w = static_cast<QWidget *>(iio_channel_get_data(chn));
 		auto ptr = getData(w);
-		double ratio, fract;
+		double ratio;
 
 		switch (ptr->type) {
 		case SIGNAL_TYPE_WAVEFORM:
@@ -1205,31 +1770,84 @@ size_t SignalGenerator::get_samples_count(const struct iio_device *dev,
 				return 0;
 			}
 
-			ratio = get_best_ratio(ratio,
-			                       (double)(max_buffer_size / 4), &fract);
+			ratios.push_back(ratio);
+			break;
+
+		case SIGNAL_TYPE_BUFFER: {
+			if (!ptr->file_data) {
+				break;
+			}
+
+			/* Perfect rates play the whole file without dropping
+			 * any of its samples */
+			if (perfect && rate < ptr->file_data->sampleRate()) {
+				return 0;
+			}
+
+			size_t count = ptr->file_data->outputCount(rate);
+			size_t total = lcm(size, count);
 
-			if (perfect && fract != 0.0) {
+			if (count <= max_buffer_size && total <= max_buffer_size) {
+				size = total;
+			} else if (perfect) {
 				return 0;
+			} else {
+				/* Play as much of the file as fits */
+				count = std::min(count, max_buffer_size);
+				size = std::max(size, (count + 3) & ~(size_t)3);
 			}
 
-			size = lcm(size, (size_t) ratio);
 			break;
+		}
 
 		case SIGNAL_TYPE_CONSTANT:
-		case SIGNAL_TYPE_BUFFER:
 		default:
 			break;
 		}
 	}
 
-	/* The buffer size must be a multiple of 4 */
-	while (size & 0x3) {
-		size <<= 1;
+	if (error) {
+		*error = 0.0;
+	}
+
+	/* Pick the buffer size for all the periodic signals at once, the
+	 * smallest one within the tightest tolerance that can be met */
+	if (!ratios.empty()) {
+		size_t exact = get_periodic_samples_count(ratios, size,
+		                max_buffer_size, exact_tolerance, error);
+
+		if (perfect) {
+			return exact;
+		}
+
+		/* An exact size is also within any tolerance */
+		for (double tolerance : frequency_tolerances) {
+			double approx_error;
+			size_t count = get_periodic_samples_count(ratios, size,
+			                max_buffer_size, tolerance, &approx_error);
+
+			if (exact && (!count || exact <= count)) {
+				return exact;
+			}
+
+			if (count) {
+				if (error) {
+					*error = approx_error;
+				}
+
+				return count;
+			}
+		}
+
+		return exact;
 	}
 
+	/* The buffer size must be a multiple of 4 */
+	size = lcm(size, 4);
+
 	/* The buffer size shouldn't be too small */
-	while (size < min_buffer_size) {
-		size <<= 1;
+	if (size < min_buffer_size) {
+		size *= (min_buffer_size + size - 1) / size;
 	}
 
 	if (size > max_buffer_size) {
@@ -1513,3 +2131,255 @@ void SignalGenerator_API::setMathFunction(const QList<QString>& list)
 		        gen->getCurrentData()->function);
 	}
 }
+
+QList<double> SignalGenerator_API::getFrequencyError() const
+{
+	QList<double> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->frequency_error);
+	}
+
+	return list;
+}
+
+bool SignalGenerator_API::streaming() const
+{
+	return gen->streaming;
+}
+
+void SignalGenerator_API::setStreaming(bool en)
+{
+	if (gen->streaming == en) {
+		return;
+	}
+
+	gen->streaming = en;
+
+	// Play the channels again in the new mode
+	if (gen->ui->run_button->isChecked()) {
+		gen->stop();
+		gen->start();
+	}
+}
+
+QList<double> SignalGenerator_API::getSweepStopFreq() const
+{
+	QList<double> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->sweep_stop_freq);
+	}
+
+	return list;
+}
+
+void SignalGenerator_API::setSweepStopFreq(const QList<double>& list)
+{
+	if (list.size() != gen->channels.size()) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		ptr->sweep_stop_freq = list.at(i);
+	}
+}
+
+QList<double> SignalGenerator_API::getSweepTime() const
+{
+	QList<double> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->sweep_time);
+	}
+
+	return list;
+}
+
+void SignalGenerator_API::setSweepTime(const QList<double>& list)
+{
+	if (list.size() != gen->channels.size()) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		ptr->sweep_time = list.at(i);
+	}
+}
+
+QList<bool> SignalGenerator_API::getSweepLog() const
+{
+	QList<bool> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->sweep_log);
+	}
+
+	return list;
+}
+
+void SignalGenerator_API::setSweepLog(const QList<bool>& list)
+{
+	if (list.size() != gen->channels.size()) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		ptr->sweep_log = list.at(i);
+	}
+}
+
+QList<double> SignalGenerator_API::getAmDepth() const
+{
+	QList<double> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->am_depth);
+	}
+
+	return list;
+}
+
+void SignalGenerator_API::setAmDepth(const QList<double>& list)
+{
+	if (list.size() != gen->channels.size()) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		ptr->am_depth = list.at(i);
+	}
+}
+
+QList<double> SignalGenerator_API::getAmFreq() const
+{
+	QList<double> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->am_freq);
+	}
+
+	return list;
+}
+
+void SignalGenerator_API::setAmFreq(const QList<double>& list)
+{
+	if (list.size() != gen->channels.size()) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		ptr->am_freq = list.at(i);
+	}
+}
+
+QList<double> SignalGenerator_API::getFmDeviation() const
+{
+	QList<double> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->fm_deviation);
+	}
+
+	return list;
+}
+
+void SignalGenerator_API::setFmDeviation(const QList<double>& list)
+{
+	if (list.size() != gen->channels.size()) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		ptr->fm_deviation = list.at(i);
+	}
+}
+
+QList<double> SignalGenerator_API::getFmFreq() const
+{
+	QList<double> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->fm_freq);
+	}
+
+	return list;
+}
+
+void SignalGenerator_API::setFmFreq(const QList<double>& list)
+{
+	if (list.size() != gen->channels.size()) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		ptr->fm_freq = list.at(i);
+	}
+}
+
+QList<double> SignalGenerator_API::getNoiseAmpl() const
+{
+	QList<double> list;
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		list.append(ptr->noise);
+	}
+
+	return list;
+}
+
+void SignalGenerator_API::setNoiseAmpl(const QList<double>& list)
+{
+	if (list.size() != gen->channels.size()) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < gen->channels.size(); i++) {
+		auto ptr = gen->getData(gen->channels[i]);
+
+		ptr->noise = list.at(i);
+	}
+}
+
+int SignalGenerator_API::underruns() const
+{
+	uint64_t count = 0;
+
+	for (const auto& stream : gen->streams) {
+		count += stream->getUnderruns();
+	}
+
+	return count;
+}
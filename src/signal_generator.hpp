@@ -20,6 +20,8 @@
 #ifndef M2K_SIGNAL_GENERATOR_H
 #define M2K_SIGNAL_GENERATOR_H
 
+#include <memory>
+
 #include <gnuradio/analog/sig_source_waveform.h>
 #include <gnuradio/top_block.h>
 
@@ -36,6 +38,8 @@
 #include "scope_sink_f.h"
 #include "tool.hpp"
 #include "hw_dac.h"
+#include "waveform_synth.hpp"
+#include "sg_stream.hpp"
 
 extern "C" {
 	struct iio_buffer;
@@ -107,7 +111,10 @@ namespace adiscope {
 		QQueue<QPair<int, bool>> menuButtonActions;
 
 		QVector<struct iio_buffer *> buffers;
+		bool streaming;
+		std::vector<std::unique_ptr<SignalGeneratorStream>> streams;
 		QVector<ChannelWidget *> channels;
+		std::vector<std::vector<double>> preview_data;
 		QVector<QPair<struct iio_channel *,
 			std::shared_ptr<adiscope::GenericDac>>> channel_dac;
 
@@ -133,14 +140,45 @@ namespace adiscope {
 				unsigned long sample_rate,
 				gr::top_block_sptr top, bool     phase_correction=false);
 
+		static bool canSynthesize(
+				const struct signal_generator_data &data);
+		static WaveformSynth::Shape get_synth_shape(
+				enum sg_waveform waveform);
+		static WaveformSynth getSynth(
+				const struct signal_generator_data &data,
+				unsigned long sample_rate,
+				double phase_correction=0.0);
+		double getPreviewPhase(double frequency) const;
+		void getFilePreview(const struct signal_generator_data &data,
+				double *dst) const;
+		void updateFileSize(const struct signal_generator_data &data);
+
+		static bool canStream(const struct signal_generator_data &data);
+		static SignalGeneratorStream::Settings get_stream_settings(
+				const struct signal_generator_data &data);
+		bool start_stream(struct iio_channel *chn);
+		float get_volts_to_raw_coef(struct iio_channel *chn,
+				unsigned long final_rate) const;
+
 		static size_t gcd(size_t a, size_t b);
 		static size_t lcm(size_t a, size_t b);
 		static int sg_waveform_to_idx(enum sg_waveform wave);
 
+		static bool get_best_fraction(double value, double tolerance,
+				size_t max_denominator, size_t& num,
+				size_t& denom);
+		static size_t get_periodic_samples_count(
+				const std::vector<double>& ratios, size_t base,
+				size_t max_size, double tolerance, double *error);
+		static double get_played_frequency(double frequency,
+				unsigned long sample_rate, size_t samples_count);
+
 		size_t get_samples_count(const struct iio_device *dev,
-				unsigned long sample_rate, bool perfect = false);
+				unsigned long sample_rate, bool perfect = false,
+				double *error = nullptr);
 		unsigned long get_best_sample_rate(
-				const struct iio_device *dev);
+				const struct iio_device *dev,
+				size_t *samples_count = nullptr);
 		//int set_sample_rate(const struct iio_device *dev,
 		//		unsigned long sample_rate);
 		void calc_sampling_params(const struct iio_device *dev,
@@ -197,6 +235,27 @@ namespace adiscope {
 				READ getMathFreq WRITE setMathFreq);
 		Q_PROPERTY(QList<QString> math_function
 				READ getMathFunction WRITE setMathFunction);
+		Q_PROPERTY(QList<double> frequency_error
+				READ getFrequencyError STORED false);
+
+		Q_PROPERTY(bool streaming READ streaming WRITE setStreaming);
+		Q_PROPERTY(QList<double> sweep_stop_frequency
+				READ getSweepStopFreq WRITE setSweepStopFreq);
+		Q_PROPERTY(QList<double> sweep_time
+				READ getSweepTime WRITE setSweepTime);
+		Q_PROPERTY(QList<bool> sweep_log
+				READ getSweepLog WRITE setSweepLog);
+		Q_PROPERTY(QList<double> am_depth
+				READ getAmDepth WRITE setAmDepth);
+		Q_PROPERTY(QList<double> am_frequency
+				READ getAmFreq WRITE setAmFreq);
+		Q_PROPERTY(QList<double> fm_deviation
+				READ getFmDeviation WRITE setFmDeviation);
+		Q_PROPERTY(QList<double> fm_frequency
+				READ getFmFreq WRITE setFmFreq);
+		Q_PROPERTY(QList<double> noise_amplitude
+				READ getNoiseAmpl WRITE setNoiseAmpl);
+		Q_PROPERTY(int underruns READ underruns STORED false);
 
 	public:
 		bool running() const;
@@ -229,6 +288,37 @@ namespace adiscope {
 		QList<QString> getMathFunction() const;
 		void setMathFunction(const QList<QString>& list);
 
+		QList<double> getFrequencyError() const;
+
+		bool streaming() const;
+		void setStreaming(bool en);
+
+		QList<double> getSweepStopFreq() const;
+		void setSweepStopFreq(const QList<double>& list);
+
+		QList<double> getSweepTime() const;
+		void setSweepTime(const QList<double>& list);
+
+		QList<bool> getSweepLog() const;
+		void setSweepLog(const QList<bool>& list);
+
+		QList<double> getAmDepth() const;
+		void setAmDepth(const QList<double>& list);
+
+		QList<double> getAmFreq() const;
+		void setAmFreq(const QList<double>& list);
+
+		QList<double> getFmDeviation() const;
+		void setFmDeviation(const QList<double>& list);
+
+		QList<double> getFmFreq() const;
+		void setFmFreq(const QList<double>& list);
+
+		QList<double> getNoiseAmpl() const;
+		void setNoiseAmpl(const QList<double>& list);
+
+		int underruns() const;
+
 		explicit SignalGenerator_API(SignalGenerator *gen) :
 			ApiObject(), gen(gen) {}
 		~SignalGenerator_API() {}
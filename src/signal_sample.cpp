@@ -17,37 +17,152 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
+#include <limits>
+
 #include "signal_sample.hpp"
 
 using namespace adiscope;
 
-signal_sample::signal_sample() :
+signal_sample::signal_sample(double rate) :
 	gr::sync_block("signal_sample",
 			gr::io_signature::make(1, -1, sizeof(float)),
 			gr::io_signature::make(0, 0, 0)),
-	QObject()
+	QObject(),
+	d_rate(rate),
+	d_single_shot(false),
+	done(false),
+	back(0), front(1), middle(2)
 {
-	qRegisterMetaType<std::vector<float>>();
-	set_max_noutput_items(1);
+	acc.count = 0;
+
+	for (auto& slot : slots) {
+		slot.count = 0;
+	}
 }
 
 signal_sample::~signal_sample()
 {
 }
 
+void signal_sample::set_rate(double rate)
+{
+	d_rate = rate;
+}
+
+double signal_sample::rate() const
+{
+	return d_rate;
+}
+
+void signal_sample::set_single_shot(bool single_shot)
+{
+	d_single_shot = single_shot;
+}
+
+bool signal_sample::start()
+{
+	reset(acc.latest.size());
+	done = false;
+	last_publish = std::chrono::steady_clock::now();
+
+	return gr::sync_block::start();
+}
+
+void signal_sample::reset(size_t nb_inputs)
+{
+	acc.first.resize(nb_inputs);
+	acc.latest.resize(nb_inputs);
+	acc.mean.resize(nb_inputs);
+	acc.min.assign(nb_inputs, std::numeric_limits<float>::max());
+	acc.max.assign(nb_inputs, std::numeric_limits<float>::lowest());
+	sum.assign(nb_inputs, 0.0);
+	acc.count = 0;
+}
+
 int signal_sample::work(int noutput_items,
 		gr_vector_const_void_star &input_items,
 		gr_vector_void_star &output_items)
 {
-	std::vector<float> values;
+	const size_t nb_inputs = input_items.size();
 
-	for (unsigned int i = 0; i < input_items.size(); i++) {
-		const float *vect = (const float *) input_items[i];
-		values.push_back(*vect);
+	if (done)
+		return noutput_items;
+
+	if (acc.latest.size() != nb_inputs) {
+		reset(nb_inputs);
 	}
 
-	Q_EMIT triggered(values);
+	for (size_t i = 0; i < nb_inputs; i++) {
+		const float *src = (const float *) input_items[i];
+		float min = acc.min[i], max = acc.max[i];
+		double total = 0.0;
+
+		for (int j = 0; j < noutput_items; j++) {
+			min = std::min(min, src[j]);
+			max = std::max(max, src[j]);
+			total += src[j];
+		}
+
+		if (acc.count == 0)
+			acc.first[i] = src[0];
+		acc.latest[i] = src[noutput_items - 1];
+		acc.min[i] = min;
+		acc.max[i] = max;
+		sum[i] += total;
+	}
+
+	acc.count += noutput_items;
+
+	auto now = std::chrono::steady_clock::now();
+	double rate = d_rate;
+
+	if (d_single_shot) {
+		done = true;
+		publish();
+	} else if (rate <= 0.0 || std::chrono::duration<double>(
+				now - last_publish).count() * rate >= 1.0) {
+		last_publish = now;
+		publish();
+	}
+
+	return noutput_items;
+}
+
+void signal_sample::publish()
+{
+	signal_sample_values& dst = slots[back];
+
+	for (size_t i = 0; i < sum.size(); i++) {
+		acc.mean[i] = sum[i] / acc.count;
+	}
+
+	dst.first = acc.first;
+	dst.latest = acc.latest;
+	dst.mean = acc.mean;
+	dst.min = acc.min;
+	dst.max = acc.max;
+	dst.count = acc.count;
+
+	unsigned int prev = middle.exchange(back | fresh,
+			std::memory_order_acq_rel);
+	back = prev & ~fresh;
+
+	reset(sum.size());
+
+	// The consumer took the previous values, let it know again
+	if (!(prev & fresh))
+		Q_EMIT ready();
+}
+
+bool signal_sample::fetch(signal_sample_values& values)
+{
+	if (!(middle.load(std::memory_order_acquire) & fresh))
+		return false;
+
+	unsigned int prev = middle.exchange(front, std::memory_order_acq_rel);
+	front = prev & ~fresh;
+	values = slots[front];
 
-	consume_each(1);
-	return 0;
+	return true;
 }
@@ -20,29 +20,90 @@
 #ifndef SIGNAL_SAMPLE_HPP
 #define SIGNAL_SAMPLE_HPP
 
+#include <atomic>
+#include <chrono>
 #include <vector>
 
 #include <QObject>
 
 #include <gnuradio/sync_block.h>
 
-Q_DECLARE_METATYPE(std::vector<float>);
-
 namespace adiscope {
+	/*
+	 * Reduction of the items received on each input since the previous
+	 * publication.
+	 */
+	struct signal_sample_values {
+		std::vector<float> first;
+		std::vector<float> latest;
+		std::vector<float> mean;
+		std::vector<float> min;
+		std::vector<float> max;
+		uint64_t count; // items reduced on each input
+	};
+
+	/*
+	 * Sink which reduces its inputs in bulk on the scheduler thread
+	 * (first and latest value, mean, min and max) and publishes the
+	 * result at most @rate times per second.
+	 *
+	 * The values go through a lock-free single-producer/single-consumer
+	 * mailbox (a triple buffer): the scheduler never waits for the GUI
+	 * and the GUI always gets the most recent values. ready() is only
+	 * emitted when the mailbox goes from empty to full, so a slow GUI
+	 * gets one queued event however fast the values are published; it
+	 * can also poll fetch() from a timer.
+	 */
 	class signal_sample : public QObject, public gr::sync_block
 	{
 		Q_OBJECT
 
 	public:
-		explicit signal_sample();
+		explicit signal_sample(double rate = 0.0);
 		~signal_sample();
 
+		/* A null rate publishes after each call to work() */
+		void set_rate(double rate);
+		double rate() const;
+
+		/*
+		 * Publishes the values of the first call to work() only, and
+		 * drops the items received afterwards until the next start.
+		 */
+		void set_single_shot(bool single_shot);
+
+		/*
+		 * Takes the last published values. Returns false if nothing
+		 * was published since the previous call. Only one thread
+		 * may fetch.
+		 */
+		bool fetch(signal_sample_values& values);
+
+		bool start();
+
 		int work(int noutput_items,
 				gr_vector_const_void_star &input_items,
 				gr_vector_void_star &output_items);
 
 	Q_SIGNALS:
-		void triggered(const std::vector<float> values);
+		void ready();
+
+	private:
+		static const unsigned int fresh = 4;
+
+		void reset(size_t nb_inputs);
+		void publish();
+
+		std::vector<double> sum;
+		signal_sample_values acc;
+		std::chrono::steady_clock::time_point last_publish;
+		std::atomic<double> d_rate;
+		std::atomic<bool> d_single_shot;
+		bool done;
+
+		signal_sample_values slots[3];
+		unsigned int back, front;
+		std::atomic<unsigned int> middle; // slot index | fresh
 	};
 }
 
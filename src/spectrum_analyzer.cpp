@@ -41,6 +41,7 @@
 #include "hardware_trigger.hpp"
 #include "channel_widget.hpp"
 #include "db_click_buttons.hpp"
+#include "iio_attr_cache.hpp"
 
 /* Generated UI */
 #include "ui_spectrum_analyzer.h"
@@ -802,8 +803,8 @@ void SpectrumAnalyzer::writeAllSettingsToHardware()
 			m2k_adc->setChnHwGainMode(i, M2kAdc::LOW_GAIN_MODE);
 		}
 
-		iio_device_attr_write_longlong(adc->iio_adc_dev(),
-		                               "oversampling_ratio", sample_rate_divider);
+		IioAttrCache::write(adc->iio_adc_dev(), "oversampling_ratio",
+		                    (long long)sample_rate_divider);
 	}
 
 	auto trigger = adc->getTrigger();
@@ -891,8 +892,8 @@ void SpectrumAnalyzer::setSampleRate(double sr)
 		auto m2k_adc = std::dynamic_pointer_cast<M2kAdc>(adc);
 
 		if (m2k_adc) {
-			iio_device_attr_write_longlong(adc->iio_adc_dev(),
-			                               "oversampling_ratio", sample_rate_divider);
+			IioAttrCache::write(adc->iio_adc_dev(), "oversampling_ratio",
+			                    (long long)sample_rate_divider);
 		} else {
 			adc->setSampleRate(sr);
 		}
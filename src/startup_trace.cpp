@@ -0,0 +1,171 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/* Qt includes */
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+
+/* Local includes */
+#include "startup_trace.hpp"
+
+using namespace adiscope;
+
+namespace {
+
+struct TraceEvent {
+	QByteArray name;
+	qint64 start;
+	qint64 duration; // < 0 for instant events
+	int thread;
+};
+
+QElapsedTimer origin;
+bool trace_enabled = false;
+std::mutex lock;
+std::vector<TraceEvent> events;
+std::atomic<int> next_thread(1);
+
+// Some scopes (e.g. the USB scan) keep running after the startup
+const size_t maxEvents = 10000;
+
+int thread_index()
+{
+	static thread_local int index = next_thread++;
+
+	return index;
+}
+
+QByteArray escaped(const QByteArray& str)
+{
+	QByteArray out;
+
+	for (char c : str) {
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+
+	return out;
+}
+
+}
+
+void StartupTrace::start()
+{
+	origin.start();
+	trace_enabled = qgetenv("SCOPY_TRACE") == "1";
+}
+
+bool StartupTrace::enabled()
+{
+	return trace_enabled;
+}
+
+qint64 StartupTrace::now()
+{
+	return origin.isValid() ? origin.nsecsElapsed() / 1000 : 0;
+}
+
+void StartupTrace::record(const QByteArray& name, qint64 start, qint64 end)
+{
+	if (!trace_enabled)
+		return;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (events.size() < maxEvents)
+		events.push_back({ name, start, end - start, thread_index() });
+}
+
+qint64 StartupTrace::interactive()
+{
+	const qint64 elapsed = now() / 1000;
+	bool ok;
+	const qint64 budget = qgetenv("SCOPY_STARTUP_BUDGET_MS").toLongLong(&ok);
+
+	if (trace_enabled) {
+		std::lock_guard<std::mutex> guard(lock);
+		events.push_back({ "Interactive", now(), -1, thread_index() });
+	}
+
+	qDebug() << "Startup took" << elapsed << "ms";
+	write();
+
+	if (ok && elapsed > budget) {
+		qWarning() << "Startup went over its budget of" << budget << "ms";
+		return -1;
+	}
+
+	return elapsed;
+}
+
+bool StartupTrace::write()
+{
+	if (!trace_enabled)
+		return false;
+
+	QByteArray filename = qgetenv("SCOPY_TRACE_FILE");
+	if (filename.isEmpty())
+		filename = "scopy_trace.json";
+
+	QFile file(QString::fromLocal8Bit(filename));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	QByteArray json = "{\"traceEvents\":[\n";
+	std::lock_guard<std::mutex> guard(lock);
+
+	for (size_t i = 0; i < events.size(); i++) {
+		const TraceEvent& event = events[i];
+
+		json += "{\"name\":\"" + escaped(event.name) +
+			"\",\"pid\":1,\"tid\":" +
+			QByteArray::number(event.thread) +
+			",\"ts\":" + QByteArray::number(event.start);
+
+		if (event.duration < 0)
+			json += ",\"ph\":\"i\",\"s\":\"g\"}";
+		else
+			json += ",\"ph\":\"X\",\"dur\":" +
+				QByteArray::number(event.duration) + "}";
+
+		json += (i + 1 < events.size()) ? ",\n" : "\n";
+	}
+
+	json += "]}\n";
+
+	return file.write(json) == json.size();
+}
+
+TraceScope::TraceScope(const char *name) :
+	name(name),
+	start(StartupTrace::enabled() ? StartupTrace::now() : 0)
+{
+}
+
+TraceScope::~TraceScope()
+{
+	if (StartupTrace::enabled())
+		StartupTrace::record(name, start, StartupTrace::now());
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef STARTUP_TRACE_HPP
+#define STARTUP_TRACE_HPP
+
+#include <QByteArray>
+#include <QtGlobal>
+
+namespace adiscope {
+
+/*
+ * Records where the startup time goes.
+ *
+ * When Scopy is started with SCOPY_TRACE=1, the durations recorded with
+ * TraceScope (or record()) are written as a Chrome trace, which can be
+ * opened with chrome://tracing or Perfetto, to the file named by
+ * SCOPY_TRACE_FILE (scopy_trace.json by default). The file is written
+ * when the window becomes interactive and again on exit.
+ *
+ * The time from the start of main() to the first pass of the event loop
+ * is checked against SCOPY_STARTUP_BUDGET_MS when it is set.
+ */
+class StartupTrace
+{
+public:
+	/* Sets the time origin, first thing in main() */
+	static void start();
+	static bool enabled();
+
+	/* Microseconds since start() */
+	static qint64 now();
+
+	static void record(const QByteArray& name, qint64 start, qint64 end);
+
+	/*
+	 * Marks the window as interactive. Returns the startup time in
+	 * milliseconds, or -1 when it went over the budget.
+	 */
+	static qint64 interactive();
+
+	static bool write();
+};
+
+class TraceScope
+{
+public:
+	explicit TraceScope(const char *name);
+	~TraceScope();
+
+private:
+	const char *name;
+	qint64 start;
+};
+}
+
+#endif /* STARTUP_TRACE_HPP */
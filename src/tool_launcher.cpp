@@ -27,6 +27,9 @@
 #include "jsfileio.h"
 #include "osc_adc.h"
 #include "hw_dac.h"
+#include "iio_attr_cache.hpp"
+#include "startup_trace.hpp"
+#include "decoder_index.hpp"
 #include "menuoption.h"
 #include "dragzone.h"
 
@@ -37,6 +40,7 @@
 #include <QtConcurrentRun>
 #include <QSignalTransition>
 #include <QMessageBox>
+#include <QSignalBlocker>
 #include <QTimer>
 #include <QSettings>
 #include <QStringList>
@@ -60,6 +64,11 @@ ToolLauncher::ToolLauncher(QWidget *parent) :
 	infoWidget(nullptr),
 	calib(nullptr),
 	skip_calibration(false),
+	headless(false),
+	decoders_checked(false),
+	calibration_cache(true),
+	calibration_cache_temp_band(2.0),
+	calibration_cache_max_age(24),
 	calibrating(false)
 {
 	if (!isatty(STDIN_FILENO))
@@ -133,6 +142,24 @@ ToolLauncher::ToolLauncher(QWidget *parent) :
 	connect(toolMenu["Spectrum Analyzer"]->getToolBtn(), SIGNAL(clicked()), this,
 		SLOT(btnSpectrumAnalyzer_clicked()));
 
+	// Running a tool which wasn't created yet creates it, then hands
+	// it the click
+	for (const QString& name : { "Digital IO", "Logic Analyzer",
+			"Pattern Generator" }) {
+		auto btn = toolMenu[name]->getToolStopBtn();
+
+		connect(btn, &QPushButton::toggled, [=](bool checked) {
+			if (!checked || !ctx || lazyTool(name) ||
+					!createTool(name))
+				return;
+
+			{
+				QSignalBlocker blocker(btn);
+				btn->setChecked(false);
+			}
+			btn->setChecked(true);
+		});
+	}
 
 		//option background
 	connect(toolMenu["Oscilloscope"]->getToolBtn(), SIGNAL(toggled(bool)), this,
@@ -191,6 +218,16 @@ ToolLauncher::ToolLauncher(QWidget *parent) :
 	tl_api->ApiObject::load(*settings);
 
 	insertMenuOptions();
+
+	// libsigrokdecode is set up here, on the GUI thread. Importing the
+	// Python decoders is slow; it happens in the background until a
+	// tool needs them
+	QString decoderPath = QCoreApplication::applicationDirPath() +
+		"/decoders";
+	bool srd_ok = initDecoders(decoderPath);
+	decoders = QtConcurrent::run([=]() {
+		return srd_ok && loadDecoders(decoderPath);
+	});
 	ui->menu->setMinimumSize(ui->menu->sizeHint());
 	/* Show a smooth opening when the app starts */
 	ui->menu->toggleMenu(true);
@@ -244,15 +281,26 @@ void ToolLauncher::runProgram(const QString& program, const QString& fn)
 	qApp->exit(ret);
 }
 
+void ToolLauncher::setHeadless(bool en)
+{
+	headless = en;
+	DisplayPlot::setHeadless(en);
+}
+
 void ToolLauncher::search()
 {
 	search_timer->stop();
+
+	if (headless)
+		return;
+
 	future = QtConcurrent::run(this, &ToolLauncher::searchDevices);
 	watcher.setFuture(future);
 }
 
 QVector<QString> ToolLauncher::searchDevices()
 {
+	TraceScope trace("Scan USB devices");
 	struct iio_context_info **info;
 	unsigned int nb_contexts;
 	QVector<QString> uris;
@@ -425,6 +473,7 @@ void ToolLauncher::update()
 
 ToolLauncher::~ToolLauncher()
 {
+	decoders.waitForFinished();
 
 	disconnect();
 
@@ -544,11 +593,13 @@ void ToolLauncher::btnPowerControl_clicked()
 
 void ToolLauncher::btnLogicAnalyzer_clicked()
 {
+	createTool("Logic Analyzer");
 	swapMenu(static_cast<QWidget *>(logic_analyzer));
 }
 
 void adiscope::ToolLauncher::btnPatternGenerator_clicked()
 {
+	createTool("Pattern Generator");
 	swapMenu(static_cast<QWidget *>(pattern_generator));
 }
 
@@ -564,6 +615,7 @@ void adiscope::ToolLauncher::btnSpectrumAnalyzer_clicked()
 
 void adiscope::ToolLauncher::btnDigitalIO_clicked()
 {
+	createTool("Digital IO");
 	swapMenu(static_cast<QWidget *>(dio));
 }
 
@@ -698,6 +750,8 @@ void adiscope::ToolLauncher::on_btnConnect_clicked(bool pressed)
 
 void adiscope::ToolLauncher::destroyContext()
 {
+	prewarm_queue.clear();
+
 	if (dio) {
 		delete dio;
 		dio = nullptr;
@@ -754,38 +808,135 @@ void adiscope::ToolLauncher::destroyContext()
 	}
 
 	if (ctx) {
+		qDebug() << "IIO attributes:" << IioAttrCache::roundTrips()
+			<< "round trips," << IioAttrCache::savedRoundTrips()
+			<< "saved";
+
+		// The cache is keyed by the channels / devices of the context
+		IioAttrCache::invalidate();
 		iio_context_destroy(ctx);
 		ctx = nullptr;
 	}
 }
 
-bool ToolLauncher::loadDecoders(QString path)
+bool ToolLauncher::initDecoders(QString path)
 {
 	static bool srd_loaded = false;
 
 	if (srd_loaded) {
 		srd_exit();
+		srd_loaded = false;
 	}
 
+	TraceScope trace("Init decoders");
+
 	if (srd_init(path.toStdString().c_str()) != SRD_OK) {
 		qDebug() << "ERROR: libsigrokdecode init failed.";
 		return false;
-	} else {
-		srd_loaded = true;
-		/* Load the protocol decoders */
-		srd_decoder_load_all();
-		auto decoder = srd_decoder_get_by_id("parallel");
+	}
+
+	srd_loaded = true;
+
+	return true;
+}
+
+bool ToolLauncher::loadDecoders(QString path)
+{
+	TraceScope trace("Load decoders");
+
+	/* The decoders are imported when they are first used */
+	if (!DecoderIndex::load(path)) {
+		return false;
+	}
+
+	return DecoderIndex::decoder("parallel") != nullptr;
+}
+
+QWidget *ToolLauncher::lazyTool(const QString& name) const
+{
+	if (name == "Digital IO")
+		return dio;
+	else if (name == "Logic Analyzer")
+		return logic_analyzer;
+	else if (name == "Pattern Generator")
+		return pattern_generator;
+
+	return nullptr;
+}
+
+bool ToolLauncher::createTool(const QString& name)
+{
+	if (!prewarm_queue.removeOne(name))
+		return false;
+
+	QElapsedTimer timer;
+	timer.start();
 
-		if (decoder == nullptr) {
-			return false;
+	if ((name == "Logic Analyzer" || name == "Pattern Generator") &&
+			!decoders_checked) {
+		decoders_checked = true;
+
+		{
+			TraceScope trace("Wait for decoders");
+			decoders.waitForFinished();
+		}
+
+		if (!decoders.result()) {
+			search_timer->stop();
+
+			QMessageBox error(this);
+			error.setText("There was a problem initializing libsigrokdecode. Some features may be missing");
+			error.exec();
 		}
+
+		logToolCreation("Waiting for the decoders", timer);
+	}
+
+	if (name == "Digital IO") {
+		dio = new DigitalIO(ctx, filter, toolMenu["Digital IO"]->getToolStopBtn(),
+				dioManager, &js_engine, this);
+	} else if (name == "Logic Analyzer") {
+		logic_analyzer = new LogicAnalyzer(ctx, filter, toolMenu["Logic Analyzer"]->getToolStopBtn(),
+				&js_engine, this);
+	} else if (name == "Pattern Generator") {
+		pattern_generator = new PatternGenerator(ctx, filter,
+				toolMenu["Pattern Generator"]->getToolStopBtn(), &js_engine,dioManager, this);
 	}
 
+	logToolCreation(name, timer);
 	return true;
 }
 
+void ToolLauncher::prewarmNext()
+{
+	if (!ctx || prewarm_queue.isEmpty())
+		return;
+
+	createTool(prewarm_queue.first());
+
+	// Let the event loop run between two tools
+	if (!prewarm_queue.isEmpty())
+		QTimer::singleShot(0, this, SLOT(prewarmNext()));
+}
+
+void ToolLauncher::prewarmAll()
+{
+	while (!prewarm_queue.isEmpty())
+		createTool(prewarm_queue.first());
+}
+
+void ToolLauncher::logToolCreation(const QString& name, QElapsedTimer& timer)
+{
+	const qint64 elapsed = timer.restart();
+	const qint64 now = StartupTrace::now();
+
+	qDebug() << name << "created in" << elapsed << "ms";
+	StartupTrace::record(name.toUtf8(), now - elapsed * 1000, now);
+}
+
 void adiscope::ToolLauncher::calibrate()
 {
+	TraceScope trace("Calibration");
 	bool ok=true;
 
 	if (!skip_calibration) {
@@ -803,10 +954,20 @@ void adiscope::ToolLauncher::calibrate()
 		toolMenu["Spectrum Analyzer"]->getToolBtn()->setText("Calibrating...");
 		toolMenu["Network Analyzer"]->getToolBtn()->setText("Calibrating...");
 
-		if (calib->isInitialized()) {
+		// A known device close to the temperature it was
+		// calibrated at doesn't need a full calibration
+		if (calibration_cache && calib->loadCached(
+				calibration_cache_temp_band,
+				calibration_cache_max_age * 3600LL)) {
+			ok = true;
+		} else if (calib->isInitialized()) {
 			calib->setHardwareInCalibMode();
 			ok = calib->calibrateAll();
 			calib->restoreHardwareFromCalibMode();
+
+			if (ok) {
+				calib->storeCached();
+			}
 		}
 
 		toolMenu["Voltmeter"]->getToolBtn()->setText(old_dmm_text);
@@ -822,33 +983,43 @@ void adiscope::ToolLauncher::calibrate()
 		Q_EMIT adcCalibrationDone();
 		Q_EMIT dacCalibrationDone();
 	}
+
+	// Create the other tools once the device is free
+	QMetaObject::invokeMethod(this, "prewarmNext", Qt::QueuedConnection);
 }
 
 void adiscope::ToolLauncher::enableAdcBasedTools()
 {
+	QElapsedTimer timer;
+	timer.start();
+
 	if (filter->compatible(TOOL_OSCILLOSCOPE)) {
 		oscilloscope = new Oscilloscope(ctx, filter, adc,
 						toolMenu["Oscilloscope"]->getToolStopBtn(),
 						&js_engine, this);
 		adc_users_group.addButton(toolMenu["Oscilloscope"]->getToolStopBtn());
+		logToolCreation("Oscilloscope", timer);
 	}
 
 	if (filter->compatible(TOOL_DMM)) {
 		dmm = new DMM(ctx, filter, adc, toolMenu["Voltmeter"]->getToolStopBtn(),
 				&js_engine, this);
 		adc_users_group.addButton(toolMenu["Voltmeter"]->getToolStopBtn());
+		logToolCreation("Voltmeter", timer);
 	}
 
 	if (filter->compatible(TOOL_SPECTRUM_ANALYZER)) {
 		spectrum_analyzer = new SpectrumAnalyzer(ctx, filter, adc,
 			toolMenu["Spectrum Analyzer"]->getToolStopBtn(),&js_engine, this);
 		adc_users_group.addButton(toolMenu["Spectrum Analyzer"]->getToolStopBtn());
+		logToolCreation("Spectrum Analyzer", timer);
 	}
 
 	if (filter->compatible((TOOL_NETWORK_ANALYZER))) {
 		network_analyzer = new NetworkAnalyzer(ctx, filter, adc,
 			toolMenu["Network Analyzer"]->getToolStopBtn(), &js_engine, this);
 		adc_users_group.addButton(toolMenu["Network Analyzer"]->getToolStopBtn());
+		logToolCreation("Network Analyzer", timer);
 	}
 
 	Q_EMIT adcToolsCreated();
@@ -857,15 +1028,21 @@ void adiscope::ToolLauncher::enableAdcBasedTools()
 
 void adiscope::ToolLauncher::enableDacBasedTools()
 {
+	QElapsedTimer timer;
+	timer.start();
+
 	if (filter->compatible(TOOL_SIGNAL_GENERATOR)) {
 		signal_generator = new SignalGenerator(ctx, dacs, filter,
 			toolMenu["Signal Generator"]->getToolStopBtn(), &js_engine, this);
+		logToolCreation("Signal Generator", timer);
 	}
 	Q_EMIT dacToolsCreated();
 }
 
 bool adiscope::ToolLauncher::switchContext(const QString& uri)
 {
+	TraceScope trace("Connect");
+
 	destroyContext();
 
 	if (uri.startsWith("ip:")) {
@@ -937,41 +1114,28 @@ bool adiscope::ToolLauncher::switchContext(const QString& uri)
 
 	}
 
-	if (filter->compatible(TOOL_LOGIC_ANALYZER)
-	    || filter->compatible(TOOL_PATTERN_GENERATOR)) {
-		bool success = loadDecoders(QCoreApplication::applicationDirPath() +
-					"/decoders");
-
-		if (!success) {
-			search_timer->stop();
-
-			QMessageBox error(this);
-			error.setText("There was a problem initializing libsigrokdecode. Some features may be missing");
-			error.exec();
-		}
-	}
-
-	if (filter->compatible(TOOL_DIGITALIO)) {
-		dio = new DigitalIO(ctx, filter, toolMenu["Digital IO"]->getToolStopBtn(),
-				dioManager, &js_engine, this);
-	}
-
-
+	// The power supply also powers up the ADC, which the calibration
+	// needs, so it can't wait
 	if (filter->compatible(TOOL_POWER_CONTROLLER)) {
-		power_control = new PowerController(ctx, toolMenu["Power Supply"]->getToolStopBtn(),
-				&js_engine, this);
-	}
+		QElapsedTimer timer;
+		timer.start();
 
-	if (filter->compatible(TOOL_LOGIC_ANALYZER)) {
-		logic_analyzer = new LogicAnalyzer(ctx, filter, toolMenu["Logic Analyzer"]->getToolStopBtn(),
+		power_control = new PowerController(ctx, toolMenu["Power Supply"]->getToolStopBtn(),
 				&js_engine, this);
+		logToolCreation("Power Supply", timer);
 	}
 
+	// The other tools are created when they are first opened, or in
+	// the background after the calibration
+	decoders_checked = false;
+	prewarm_queue.clear();
 
-	if (filter->compatible((TOOL_PATTERN_GENERATOR))) {
-		pattern_generator = new PatternGenerator(ctx, filter,
-				toolMenu["Pattern Generator"]->getToolStopBtn(), &js_engine,dioManager, this);
-	}
+	if (filter->compatible(TOOL_DIGITALIO))
+		prewarm_queue.append("Digital IO");
+	if (filter->compatible(TOOL_LOGIC_ANALYZER))
+		prewarm_queue.append("Logic Analyzer");
+	if (filter->compatible(TOOL_PATTERN_GENERATOR))
+		prewarm_queue.append("Pattern Generator");
 
 	connect(toolMenu["Network Analyzer"]->getToolStopBtn(),
 			&QPushButton::toggled,
@@ -1174,6 +1338,8 @@ void ToolLauncher::detachToolOnPosition(int position)
 {
 	for (const auto x : toolMenu)
 		if (x->getPosition() == position){
+			createTool(x->getName());
+
 			if (x->getName() == "Oscilloscope")
 				oscilloscope->detached();
 			else if (x->getName() == "Digital IO")
@@ -1235,6 +1401,51 @@ bool ToolLauncher_API::calibration_skipped()
 	return tl->skip_calibration;
 }
 
+bool ToolLauncher_API::calibration_cache() const
+{
+	return tl->calibration_cache;
+}
+
+void ToolLauncher_API::use_calibration_cache(bool use)
+{
+	tl->calibration_cache = use;
+}
+
+double ToolLauncher_API::calibration_cache_temp_band() const
+{
+	return tl->calibration_cache_temp_band;
+}
+
+void ToolLauncher_API::set_calibration_cache_temp_band(double band)
+{
+	tl->calibration_cache_temp_band = band;
+}
+
+int ToolLauncher_API::calibration_cache_max_age() const
+{
+	return tl->calibration_cache_max_age;
+}
+
+void ToolLauncher_API::set_calibration_cache_max_age(int hours)
+{
+	tl->calibration_cache_max_age = hours;
+}
+
+qint64 ToolLauncher_API::attrRoundTrips() const
+{
+	return IioAttrCache::roundTrips();
+}
+
+qint64 ToolLauncher_API::attrSavedRoundTrips() const
+{
+	return IioAttrCache::savedRoundTrips();
+}
+
+bool ToolLauncher_API::headless() const
+{
+	return tl->headless;
+}
+
 QList<QString> ToolLauncher_API::usb_uri_list()
 {
 	QList<QString> uri_list;
@@ -1284,6 +1495,11 @@ bool ToolLauncher_API::connect(const QString& uri)
 		QCoreApplication::processEvents();
 		QThread::msleep(10);
 	} while (!done);
+
+	// Scripts expect all the tools to be there
+	if (did_connect)
+		tl->prewarmAll();
+
 	return did_connect;
 }
 
@@ -1304,6 +1520,7 @@ void ToolLauncher_API::load(const QString& file)
 	QSettings settings(file, QSettings::IniFormat);
 
 	this->ApiObject::load(settings);
+	tl->prewarmAll();
 
 	if (tl->oscilloscope)
 		tl->oscilloscope->api->load(settings);
@@ -1330,6 +1547,7 @@ void ToolLauncher_API::save(const QString& file)
 	QSettings settings(file, QSettings::IniFormat);
 
 	this->ApiObject::save(settings);
+	tl->prewarmAll();
 
 	if (tl->oscilloscope)
 		tl->oscilloscope->api->save(settings);
@@ -28,6 +28,7 @@
 #include <QSocketNotifier>
 #include <QVector>
 #include <QButtonGroup>
+#include <QElapsedTimer>
 #include <QMap>
 #include <QStringList>
 #include <info_widget.h>
@@ -73,6 +74,12 @@ public:
 	~ToolLauncher();
 
 	Q_INVOKABLE void runProgram(const QString& program, const QString& fn);
+
+	/*
+	 * Used to run scripts on test stations: the window is not shown,
+	 * the plots are not drawn and no USB devices are scanned for.
+	 */
+	void setHeadless(bool en);
 	InfoWidget *infoWidget;
 
 Q_SIGNALS:
@@ -122,6 +129,8 @@ private Q_SLOTS:
 	void swapMenuOptions(int source, int destination, bool dropAfter);
 	void highlight(bool on, int position);
 
+	void prewarmNext();
+
 private:
 	Ui::ToolLauncher *ui;
 	struct iio_context *ctx;
@@ -166,12 +175,26 @@ private:
 
 	bool calibrating;
 	bool skip_calibration;
+	bool headless;
+	bool decoders_checked;
+	QFuture<bool> decoders;
+
+	/* Tools which are created on first use, or in the background */
+	QStringList prewarm_queue;
+	bool calibration_cache;
+	double calibration_cache_temp_band;
+	int calibration_cache_max_age;
 
 	void loadToolTips(bool connected);
 	QVector<QString> searchDevices();
 	void swapMenu(QWidget *menu);
 	void destroyContext();
+	bool initDecoders(QString path);
 	bool loadDecoders(QString path);
+	QWidget *lazyTool(const QString& name) const;
+	bool createTool(const QString& name);
+	void prewarmAll();
+	void logToolCreation(const QString& name, QElapsedTimer& timer);
 	bool switchContext(const QString& uri);
 	void resetStylesheets();
 	void calibrate();
@@ -210,6 +233,21 @@ class ToolLauncher_API: public ApiObject
 
 	Q_PROPERTY(bool skip_calibration READ calibration_skipped WRITE skip_calibration);
 
+	Q_PROPERTY(bool calibration_cache READ calibration_cache
+		   WRITE use_calibration_cache);
+	Q_PROPERTY(double calibration_cache_temp_band
+		   READ calibration_cache_temp_band
+		   WRITE set_calibration_cache_temp_band);
+	Q_PROPERTY(int calibration_cache_max_age
+		   READ calibration_cache_max_age
+		   WRITE set_calibration_cache_max_age);
+
+	Q_PROPERTY(qint64 attr_round_trips READ attrRoundTrips STORED false);
+	Q_PROPERTY(qint64 attr_saved_round_trips READ attrSavedRoundTrips
+		   STORED false);
+
+	Q_PROPERTY(bool headless READ headless STORED false);
+
 public:
 	explicit ToolLauncher_API(ToolLauncher *tl) : ApiObject(), tl(tl) {}
 	~ToolLauncher_API() {}
@@ -226,6 +264,22 @@ public:
 	bool calibration_skipped();
 	void skip_calibration(bool);
 
+	bool calibration_cache() const;
+	void use_calibration_cache(bool use);
+
+	/* Temperature difference, in degrees Celsius */
+	double calibration_cache_temp_band() const;
+	void set_calibration_cache_temp_band(double band);
+
+	/* In hours */
+	int calibration_cache_max_age() const;
+	void set_calibration_cache_max_age(int hours);
+
+	qint64 attrRoundTrips() const;
+	qint64 attrSavedRoundTrips() const;
+
+	bool headless() const;
+
 	const QString& getPreviousIp()
 	{
 		return tl->previousIp;
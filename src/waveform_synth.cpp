@@ -0,0 +1,210 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <volk/volk.h>
+
+#include "waveform_synth.hpp"
+
+using namespace adiscope;
+
+const size_t WaveformSynth::blockSize = 4096;
+
+/* Linear interpolation in this table is good to ~1e-7 of full scale,
+ * well below the resolution of the DACs */
+static const unsigned int sineTableBits = 12;
+static const unsigned int sineTableSize = 1 << sineTableBits;
+
+static const float *sineTable()
+{
+	static float table[sineTableSize + 1];
+	static bool initialized = [] {
+		for (unsigned int i = 0; i <= sineTableSize; i++) {
+			table[i] = std::sin(2.0 * M_PI * i / sineTableSize);
+		}
+
+		return true;
+	}();
+
+	(void)initialized;
+	return table;
+}
+
+/* Converts a position in the period, in cycles, to a 64-bit fixed point
+ * phase which wraps around by itself at the end of the period */
+static uint64_t toFixed(double cycles)
+{
+	cycles -= std::floor(cycles);
+
+	double scaled = std::ldexp(cycles, 32);
+	double hi = std::floor(scaled);
+	double lo = std::floor(std::ldexp(scaled - hi, 32));
+
+	return ((uint64_t)hi << 32) | (uint64_t)lo;
+}
+
+WaveformSynth::WaveformSynth(Shape shape, double amplitude, double offset,
+                             double frequency, double phase, double sampleRate) :
+	shape(shape),
+	amplitude(amplitude),
+	offset(offset),
+	increment(sampleRate > 0 ? toFixed(frequency / sampleRate) : 0),
+	start(toFixed(phase / 360.0)),
+	position(0)
+{
+}
+
+void WaveformSynth::reset()
+{
+	position = 0;
+}
+
+void WaveformSynth::render(float *dst, size_t samples)
+{
+	uint32_t phases[blockSize];
+
+	for (size_t i = 0; i < samples; i += blockSize) {
+		size_t n = std::min(blockSize, samples - i);
+
+		// The 64-bit phase of the first sample is exact in modular
+		// arithmetic, so there is no drift over long buffers. Within
+		// the block, 32 bits of phase keep the loops vectorizable and
+		// the error below 1e-6 of a period.
+		const uint64_t first = start + position * increment;
+		const uint32_t base = first >> 32;
+		const uint32_t step = (increment + (1ULL << 31)) >> 32;
+		position += n;
+
+		for (size_t j = 0; j < n; j++) {
+			phases[j] = base + (uint32_t)j * step;
+		}
+
+		renderPhases(shape, phases, dst + i, n, amplitude, offset);
+	}
+}
+
+void WaveformSynth::renderPhases(Shape shape, const uint32_t *phases,
+                                 float *dst, size_t samples, float amplitude, float offset)
+{
+	const float unit = 1.0f / (1 << 24);
+	const float a = amplitude;
+	const float o = offset;
+
+	switch (shape) {
+	case SINE: {
+		const float *table = sineTable();
+		const float half = a / 2;
+		const unsigned int fracBits = 32 - sineTableBits;
+		const float fracUnit = 1.0f / (1 << fracBits);
+
+		for (size_t i = 0; i < samples; i++) {
+			uint32_t phase = phases[i];
+			unsigned int idx = phase >> fracBits;
+			float frac = (int32_t)(phase & ((1 << fracBits) - 1)) *
+			             fracUnit;
+			float lo = table[idx];
+
+			dst[i] = o + half * (lo + frac * (table[idx + 1] - lo));
+		}
+
+		break;
+	}
+
+	case SQUARE:
+		for (size_t i = 0; i < samples; i++) {
+			dst[i] = o + a / 2 - a * (int32_t)(phases[i] >> 31);
+		}
+
+		break;
+
+	case TRIANGLE:
+		for (size_t i = 0; i < samples; i++) {
+			uint32_t phase = phases[i] + (1U << 30);
+			float u = (int32_t)(phase >> 8) * unit;
+			dst[i] = o - a / 2 + a * std::fabs(1.0f - 2.0f * u);
+		}
+
+		break;
+
+	case SAWTOOTH:
+	case INV_SAWTOOTH: {
+		const float slope = shape == SAWTOOTH ? a : -a;
+
+		for (size_t i = 0; i < samples; i++) {
+			uint32_t phase = phases[i] + (1U << 31);
+			float u = (int32_t)(phase >> 8) * unit;
+			dst[i] = o - slope / 2 + slope * u;
+		}
+
+		break;
+	}
+
+	case CONSTANT:
+	default:
+		std::fill(dst, dst + samples, o);
+		break;
+	}
+}
+
+void WaveformSynth::generate(float *dst, size_t samples)
+{
+	render(dst, samples);
+}
+
+void WaveformSynth::generate(double *dst, size_t samples)
+{
+	float block[blockSize];
+
+	for (size_t i = 0; i < samples; i += blockSize) {
+		size_t n = std::min(blockSize, samples - i);
+
+		render(block, n);
+		volk_32f_convert_64f(dst + i, block, n);
+	}
+}
+
+void WaveformSynth::generate(int16_t *dst, size_t samples, ptrdiff_t stride,
+                             float scale)
+{
+	float block[blockSize];
+	int16_t converted[blockSize];
+	char *out = (char *)dst;
+
+	for (size_t i = 0; i < samples; i += blockSize) {
+		size_t n = std::min(blockSize, samples - i);
+
+		render(block, n);
+
+		// Same rounding and saturation as blocks::float_to_short
+		if (stride == sizeof(int16_t)) {
+			volk_32f_s32f_convert_16i((int16_t *)out, block, scale, n);
+			out += n * sizeof(int16_t);
+			continue;
+		}
+
+		volk_32f_s32f_convert_16i(converted, block, scale, n);
+
+		for (size_t j = 0; j < n; j++) {
+			*(int16_t *)out = converted[j];
+			out += stride;
+		}
+	}
+}
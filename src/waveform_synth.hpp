@@ -0,0 +1,93 @@
+/*
+ * Copyright 2018 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef WAVEFORM_SYNTH_HPP
+#define WAVEFORM_SYNTH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace adiscope {
+
+/*
+ * Computes the periodic waveforms of the signal generator straight into
+ * the destination memory, without building a GNU Radio flowgraph.
+ *
+ * The samples are produced a block at a time by tight loops over the
+ * position in the period, then scaled and converted to the destination
+ * format while the block is still in the cache. The synthesizer keeps
+ * its position, so consecutive calls continue the same waveform.
+ */
+class WaveformSynth
+{
+public:
+	enum Shape {
+		SINE,
+		SQUARE,
+		TRIANGLE,
+		SAWTOOTH,
+		INV_SAWTOOTH,
+		CONSTANT,
+	};
+
+	/*
+	 * @amplitude is peak to peak and @phase is in degrees. The shapes
+	 * and their phase match the GNU Radio sources which were used by
+	 * the signal generator.
+	 */
+	WaveformSynth(Shape shape, double amplitude, double offset,
+	              double frequency, double phase, double sampleRate);
+
+	void generate(float *dst, size_t samples);
+	void generate(double *dst, size_t samples);
+
+	/*
+	 * Writes raw DAC samples, rounding and saturating @scale times the
+	 * value in volts. @stride is the distance in bytes between two
+	 * samples, as returned by iio_buffer_step().
+	 */
+	void generate(int16_t *dst, size_t samples, ptrdiff_t stride,
+	              float scale);
+
+	void reset();
+
+	/*
+	 * Computes the waveform for the given phases, where 2^32 is a
+	 * whole period. Used by the generators which change the frequency
+	 * on the fly.
+	 */
+	static void renderPhases(Shape shape, const uint32_t *phases,
+	                         float *dst, size_t samples, float amplitude,
+	                         float offset);
+
+	static const size_t blockSize;
+
+private:
+	void render(float *dst, size_t samples);
+
+	Shape shape;
+	float amplitude;
+	float offset;
+	uint64_t increment;
+	uint64_t start;
+	uint64_t position;
+};
+}
+
+#endif /* WAVEFORM_SYNTH_HPP */